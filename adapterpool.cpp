@@ -0,0 +1,122 @@
+#include "adapterpool.h"
+
+#include <QBluetoothLocalDevice>
+#include <QtLogging>
+
+#include <algorithm>
+
+AdapterPool& AdapterPool::instance()
+{
+    static AdapterPool pool;
+    return pool;
+}
+
+AdapterPool::AdapterPool(QObject* parent)
+    : QObject(parent)
+{
+    _clock.start();
+}
+
+void AdapterPool::refresh()
+{
+    QList<Adapter> adapters;
+    for(const auto& host : QBluetoothLocalDevice::allDevices())
+    {
+        if(QBluetoothLocalDevice(host.address()).hostMode() == QBluetoothLocalDevice::HostPoweredOff)
+            continue;
+
+        Adapter adapter;
+        adapter.address = host.address();
+        adapter.name = host.name();
+        for(const auto& known : _adapters)
+        {
+            if(known.address == adapter.address)
+                adapter.connections = known.connections;
+        }
+        adapters.push_back(adapter);
+    }
+
+    _adapters = adapters;
+    _enumerated = true;
+}
+
+QList<AdapterPool::Adapter> AdapterPool::adapters() const
+{
+    return _adapters;
+}
+
+void AdapterPool::addSighting(const QString& deviceKey, const QBluetoothAddress& adapter)
+{
+    if(adapter.isNull())
+        return;
+
+    const qint64 now = _clock.elapsed();
+    _sightings[deviceKey].insert(adapter, now);
+
+    // Advertisements arrive many times a second, a sweep once per window is enough
+    if(now - _lastPruneMs >= SIGHTING_WINDOW_MS)
+        pruneSightings(now);
+}
+
+void AdapterPool::pruneSightings(qint64 now)
+{
+    _lastPruneMs = now;
+    for(auto device = _sightings.begin(); device != _sightings.end();)
+    {
+        device->removeIf([now](const auto& sighting) { return sighting.value() < now - SIGHTING_WINDOW_MS; });
+        if(device->isEmpty())
+            device = _sightings.erase(device);
+        else
+            device++;
+    }
+}
+
+QBluetoothAddress AdapterPool::assign(QObject* owner, const QString& deviceKey)
+{
+    if(!_enumerated)
+        refresh();
+
+    // With one adapter or none, the default one is just as good and works everywhere
+    if(_adapters.size() < 2)
+        return QBluetoothAddress();
+
+    // Falls back to any adapter when none of them saw the device
+    bool seen = std::any_of(_adapters.begin(), _adapters.end(), [&](const Adapter& adapter) {
+        return sawRecently(deviceKey, adapter.address);
+    });
+
+    Adapter* least = nullptr;
+    for(auto& adapter : _adapters)
+    {
+        if(seen && !sawRecently(deviceKey, adapter.address))
+            continue;
+        if(!least || adapter.connections < least->connections)
+            least = &adapter;
+    }
+
+    least->connections++;
+    const QBluetoothAddress address = least->address;
+    qInfo("Using adapter %s (%d connections)", address.toString().toStdString().c_str(), least->connections);
+
+    connect(owner, &QObject::destroyed, this, [this, address]() { release(address); });
+    return address;
+}
+
+bool AdapterPool::sawRecently(const QString& deviceKey, const QBluetoothAddress& adapter) const
+{
+    const auto sightings = _sightings.constFind(deviceKey);
+    if(sightings == _sightings.constEnd() || !sightings->contains(adapter))
+        return false;
+
+    const qint64 latest = *std::max_element(sightings->constBegin(), sightings->constEnd());
+    return sightings->value(adapter) >= latest - SIGHTING_WINDOW_MS;
+}
+
+void AdapterPool::release(const QBluetoothAddress& address)
+{
+    for(auto& adapter : _adapters)
+    {
+        if(adapter.address == address && adapter.connections > 0)
+            adapter.connections--;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef ADAPTERPOOL_H
+#define ADAPTERPOOL_H
+
+#include <QObject>
+#include <QBluetoothAddress>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+
+/*
+ * Spreads the sensor connections of the process over the local Bluetooth
+ * adapters. Each connection goes to the adapter with the fewest connections,
+ * so the throughput grows with the number of radios instead of saturating
+ * one. Adapters that are powered off are left out.
+ *
+ * Scanners report which adapters discovered each device. A connection only
+ * goes to one of the adapters that saw the device recently, as the others may
+ * be out of its range. Without sightings any adapter is used.
+ *
+ * Where the platform can't name its adapters, e.g. on macOS, the pool has
+ * none and everything goes through the default adapter.
+ */
+class AdapterPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Adapters that saw a device this long before the latest sighting still count.
+    // Sightings older than that are dropped, at most a window later.
+    static constexpr qint64 SIGHTING_WINDOW_MS = 30000;
+
+    struct Adapter
+    {
+        QBluetoothAddress address;
+        QString name;
+        int connections = 0;
+    };
+
+    static AdapterPool& instance();
+
+    // Enumerates the adapters again, keeping the counts of those still present
+    void refresh();
+    QList<Adapter> adapters() const;
+
+    // The adapter received an advertisement of the device with the given key
+    void addSighting(const QString& deviceKey, const QBluetoothAddress& adapter);
+
+    // The least loaded adapter among those that saw the device, for a connection
+    // held until the owner is destroyed. A null address means the default adapter.
+    QBluetoothAddress assign(QObject* owner, const QString& deviceKey);
+
+private:
+    explicit AdapterPool(QObject* parent = nullptr);
+
+    void release(const QBluetoothAddress& address);
+    bool sawRecently(const QString& deviceKey, const QBluetoothAddress& adapter) const;
+    void pruneSightings(qint64 now);
+
+    QList<Adapter> _adapters;
+    bool _enumerated = false;
+    QElapsedTimer _clock;
+    QHash<QString, QHash<QBluetoothAddress, qint64>> _sightings; // Last sighting in ms by adapter, per device
+    qint64 _lastPruneMs = 0;
+};
+
+#endif // ADAPTERPOOL_H
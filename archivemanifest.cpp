@@ -0,0 +1,175 @@
+#include "archivemanifest.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+static bool fail(QString* error, const QString& message)
+{
+    if(error)
+        *error = message;
+    return false;
+}
+
+bool ArchiveManifest::load(const QString& directory, QString* error)
+{
+    _directory = directory;
+    _devices.clear();
+
+    if(!QDir().mkpath(directory))
+        return fail(error, "Cannot create directory " + directory);
+
+    // A new archive starts with an empty manifest
+    QFile file(QDir(directory).filePath(FILE_NAME));
+    if(!file.exists())
+        return true;
+    if(!file.open(QIODevice::ReadOnly))
+        return fail(error, "Cannot read " + file.fileName());
+
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if(!doc.isObject())
+        return fail(error, file.fileName() + ": " + parseError.errorString());
+
+    const QJsonObject devices = doc.object()["devices"].toObject();
+    for(auto it = devices.begin(); it != devices.end(); it++)
+    {
+        QList<Entry>& entries = _devices[it.key()];
+        for(const auto& value : it.value().toArray())
+        {
+            const QJsonObject json = value.toObject();
+            Entry entry;
+            entry.id = (uint32_t) json["id"].toInteger();
+            entry.size = (uint32_t) json["size"].toInteger();
+            entry.modified = (uint64_t) json["modified"].toInteger();
+            entry.path = json["path"].toString();
+            entry.sha256 = json["sha256"].toString();
+            entry.archivedAt = json["archivedAt"].toInteger();
+            entries.push_back(entry);
+        }
+    }
+    return true;
+}
+
+bool ArchiveManifest::save(QString* error) const
+{
+    QJsonObject devices;
+    for(auto it = _devices.begin(); it != _devices.end(); it++)
+    {
+        QJsonArray entries;
+        for(const auto& entry : it.value())
+        {
+            entries.append(QJsonObject {
+                { "id", (qint64) entry.id },
+                { "size", (qint64) entry.size },
+                { "modified", (qint64) entry.modified },
+                { "path", entry.path },
+                { "sha256", entry.sha256 },
+                { "archivedAt", entry.archivedAt },
+            });
+        }
+        devices[it.key()] = entries;
+    }
+
+    // Replaced in one step, so an interrupted sync leaves the previous manifest intact
+    QSaveFile file(QDir(_directory).filePath(FILE_NAME));
+    const QByteArray data = QJsonDocument(QJsonObject { { "version", 1 }, { "devices", devices } }).toJson();
+    if(!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+        return fail(error, "Failed to write " + file.fileName());
+    return true;
+}
+
+QString ArchiveManifest::directory() const
+{
+    return _directory;
+}
+
+ArchiveManifest::Status ArchiveManifest::status(const QString& deviceId, const LogListPacket::LogItem& item) const
+{
+    const Entry* entry = find(deviceId, item);
+    if(!entry)
+        return Missing;
+    if(entry->size < item.size)
+        return Grown;
+    return entry->modified == item.modified ? Archived : Missing;
+}
+
+const ArchiveManifest::Entry* ArchiveManifest::find(const QString& deviceId, const LogListPacket::LogItem& item) const
+{
+    auto device = _devices.find(deviceId);
+    if(device == _devices.end())
+        return nullptr;
+
+    const Entry* latest = nullptr;
+    for(const auto& entry : *device)
+    {
+        if(entry.id != item.id)
+            continue;
+        if(entry.modified == item.modified)
+            return &entry;
+        if(!latest || entry.archivedAt >= latest->archivedAt)
+            latest = &entry;
+    }
+    return latest;
+}
+
+void ArchiveManifest::record(const QString& deviceId, const Entry& entry)
+{
+    QList<Entry>& entries = _devices[deviceId];
+    for(auto& existing : entries)
+    {
+        if(existing.id == entry.id && existing.modified == entry.modified)
+        {
+            existing = entry;
+            return;
+        }
+    }
+    entries.push_back(entry);
+}
+
+void ArchiveManifest::remove(const QString& deviceId, const Entry& entry)
+{
+    auto device = _devices.find(deviceId);
+    if(device == _devices.end())
+        return;
+
+    device->removeIf([&entry](const Entry& existing) {
+        return existing.id == entry.id && existing.modified == entry.modified;
+    });
+}
+
+QString ArchiveManifest::relativePath(const QString& deviceId, const LogListPacket::LogItem& item) const
+{
+    QString device = deviceId;
+    device.replace(':', '-');
+    return device + QString::asprintf("/%u-%llu.sbem", item.id, (unsigned long long) item.modified);
+}
+
+QString ArchiveManifest::absolutePath(const Entry& entry) const
+{
+    return QDir(_directory).filePath(entry.path);
+}
+
+bool ArchiveManifest::verify(const Entry& entry, QString* error) const
+{
+    QFile file(absolutePath(entry));
+    if(!file.open(QIODevice::ReadOnly))
+        return fail(error, "Cannot read " + file.fileName());
+
+    const QByteArray data = file.readAll();
+    if(data.size() != (qsizetype) entry.size)
+        return fail(error, QString::asprintf("%s has %lld bytes, expected %u",
+            file.fileName().toStdString().c_str(), data.size(), entry.size));
+    if(hash(data) != entry.sha256)
+        return fail(error, file.fileName() + " does not match its recorded hash");
+    return true;
+}
+
+QString ArchiveManifest::hash(const QByteArray& data)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex());
+}
@@ -0,0 +1,70 @@
+#ifndef ARCHIVEMANIFEST_H
+#define ARCHIVEMANIFEST_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include "protocol/Protocol.hpp"
+
+/*
+ * Record of the logs kept in a local archive directory, stored next to them
+ * as manifest.json. Logs are matched to their archived copies by device and
+ * id. A log listed with a larger size than its copy has grown since it was
+ * archived, even if the firmware updated its modification time meanwhile,
+ * and replaces the earlier copy. As ids start over after the logs are erased,
+ * a log with the same id and another modification time that hasn't grown is
+ * a different log, and so is one whose earlier copy turns out not to be a
+ * prefix of it.
+ *
+ * Logs are stored as <device>/<id>-<modified>.sbem under the archive with the
+ * SHA-256 of their contents, so the copies can be checked before the logs are
+ * erased from the sensor.
+ */
+class ArchiveManifest
+{
+public:
+    static constexpr const char* FILE_NAME = "manifest.json";
+
+    struct Entry
+    {
+        uint32_t id = 0;
+        uint32_t size = 0;
+        uint64_t modified = 0;
+        QString path; // Relative to the archive directory
+        QString sha256;
+        qint64 archivedAt = 0; // Milliseconds since the epoch
+    };
+
+    enum Status
+    {
+        Missing,
+        Grown,
+        Archived,
+    };
+
+    bool load(const QString& directory, QString* error = nullptr);
+    bool save(QString* error = nullptr) const;
+    QString directory() const;
+
+    Status status(const QString& deviceId, const LogListPacket::LogItem& item) const;
+    // The copy of the log with the same modification time, else the latest one with its id
+    const Entry* find(const QString& deviceId, const LogListPacket::LogItem& item) const;
+    void record(const QString& deviceId, const Entry& entry);
+    // Drops an entry replaced by a grown copy, its file is left to the caller
+    void remove(const QString& deviceId, const Entry& entry);
+
+    QString relativePath(const QString& deviceId, const LogListPacket::LogItem& item) const;
+    QString absolutePath(const Entry& entry) const;
+
+    // Checks the archived copy on disk against its recorded size and hash
+    bool verify(const Entry& entry, QString* error = nullptr) const;
+
+    static QString hash(const QByteArray& data);
+
+private:
+    QString _directory;
+    QHash<QString, QList<Entry>> _devices;
+};
+
+#endif // ARCHIVEMANIFEST_H
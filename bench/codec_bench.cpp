@@ -0,0 +1,173 @@
+// Compares the layout-based packet codec against the previous hand-written
+// Read/Write implementations, and checks that both produce the same bytes.
+
+#include "../protocol/Protocol.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace Legacy
+{
+    bool ReadHeader(Packet& p, ReadableBuffer& stream)
+    {
+        bool result = true;
+        result &= stream.read(&p.type, 1);
+        result &= stream.read(&p.reference, 1);
+        return result;
+    }
+
+    bool WriteHeader(Packet& p, WritableBuffer& stream)
+    {
+        bool result = true;
+        result &= stream.write(&p.type, 1);
+        result &= stream.write(&p.reference, 1);
+        return result;
+    }
+
+    bool Read(OfflineConfigPacket& p, ReadableBuffer& stream)
+    {
+        bool result = ReadHeader(p, stream);
+        result &= stream.read(&p.config.wakeUpBehavior, 1);
+        result &= stream.read(&p.config.sleepDelay, 2);
+        result &= stream.read(&p.config.optionsFlags, 1);
+        result &= stream.read(&p.config.measurementParams, OfflineConfig::MeasCount * 2);
+        return result;
+    }
+
+    bool Write(OfflineConfigPacket& p, WritableBuffer& stream)
+    {
+        bool result = WriteHeader(p, stream);
+        result &= stream.write(&p.config.wakeUpBehavior, 1);
+        result &= stream.write(&p.config.sleepDelay, 2);
+        result &= stream.write(&p.config.optionsFlags, 1);
+        result &= stream.write(&p.config.measurementParams, OfflineConfig::MeasCount * 2);
+        return result;
+    }
+
+    bool Read(LogListPacket& p, ReadableBuffer& stream)
+    {
+        bool result = ReadHeader(p, stream);
+        result &= stream.read(&p.count, sizeof(p.count));
+        result &= stream.read(&p.complete, sizeof(p.complete));
+        for (uint8_t i = 0; i < p.count; i++)
+        {
+            result &= stream.read(&p.items[i].id, sizeof(p.items[i].id));
+            result &= stream.read(&p.items[i].modified, sizeof(p.items[i].modified));
+            result &= stream.read(&p.items[i].size, sizeof(p.items[i].size));
+        }
+        return result;
+    }
+
+    bool Write(LogListPacket& p, WritableBuffer& stream)
+    {
+        bool result = WriteHeader(p, stream);
+        result &= stream.write(&p.count, sizeof(p.count));
+        result &= stream.write(&p.complete, sizeof(p.complete));
+        for (uint8_t i = 0; i < p.count; i++)
+        {
+            result &= stream.write(&p.items[i].id, sizeof(p.items[i].id));
+            result &= stream.write(&p.items[i].modified, sizeof(p.items[i].modified));
+            result &= stream.write(&p.items[i].size, sizeof(p.items[i].size));
+        }
+        return result;
+    }
+
+    bool Read(DataPacket& p, ReadableBuffer& stream)
+    {
+        bool result = ReadHeader(p, stream);
+        result &= stream.read(&p.offset, sizeof(p.offset));
+        result &= stream.read(&p.totalBytes, sizeof(p.totalBytes));
+        size_t len = stream.get_read_size() - stream.get_read_pos();
+        p.data = ReadableBuffer(stream.get_read_ptr() + stream.get_read_pos(), len);
+        return result;
+    }
+
+    bool Write(DataPacket& p, WritableBuffer& stream)
+    {
+        bool result = WriteHeader(p, stream);
+        result &= stream.write(&p.offset, sizeof(p.offset));
+        result &= stream.write(&p.totalBytes, sizeof(p.totalBytes));
+        result &= p.data.write_to(stream);
+        return result;
+    }
+}
+
+template<typename PacketT, typename WriteFn, typename ReadFn>
+static double Measure(PacketT& packet, WriteFn write, ReadFn read, size_t iterations)
+{
+    uint8_t buffer[Packet::MAX_PACKET_SIZE];
+    volatile size_t sink = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+    {
+        WritableBuffer out(buffer, sizeof(buffer));
+        write(packet, out);
+
+        ReadableBuffer in(buffer, out.get_write_pos());
+        read(packet, in);
+        sink = sink + in.get_read_pos();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - begin).count() / iterations;
+}
+
+template<typename PacketT>
+static bool Compare(const char* name, PacketT& packet, size_t iterations)
+{
+    uint8_t legacyBytes[Packet::MAX_PACKET_SIZE] = {};
+    uint8_t codecBytes[Packet::MAX_PACKET_SIZE] = {};
+
+    WritableBuffer legacyOut(legacyBytes, sizeof(legacyBytes));
+    WritableBuffer codecOut(codecBytes, sizeof(codecBytes));
+    bool ok = Legacy::Write(packet, legacyOut) && packet.Write(codecOut)
+        && legacyOut.get_write_pos() == codecOut.get_write_pos()
+        && memcmp(legacyBytes, codecBytes, codecOut.get_write_pos()) == 0;
+
+    double legacy = Measure(packet,
+        [](PacketT& p, WritableBuffer& s) { Legacy::Write(p, s); },
+        [](PacketT& p, ReadableBuffer& s) { Legacy::Read(p, s); },
+        iterations);
+
+    double codec = Measure(packet,
+        [](PacketT& p, WritableBuffer& s) { static_cast<Packet&>(p).Write(s); },
+        [](PacketT& p, ReadableBuffer& s) { static_cast<Packet&>(p).Read(s); },
+        iterations);
+
+    printf("%-20s %4zu bytes  legacy %7.2f ns  codec %7.2f ns  %s\n",
+        name, codecOut.get_write_pos(), legacy, codec, ok ? "identical" : "MISMATCH");
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    size_t iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10000000;
+
+    OfflineConfigPacket config(1);
+    config.config.sleepDelay = 1800;
+    config.config.optionsFlags = OfflineConfig::OptionsCompressECG;
+    config.config.measurementParams.bySensor.ECG = 512;
+    config.config.measurementParams.bySensor.Acc = 208;
+
+    LogListPacket list(2);
+    list.count = LogListPacket::MAX_ITEMS;
+    list.complete = true;
+    for (uint8_t i = 0; i < list.count; i++)
+        list.items[i] = { i + 1u, 1000u * i, 1700000000000000ull + i };
+
+    uint8_t payload[DataPacket::MAX_PAYLOAD];
+    memset(payload, 0xA5, sizeof(payload));
+    DataPacket data(3);
+    data.offset = 4096;
+    data.totalBytes = 1 << 20;
+    data.data = ReadableBuffer(payload, sizeof(payload));
+
+    bool ok = true;
+    ok &= Compare("OfflineConfigPacket", config, iterations);
+    ok &= Compare("LogListPacket", list, iterations);
+    ok &= Compare("DataPacket", data, iterations);
+    return ok ? 0 : 1;
+}
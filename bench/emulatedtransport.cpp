@@ -0,0 +1,299 @@
+#include "emulatedtransport.h"
+#include "sensor.h"
+#include "timesync.h"
+
+#include <QtEndian>
+#include <QtGlobal>
+
+#include <algorithm>
+
+// Contents of every emulated log, repeated as needed
+static const QByteArray pattern = []() {
+    QByteArray data(DataPacket::MAX_PAYLOAD, 0);
+    for(int i = 0; i < data.size(); i++)
+        data[i] = (char) (i * 31 + 7);
+    return data;
+}();
+
+EmulatedTransport::EmulatedTransport(const Options& options, QObject* parent)
+    : SensorTransport(parent)
+    , _options(options)
+    , _clockOffsetUs(options.clockOffsetUs)
+{
+    _tick.setInterval(TICK_MS);
+    connect(&_tick, &QTimer::timeout, this, &EmulatedTransport::onTick);
+    _clock.start();
+}
+
+void EmulatedTransport::connectToDevice()
+{
+    QTimer::singleShot(_options.latencyMs, this, [this]() {
+        _connected = true;
+        _lastTickMs = _clock.elapsed();
+        _budget = 0;
+        _tick.start();
+
+        emit connected();
+        emit discovering();
+        emit ready();
+    });
+}
+
+void EmulatedTransport::disconnectFromDevice()
+{
+    if(!_connected)
+        return;
+
+    _connected = false;
+    _tick.stop();
+    _outbox.clear();
+    _live.clear();
+    QTimer::singleShot(0, this, [this]() { emit disconnected(); });
+}
+
+bool EmulatedTransport::write(const QByteArray& data)
+{
+    if(!_connected)
+        return false;
+
+    Packet::Type type;
+    uint8_t ref;
+    ReadableBuffer buffer((const uint8_t*) data.data(), data.size());
+    if(!buffer.read(&type, 1) || !buffer.read(&ref, 1) || !buffer.seek_read(0))
+        return false;
+
+    switch(type)
+    {
+    case Packet::TypeHandshake:
+    {
+        HandshakePacket response(ref);
+        reply(response);
+        break;
+    }
+    case Packet::TypeCommand:
+    {
+        CommandPacket command(ref);
+        if(!command.Read(buffer))
+        {
+            replyStatus(ref, 400);
+            break;
+        }
+        onCommand(command);
+        break;
+    }
+    case Packet::TypeOfflineConfig:
+    {
+        OfflineConfigPacket packet(ref);
+        if(!packet.Read(buffer))
+        {
+            replyStatus(ref, 400);
+            break;
+        }
+        _config = packet.config;
+        replyStatus(ref, 200);
+        break;
+    }
+    case Packet::TypeTime:
+    {
+        TimePacket packet(ref);
+        if(!packet.Read(buffer))
+        {
+            replyStatus(ref, 400);
+            break;
+        }
+        _clockOffsetUs += packet.time - sensorTimeUs();
+        replyStatus(ref, 200);
+        break;
+    }
+    default:
+        replyStatus(ref, 400);
+        break;
+    }
+    return true;
+}
+
+void EmulatedTransport::onCommand(const CommandPacket& command)
+{
+    const uint8_t ref = command.reference;
+    switch(command.command)
+    {
+    case CommandPacket::CmdReadConfig:
+    {
+        OfflineConfigPacket response(ref, _config);
+        reply(response);
+        break;
+    }
+    case CommandPacket::CmdListLogs:
+    {
+        int id = 1;
+        do
+        {
+            LogListPacket response(ref);
+            while(response.count < LogListPacket::MAX_ITEMS && id <= _options.logCount)
+            {
+                auto& item = response.items[response.count++];
+                item.id = id;
+                item.size = _options.logSize;
+                item.modified = 1700000000000000ULL + id * 1000000ULL;
+                id++;
+            }
+            response.complete = id > _options.logCount;
+            reply(response);
+        }
+        while(id <= _options.logCount);
+        break;
+    }
+    case CommandPacket::CmdReadLog:
+    {
+        const int id = command.params.readLog.logIndex;
+        if(id < 1 || id > _options.logCount)
+        {
+            replyStatus(ref, 404);
+            break;
+        }
+
+        for(int offset = 0; offset < _options.logSize; offset += DataPacket::MAX_PAYLOAD)
+        {
+            const int len = std::min<int>(DataPacket::MAX_PAYLOAD, _options.logSize - offset);
+            DataPacket response(ref);
+            response.offset = offset;
+            response.totalBytes = _options.logSize;
+            response.data = ReadableBuffer((const uint8_t*) pattern.constData(), len);
+            reply(response);
+        }
+        replyStatus(ref, 200);
+        break;
+    }
+    case CommandPacket::CmdReadTime:
+    {
+        TimePacket response(ref, sensorTimeUs());
+        reply(response);
+        break;
+    }
+    case CommandPacket::CmdStartLiveStream:
+    case CommandPacket::CmdStopLiveStream:
+    {
+        const auto meas = (OfflineConfig::Measurement) command.params.liveStream.measurement;
+        if(meas >= OfflineConfig::MeasCount)
+        {
+            replyStatus(ref, 400);
+            break;
+        }
+
+        _live.removeIf([meas](const Subscription& sub) { return sub.measurement == meas; });
+        const uint16_t rate = command.params.liveStream.sampleRate;
+        if(command.command == CommandPacket::CmdStartLiveStream && rate != SENSOR_MEAS_OFF)
+        {
+            // Toggled measurements such as heart rate report about once per second
+            const qint64 now = _clock.elapsed();
+            _live.push_back({ meas, rate == SENSOR_MEAS_ON ? 1.0 : (double) rate, now, 0, now });
+        }
+        replyStatus(ref, 200);
+        break;
+    }
+    case CommandPacket::CmdClearLogs:
+        _options.logCount = 0;
+        replyStatus(ref, 200);
+        break;
+    default:
+        replyStatus(ref, 404);
+        break;
+    }
+}
+
+void EmulatedTransport::reply(Packet& packet)
+{
+    send(packet, _clock.elapsed() + 2 * _options.latencyMs);
+}
+
+void EmulatedTransport::send(Packet& packet, qint64 dueMs)
+{
+    QByteArray data(Packet::MAX_PACKET_SIZE, 0);
+    WritableBuffer stream((uint8_t*) data.data(), data.size());
+    packet.Write(stream);
+    data.resize(stream.get_write_pos());
+
+    _outbox.push_back({ dueMs, data });
+}
+
+void EmulatedTransport::replyStatus(uint8_t ref, uint16_t status)
+{
+    StatusPacket packet(ref, status);
+    reply(packet);
+}
+
+qint64 EmulatedTransport::sensorTimeUs() const
+{
+    return TimeSync::hostTimeUs() + _options.latencyMs * 1000LL + _clockOffsetUs;
+}
+
+void EmulatedTransport::sendLiveData(qint64 now)
+{
+    for(auto& sub : _live)
+    {
+        const auto& format = LiveDataPacket::FORMATS[sub.measurement];
+        const size_t sampleSize = format.channels * LiveDataPacket::SampleSize(format.type);
+        const qint64 perPacket = LiveDataPacket::MAX_PAYLOAD / sampleSize;
+
+        // Full packets as soon as they are due, a partial one once a batch interval has passed
+        qint64 due = (qint64) (sub.rate * (now - sub.startMs) / 1000.0) - sub.sent;
+        while(due >= perPacket || (due > 0 && now - sub.lastSentMs >= LIVE_BATCH_MS))
+        {
+            const qint64 count = std::min(due, perPacket);
+            QByteArray samples(count * sampleSize, 0);
+            for(qint64 i = 0; i < count; i++)
+            {
+                for(size_t c = 0; c < format.channels; c++)
+                {
+                    const qint64 n = sub.sent + i;
+                    char* value = samples.data() + i * sampleSize + c * LiveDataPacket::SampleSize(format.type);
+                    switch(format.type)
+                    {
+                    case LiveDataPacket::SampleInt32:
+                        qToLittleEndian<qint32>((qint32) (n % 2000) - 1000, value);
+                        break;
+                    case LiveDataPacket::SampleUInt16:
+                        qToLittleEndian<quint16>((quint16) (800 + n % 200), value);
+                        break;
+                    case LiveDataPacket::SampleFloat32:
+                        qToLittleEndian<float>((float) ((n + c) % 100) / 10.0f, value);
+                        break;
+                    }
+                }
+            }
+
+            LiveDataPacket packet(Sensor::LIVE_STREAM_REF);
+            packet.measurement = sub.measurement;
+            packet.timestamp = (uint32_t) (sensorTimeUs() / 1000);
+            packet.samples = ReadableBuffer((const uint8_t*) samples.constData(), samples.size());
+            send(packet, now + _options.latencyMs);
+
+            sub.sent += count;
+            sub.lastSentMs = now;
+            due -= count;
+        }
+    }
+}
+
+void EmulatedTransport::onTick()
+{
+    const qint64 now = _clock.elapsed();
+    sendLiveData(now);
+
+    const double perTick = (double) _options.bytesPerSecond * TICK_MS / 1000.0;
+
+    // An idle link doesn't save up bandwidth for later
+    _budget = std::min(_budget + _options.bytesPerSecond * (now - _lastTickMs) / 1000.0, perTick + Packet::MAX_PACKET_SIZE);
+    _lastTickMs = now;
+
+    while(!_outbox.isEmpty() && _outbox.front().dueMs <= now && _budget >= _outbox.front().data.size())
+    {
+        const QByteArray data = _outbox.takeFirst().data;
+        _budget -= data.size();
+        emit received(data);
+
+        // The sensor may have disconnected while handling the packet
+        if(!_connected)
+            return;
+    }
+}
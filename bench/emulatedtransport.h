@@ -0,0 +1,81 @@
+#ifndef EMULATEDTRANSPORT_H
+#define EMULATEDTRANSPORT_H
+
+#include "sensortransport.h"
+#include "protocol/Protocol.hpp"
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QTimer>
+
+/*
+ * Answers the sensor protocol in process, in place of a Bluetooth link. Each
+ * direction adds latencyMs, so responses arrive a round trip of twice that
+ * after the request. All of them share the link's bandwidth, so downloads
+ * take about as long as over the air. The emulated sensor has logCount logs
+ * of logSize bytes each, keeps the last config it was sent and has a clock
+ * that starts off by clockOffsetUs. Live streams send their samples at the
+ * requested rate, batched into packets at least every LIVE_BATCH_MS.
+ */
+class EmulatedTransport : public SensorTransport
+{
+    Q_OBJECT
+
+public:
+    static constexpr int TICK_MS = 10;
+    static constexpr int LIVE_BATCH_MS = 100;
+
+    struct Options
+    {
+        int latencyMs = 30;
+        int bytesPerSecond = 8000;
+        int logCount = 4;
+        int logSize = 64 * 1024;
+        qint64 clockOffsetUs = -2500000;
+    };
+
+    explicit EmulatedTransport(const Options& options, QObject* parent = nullptr);
+
+    void connectToDevice() override;
+    void disconnectFromDevice() override;
+    bool write(const QByteArray& packet) override;
+
+private:
+    void onCommand(const CommandPacket& command);
+    void reply(Packet& packet);
+    void send(Packet& packet, qint64 dueMs);
+    void replyStatus(uint8_t ref, uint16_t status);
+    void onTick();
+    void sendLiveData(qint64 now);
+    // Sensor clock when a packet written now reaches the sensor
+    qint64 sensorTimeUs() const;
+
+    struct Pending
+    {
+        qint64 dueMs;
+        QByteArray data;
+    };
+
+    struct Subscription
+    {
+        OfflineConfig::Measurement measurement;
+        double rate; // Samples per second
+        qint64 startMs;
+        qint64 sent = 0; // Samples
+        qint64 lastSentMs;
+    };
+
+    Options _options;
+    OfflineConfig _config;
+    qint64 _clockOffsetUs;
+    bool _connected = false;
+
+    QTimer _tick;
+    QElapsedTimer _clock;
+    qint64 _lastTickMs = 0;
+    double _budget = 0; // Bytes the link can still carry in this tick
+    QList<Pending> _outbox;
+    QList<Subscription> _live;
+};
+
+#endif // EMULATEDTRANSPORT_H
@@ -0,0 +1,410 @@
+// Soak test of the client with a fleet of emulated sensors. Every sensor runs
+// config round trips and log downloads over an emulated link for a fixed time,
+// then the request throughput and latencies, memory and CPU use are reported.
+// With --live every sensor also streams ECG and IMU data at the rates the live
+// view needs, decoded on its own thread and read at the view's frame rate, and
+// the run fails if any sample is dropped or the stream falls behind.
+
+#include "emulatedtransport.h"
+#include "livestream.h"
+#include "livestreamdecoder.h"
+#include "sensor.h"
+#include "stallmonitor.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QLoggingCategory>
+#include <QRandomGenerator>
+#include <QTimer>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+enum Kind
+{
+    KindConfig,
+    KindList,
+    KindDownload,
+    KindCount
+};
+
+static const char* kindNames[KindCount] = { "config", "list", "download" };
+
+struct Stats
+{
+    std::vector<qint64> latencyUs[KindCount];
+    quint64 failures[KindCount] = {};
+    quint64 bytes = 0;
+};
+
+struct Worker
+{
+    Sensor* sensor = nullptr;
+    bool started = false;
+    bool busy = false;
+    Kind kind = KindConfig;
+    uint8_t ref = Packet::INVALID_REF;
+    QElapsedTimer timer;
+    QList<LogListPacket::LogItem> logs;
+
+    std::unique_ptr<LiveStream> live;
+    std::unique_ptr<LiveStreamDecoder> decoder;
+    QElapsedTimer liveTimer; // Since the live streams were started
+};
+
+struct LiveRate
+{
+    OfflineConfig::Measurement measurement;
+    uint16_t sampleRate;
+    const char* name;
+};
+
+// What the live view shows at once: ECG at its highest rate and the IMU at 208 Hz
+static const LiveRate liveRates[] = {
+    { OfflineConfig::MeasECG, 512, "ecg" },
+    { OfflineConfig::MeasAcc, 208, "acc" },
+    { OfflineConfig::MeasGyro, 208, "gyro" },
+};
+
+static constexpr int LIVE_FRAME_MS = 33;
+// Share of the expected samples that must have been read, the rest may still be
+// in flight when the run ends
+static constexpr double LIVE_MIN_RATIO = 0.95;
+
+// Resident set size in kB, zero when it can't be read
+static qint64 residentKb()
+{
+    QFile status("/proc/self/status");
+    if(status.open(QIODevice::ReadOnly))
+    {
+        for(const QByteArray& line : status.readAll().split('\n'))
+        {
+            if(line.startsWith("VmRSS:"))
+                return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+        }
+    }
+#ifdef Q_OS_UNIX
+    // Peak instead of current where /proc isn't available
+    rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0)
+        return usage.ru_maxrss;
+#endif
+    return 0;
+}
+
+// User and system CPU time of the process in microseconds, negative if unknown
+static qint64 cpuUs()
+{
+#ifdef Q_OS_UNIX
+    rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        return (qint64) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+            + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+    }
+#endif
+    return -1;
+}
+
+static double percentile(std::vector<qint64>& values, double p)
+{
+    if(values.empty())
+        return 0;
+    const size_t index = std::min(values.size() - 1, (size_t) (p * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index] / 1000.0;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Soak test with a fleet of emulated sensors.");
+    parser.addHelpOption();
+
+    QCommandLineOption sensorsOption("sensors", "Number of emulated sensors.", "count", "100");
+    QCommandLineOption durationOption("duration", "Seconds to run the workload for.", "seconds", "60");
+    QCommandLineOption latencyOption("latency", "One-way link latency in milliseconds.", "ms", "30");
+    QCommandLineOption rateOption("rate", "Link bandwidth of each sensor in bytes per second.", "bytes", "8000");
+    QCommandLineOption logsOption("logs", "Logs on each sensor.", "count", "4");
+    QCommandLineOption logSizeOption("log-size", "Size of each log in bytes.", "bytes", "65536");
+    QCommandLineOption configRatioOption("config-ratio", "Share of workloads that are config round trips, the rest download logs.", "ratio", "0.5");
+    QCommandLineOption stallsOption("stalls", "Also report event loop stalls.");
+    QCommandLineOption liveOption("live", "Also stream 512 Hz ECG and 208 Hz IMU data from every sensor and check that none is dropped.");
+    parser.addOptions({ sensorsOption, durationOption, latencyOption, rateOption, logsOption, logSizeOption, configRatioOption, stallsOption, liveOption });
+    parser.process(app);
+
+    // Protocol diagnostics would dominate the profile
+    QLoggingCategory::setFilterRules("default.info=false");
+
+    const int sensorCount = std::max(1, parser.value(sensorsOption).toInt());
+    const qint64 durationMs = std::max(1, parser.value(durationOption).toInt()) * 1000LL;
+    const double configRatio = qBound(0.0, parser.value(configRatioOption).toDouble(), 1.0);
+    const bool live = parser.isSet(liveOption);
+
+    EmulatedTransport::Options options;
+    options.latencyMs = std::max(0, parser.value(latencyOption).toInt());
+    options.bytesPerSecond = std::max(1, parser.value(rateOption).toInt());
+    options.logCount = std::max(0, parser.value(logsOption).toInt());
+    options.logSize = std::max(0, parser.value(logSizeOption).toInt());
+
+    if(parser.isSet(stallsOption))
+        StallMonitor::instance().start();
+
+    const qint64 baselineKb = residentKb();
+    const qint64 baselineCpuUs = cpuUs();
+
+    Stats stats;
+    bool draining = false;
+    QElapsedTimer wall;
+    std::vector<std::unique_ptr<Worker>> workers;
+    QRandomGenerator random(1);
+
+    OfflineConfig config;
+    config.sleepDelay = 1800;
+    config.measurementParams.bySensor.Acc = 52;
+    config.measurementParams.bySensor.HR = SENSOR_MEAS_ON;
+
+    auto checkDone = [&]() {
+        for(const auto& worker : workers)
+        {
+            if(worker->busy)
+                return;
+        }
+        app.quit();
+    };
+
+    std::function<void(Worker*)> next;
+    auto complete = [&](Worker* worker, bool ok) {
+        if(ok)
+            stats.latencyUs[worker->kind].push_back(worker->timer.nsecsElapsed() / 1000);
+        else
+            stats.failures[worker->kind]++;
+        worker->ref = Packet::INVALID_REF;
+        next(worker);
+    };
+
+    auto request = [&](Worker* worker, Kind kind, uint8_t ref) {
+        worker->kind = kind;
+        worker->ref = ref;
+        worker->timer.start();
+        if(ref != Packet::INVALID_REF)
+            return;
+
+        // The link refused the packet, so this sensor sits out the rest of the run
+        stats.failures[kind]++;
+        worker->busy = false;
+        if(draining)
+            checkDone();
+    };
+
+    next = [&](Worker* worker) {
+        // Finishes the logs of a listing before starting another workload
+        if(!worker->logs.isEmpty() && !draining)
+        {
+            CommandPacket::Params params {};
+            params.readLog.logIndex = (uint16_t) worker->logs.takeFirst().id;
+            request(worker, KindDownload, worker->sensor->sendCommand(CommandPacket::CmdReadLog, params));
+            return;
+        }
+
+        if(draining)
+        {
+            worker->busy = false;
+            checkDone();
+            return;
+        }
+
+        worker->busy = true;
+        if(random.generateDouble() < configRatio)
+        {
+            config.sleepDelay = (uint16_t) random.bounded(60, 3600);
+            request(worker, KindConfig, worker->sensor->sendConfig(config));
+        }
+        else
+        {
+            request(worker, KindList, worker->sensor->sendCommand(CommandPacket::CmdListLogs, {}));
+        }
+    };
+
+    for(int i = 0; i < sensorCount; i++)
+    {
+        QBluetoothDeviceInfo info(QBluetoothAddress(i + 1), QString("Emulated %1").arg(i + 1), 0);
+        auto worker = std::make_unique<Worker>();
+        worker->sensor = new Sensor(&app, info, new EmulatedTransport(options));
+        Worker* w = worker.get();
+        Sensor* sensor = w->sensor;
+
+        if(live)
+        {
+            w->live = std::make_unique<LiveStream>();
+            w->decoder = std::make_unique<LiveStreamDecoder>(*w->live);
+            w->decoder->setSensorDevice(sensor);
+        }
+
+        QObject::connect(sensor, &Sensor::onConfigUpdated, &app, [&, w](const OfflineConfig&) {
+            if(!w->started)
+            {
+                // The first config is the one read after the handshake
+                w->started = true;
+                if(w->live)
+                {
+                    for(const auto& rate : liveRates)
+                        w->sensor->startLiveStream(rate.measurement, rate.sampleRate);
+                    w->liveTimer.start();
+                }
+                next(w);
+                return;
+            }
+            if(w->kind == KindConfig && w->ref == Packet::INVALID_REF && w->busy)
+                complete(w, true);
+        });
+        QObject::connect(sensor, &Sensor::onStatusResponse, &app, [&, w](uint8_t ref, uint16_t status) {
+            if(ref != w->ref)
+                return;
+
+            if(w->kind == KindConfig && status == 200)
+            {
+                // Reads the config back, which completes the round trip
+                w->ref = Packet::INVALID_REF;
+                if(w->sensor->sendCommand(CommandPacket::CmdReadConfig, {}) == Packet::INVALID_REF)
+                    complete(w, false);
+                return;
+            }
+            if(w->kind == KindDownload && status == 200)
+                return; // Completed through onDataTransmissionCompleted
+            complete(w, false);
+        });
+        QObject::connect(sensor, &Sensor::onLogListReceived, &app, [&, w](uint8_t ref, const QList<LogListPacket::LogItem>& logs, bool done) {
+            if(ref != w->ref)
+                return;
+            w->logs.append(logs);
+            if(done)
+                complete(w, true);
+        });
+        QObject::connect(sensor, &Sensor::onDataTransmissionCompleted, &app, [&, w](uint8_t ref, const QByteArray& data) {
+            if(ref != w->ref)
+                return;
+            stats.bytes += data.size();
+            complete(w, true);
+        });
+        QObject::connect(sensor, &Sensor::onError, &app, [&, w](Sensor::Error err, QString) {
+            fprintf(stderr, "%s: error %d\n", w->sensor->name().toStdString().c_str(), (int) err);
+            if(w->busy)
+                complete(w, false);
+        });
+
+        workers.push_back(std::move(worker));
+    }
+
+    const qint64 setupKb = residentKb();
+    printf("%d sensors, %lld s, %d ms latency, %d B/s per link, %d logs of %d bytes\n",
+        sensorCount, durationMs / 1000, options.latencyMs, options.bytesPerSecond, options.logCount, options.logSize);
+
+    wall.start();
+    for(const auto& worker : workers)
+        worker->sensor->connectDevice();
+
+    qint64 peakKb = setupKb;
+    QTimer sampler;
+    QObject::connect(&sampler, &QTimer::timeout, &app, [&]() { peakKb = std::max(peakKb, residentKb()); });
+    sampler.start(1000);
+
+    // Reads the rings at the live view's frame rate, like its paint timer does
+    quint64 liveSamples[std::size(liveRates)] = {};
+    std::vector<float> frameSamples(LiveStream::CHANNEL_CAPACITY);
+    QTimer frames;
+    QObject::connect(&frames, &QTimer::timeout, &app, [&]() {
+        for(const auto& worker : workers)
+        {
+            for(size_t r = 0; r < std::size(liveRates); r++)
+            {
+                const auto meas = liveRates[r].measurement;
+                for(size_t c = 0; c < worker->live->channelCount(meas); c++)
+                {
+                    const size_t count = worker->live->channel(meas, c).pop(frameSamples.data(), frameSamples.size());
+                    if(c == 0)
+                        liveSamples[r] += count;
+                }
+            }
+        }
+    });
+    if(live)
+        frames.start(LIVE_FRAME_MS);
+
+    QTimer::singleShot(durationMs, &app, [&]() {
+        // Lets requests in flight finish so their latencies count
+        draining = true;
+        checkDone();
+    });
+    app.exec();
+
+    const double elapsed = wall.nsecsElapsed() / 1e9;
+    const qint64 endKb = residentKb();
+    peakKb = std::max(peakKb, endKb);
+
+    quint64 requests = 0;
+    quint64 failures = 0;
+    printf("\n%-10s %10s %10s %10s %10s %10s\n", "request", "count", "failed", "req/s", "p50 ms", "p99 ms");
+    for(int kind = 0; kind < KindCount; kind++)
+    {
+        auto& latencies = stats.latencyUs[kind];
+        requests += latencies.size();
+        failures += stats.failures[kind];
+        printf("%-10s %10zu %10llu %10.1f %10.1f %10.1f\n", kindNames[kind], latencies.size(),
+            stats.failures[kind], latencies.size() / elapsed, percentile(latencies, 0.5), percentile(latencies, 0.99));
+    }
+
+    printf("\nthroughput %.1f req/s, %.0f B/s downloaded (%.0f B/s per sensor)\n",
+        requests / elapsed, stats.bytes / elapsed, stats.bytes / elapsed / sensorCount);
+    printf("memory     %lld kB at start, %lld kB with sensors, %lld kB peak (%.1f kB per sensor)\n",
+        baselineKb, setupKb, peakKb, (double) (peakKb - baselineKb) / sensorCount);
+
+    const qint64 endCpuUs = cpuUs();
+    if(endCpuUs >= 0)
+        printf("cpu        %.1f%% of one core\n", 100.0 * (endCpuUs - baselineCpuUs) / 1e6 / elapsed);
+
+    if(parser.isSet(stallsOption))
+    {
+        StallMonitor::instance().stop();
+        printf("\n%s", StallMonitor::instance().report().toStdString().c_str());
+    }
+
+    bool liveOk = true;
+    if(live)
+    {
+        printf("\n%-10s %10s %10s %12s %10s\n", "stream", "Hz", "samples", "expected", "dropped");
+        for(size_t r = 0; r < std::size(liveRates); r++)
+        {
+            const auto meas = liveRates[r].measurement;
+            double expected = 0;
+            size_t dropped = 0;
+            for(const auto& worker : workers)
+            {
+                if(worker->liveTimer.isValid())
+                    expected += liveRates[r].sampleRate * worker->liveTimer.nsecsElapsed() / 1e9;
+                dropped += worker->live->dropped(meas);
+            }
+
+            printf("%-10s %10u %10llu %12.0f %10zu\n", liveRates[r].name, liveRates[r].sampleRate,
+                liveSamples[r], expected, dropped);
+            if(dropped > 0 || liveSamples[r] < LIVE_MIN_RATIO * expected)
+                liveOk = false;
+        }
+        if(!liveOk)
+            printf("live streams dropped samples or fell behind\n");
+    }
+
+    return failures == 0 && liveOk ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+#include "bletransport.h"
+#include "adapterpool.h"
+#include "devicelistmodel.h"
+#include "sensor.h"
+
+#include <QtLogging>
+
+BleTransport::BleTransport(const QBluetoothDeviceInfo& info, QObject* parent)
+    : SensorTransport(parent)
+    , _svc(nullptr)
+{
+    _localAdapter = AdapterPool::instance().assign(this, DeviceListModel::deviceKey(info));
+    _pController = _localAdapter.isNull()
+        ? QLowEnergyController::createCentral(info, this)
+        : QLowEnergyController::createCentral(info, _localAdapter, this);
+    connect(_pController, &QLowEnergyController::connected, _pController, &QLowEnergyController::discoverServices);
+    connect(_pController, &QLowEnergyController::disconnected, this, &BleTransport::onControllerDisconnected);
+    connect(_pController, &QLowEnergyController::discoveryFinished, this, &BleTransport::onFinishServiceDiscovery);
+    connect(_pController, &QLowEnergyController::serviceDiscovered, this, &BleTransport::onServiceDiscovered);
+    connect(_pController, &QLowEnergyController::errorOccurred, this, &BleTransport::onControllerError);
+    _pController->setRemoteAddressType(QLowEnergyController::PublicAddress);
+}
+
+void BleTransport::connectToDevice()
+{
+    _closed = false;
+    _pController->connectToDevice();
+}
+
+void BleTransport::disconnectFromDevice()
+{
+    _pController->disconnectFromDevice();
+}
+
+bool BleTransport::write(const QByteArray& packet)
+{
+    if(!_chars.count(Sensor::txUuid))
+        return false;
+
+    const auto& c = _chars.value(Sensor::txUuid);
+    if(!c.isValid())
+        return false;
+
+    _svc->writeCharacteristic(c, packet);
+    return true;
+}
+
+QBluetoothAddress BleTransport::localAdapter() const
+{
+    return _localAdapter;
+}
+
+void BleTransport::onServiceDiscovered(const QBluetoothUuid& uuid)
+{
+    qInfo("Found service: %s", uuid.toString().toStdString().c_str());
+
+    if (uuid == Sensor::serviceUuid)
+    {
+        qInfo("Offline mode GATT service found!");
+        _svc = _pController->createServiceObject(uuid, this);
+        connect(_svc, &QLowEnergyService::stateChanged, this, &BleTransport::onServiceStateChanged);
+        connect(_svc, &QLowEnergyService::characteristicChanged, this, &BleTransport::onCharacteristicChanged);
+        _svc->discoverDetails();
+    }
+}
+
+void BleTransport::onServiceStateChanged(QLowEnergyService::ServiceState state)
+{
+    switch(state)
+    {
+    case QLowEnergyService::RemoteServiceDiscovering:
+    {
+        emit discovering();
+        break;
+    }
+    case QLowEnergyService::RemoteServiceDiscovered:
+    {
+        qInfo("Service discovered.");
+        for(auto& c : _svc->characteristics())
+        {
+            qInfo("Found characteristic %s", c.uuid().toString().toStdString().c_str());
+            _chars[c.uuid()] = c;
+
+            if(c.uuid() == Sensor::rxUuid)
+            {
+                auto desc = c.descriptor(QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration);
+                if (desc.isValid())
+                {
+                    // Enable notifications
+                    _svc->writeDescriptor(desc, QByteArray::fromHex("0100"));
+                }
+                else
+                {
+                    qInfo("Client characteristic configuration descriptor is not valid");
+                }
+            }
+        }
+        emit ready();
+        break;
+    }
+    default:
+    {
+        qInfo("Service state change: %d", state);
+        break;
+    }
+    }
+}
+
+void BleTransport::onCharacteristicChanged(const QLowEnergyCharacteristic& c, const QByteArray& value)
+{
+    qInfo("Characteristic changed: %s", c.uuid().toString().toStdString().c_str());
+    emit received(value);
+}
+
+void BleTransport::onControllerError(QLowEnergyController::Error error)
+{
+    qInfo("Controller error: %d", error);
+    emit errorOccurred(LinkError);
+
+    // A failed connection attempt doesn't end in a disconnect of the controller,
+    // the sensor would be left connecting for good
+    if(!_connected)
+    {
+        _pController->disconnectFromDevice();
+        onControllerDisconnected();
+    }
+}
+
+void BleTransport::onControllerDisconnected()
+{
+    _connected = false;
+    if(_closed)
+        return;
+
+    _closed = true;
+    emit disconnected();
+}
+
+void BleTransport::onFinishServiceDiscovery()
+{
+    qInfo("Ending service discovery");
+
+    if (!_svc)
+    {
+        emit errorOccurred(UnsupportedDevice);
+        disconnectFromDevice();
+    }
+    else
+    {
+        _connected = true;
+        emit connected();
+    }
+}
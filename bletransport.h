@@ -0,0 +1,44 @@
+#ifndef BLETRANSPORT_H
+#define BLETRANSPORT_H
+
+#include "sensortransport.h"
+
+#include <QBluetoothDeviceInfo>
+#include <QLowEnergyController>
+#include <QLowEnergyService>
+#include <QMap>
+
+/*
+ * Transport over the sensor's offline GATT service. Packets are written to
+ * its TX characteristic and received as notifications of the RX one. The
+ * local adapter comes from the AdapterPool.
+ */
+class BleTransport : public SensorTransport
+{
+    Q_OBJECT
+
+public:
+    explicit BleTransport(const QBluetoothDeviceInfo& info, QObject* parent = nullptr);
+
+    void connectToDevice() override;
+    void disconnectFromDevice() override;
+    bool write(const QByteArray& packet) override;
+    QBluetoothAddress localAdapter() const override;
+
+private:
+    void onServiceDiscovered(const QBluetoothUuid& uuid);
+    void onServiceStateChanged(QLowEnergyService::ServiceState state);
+    void onCharacteristicChanged(const QLowEnergyCharacteristic& c, const QByteArray& value);
+    void onControllerError(QLowEnergyController::Error error);
+    void onControllerDisconnected();
+    void onFinishServiceDiscovery();
+
+    QBluetoothAddress _localAdapter;
+    QLowEnergyController* _pController;
+    QLowEnergyService* _svc;
+    QMap<QUuid, QLowEnergyCharacteristic> _chars;
+    bool _connected = false;
+    bool _closed = true; // disconnected() was emitted since the last connection attempt
+};
+
+#endif // BLETRANSPORT_H
@@ -0,0 +1,317 @@
+#include "headlessclient.h"
+#include "jobrunner.h"
+#include "downloadscheduler.h"
+#include "syncengine.h"
+#include "sessionmanager.h"
+#include "configjson.h"
+#include "diskwriter.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QLoggingCategory>
+#include <QSettings>
+#include <QTextStream>
+
+#include <functional>
+
+enum ExitCode
+{
+    ExitSuccess = 0,
+    ExitFailure = 1,
+    ExitUsage = 2,
+};
+
+static void printEvent(const QJsonObject& event)
+{
+    // One JSON object per line, flushed so a reading process sees events as they happen
+    static QTextStream out(stdout);
+    out << QJsonDocument(event).toJson(QJsonDocument::Compact) << Qt::endl;
+}
+
+static bool writeReport(const QString& path, const QJsonObject& summary)
+{
+    if(path.isEmpty())
+        return true;
+
+    QFile report(path);
+    if(!report.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || report.write(QJsonDocument(summary).toJson()) < 0)
+    {
+        printEvent({ { "event", "error" }, { "message", "Failed to write " + path } });
+        return false;
+    }
+    return true;
+}
+
+static int usageError(const QString& message)
+{
+    printEvent({ { "event", "error" }, { "message", message } });
+    return ExitUsage;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // Shares settings and caches with the GUI
+    QCoreApplication::setOrganizationName("Movesense");
+    QCoreApplication::setApplicationName("movesense-offline-configurator");
+
+    // Logs and recordings still queued for the disk writer are completed before exiting
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, []() { DiskWriter::instance().flush(); });
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Headless Movesense offline sensor tool. Results are written to stdout as JSON lines.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "scan, config, configure, time, list, download, sync, erase, stream, run or drain");
+
+    QCommandLineOption deviceOption({ "d", "device" }, "Sensor address (UUID on macOS) or name, repeat for several with drain.", "device");
+    QCommandLineOption timeoutOption("timeout", "Seconds to scan, or to search for the device (default 10).", "seconds", "10");
+    QCommandLineOption configOption({ "c", "config" }, "JSON configuration for configure, - for stdin.", "file");
+    QCommandLineOption logOption({ "l", "log" }, "Log id to download, repeat for several (default all).", "id");
+    QCommandLineOption outputOption({ "o", "output" }, "Directory for downloaded logs (default .).", "dir", ".");
+    QCommandLineOption archiveOption({ "a", "archive" }, "Archive directory to sync logs into.", "dir");
+    QCommandLineOption eraseOption("erase", "Erase the logs after syncing once all are archived.");
+    QCommandLineOption levelOption("level", "Stream level: fatal, error, warning, info or verbose.", "level", "info");
+    QCommandLineOption durationOption("duration", "Seconds to stream, 0 until disconnected (default 0).", "seconds", "0");
+    QCommandLineOption dictionaryOption("dictionary", "Format dictionary for encoded log messages.", "file");
+    QCommandLineOption jobOption({ "j", "job" }, "Job file to run on many sensors.", "file");
+    QCommandLineOption reportOption("report", "File to write the run or drain summary to.", "file");
+    QCommandLineOption concurrencyOption("concurrency", "Sensors to drain at a time (default from settings).", "count");
+    QCommandLineOption verboseOption({ "v", "verbose" }, "Print protocol diagnostics to stderr.");
+    parser.addOptions({ deviceOption, timeoutOption, configOption, logOption, outputOption,
+        archiveOption, eraseOption, levelOption, durationOption, dictionaryOption, jobOption, reportOption, concurrencyOption, verboseOption });
+
+    parser.process(app);
+
+    if(!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules("default.info=false");
+
+    const QStringList args = parser.positionalArguments();
+    if(args.size() != 1)
+        return usageError("Expected exactly one command, see --help");
+
+    const QString command = args.front();
+    const int timeoutMs = parser.value(timeoutOption).toInt() * 1000;
+
+    if(command == "run")
+    {
+        if(!parser.isSet(jobOption))
+            return usageError("The run command needs --job");
+
+        JobRunner runner;
+        QString error;
+        if(!runner.load(parser.value(jobOption), &error))
+            return usageError("Invalid job: " + error);
+
+        const QString reportPath = parser.value(reportOption);
+        QObject::connect(&runner, &JobRunner::event, &printEvent);
+        QObject::connect(&runner, &JobRunner::finished, &app, [&](bool success) {
+            if(!writeReport(reportPath, runner.summary()))
+                success = false;
+            app.exit(success ? ExitSuccess : ExitFailure);
+        });
+
+        QMetaObject::invokeMethod(&runner, &JobRunner::start, Qt::QueuedConnection);
+        return app.exec();
+    }
+
+    if(command == "drain")
+    {
+        QSettings settings;
+        int concurrency = settings.value("sessions/maxConnections", SessionManager::DEFAULT_MAX_CONNECTIONS).toInt();
+        if(parser.isSet(concurrencyOption))
+        {
+            bool ok = false;
+            concurrency = parser.value(concurrencyOption).toInt(&ok);
+            if(!ok || concurrency < 1)
+                return usageError("Invalid concurrency: " + parser.value(concurrencyOption));
+        }
+
+        DownloadScheduler scheduler;
+        scheduler.setTargets(parser.values(deviceOption));
+        scheduler.setOutputDirectory(parser.value(outputOption));
+        scheduler.setConcurrency(concurrency);
+        scheduler.setScanTimeout(timeoutMs);
+
+        const QString reportPath = parser.value(reportOption);
+        QObject::connect(&scheduler, &DownloadScheduler::event, &printEvent);
+        QObject::connect(&scheduler, &DownloadScheduler::finished, &app, [&](bool success) {
+            if(!writeReport(reportPath, scheduler.summary()))
+                success = false;
+            app.exit(success ? ExitSuccess : ExitFailure);
+        });
+
+        QMetaObject::invokeMethod(&scheduler, &DownloadScheduler::start, Qt::QueuedConnection);
+        return app.exec();
+    }
+
+    HeadlessClient client;
+    SyncEngine sync(&client);
+    QObject::connect(&client, &HeadlessClient::event, [&sync](const QJsonObject& event) {
+        // The sync engine forwards the client's events while it runs
+        if(!sync.isRunning())
+            printEvent(event);
+    });
+    QObject::connect(&sync, &SyncEngine::event, &printEvent);
+
+    // Each step starts one client operation, the next one runs when it has finished
+    QList<std::function<void()>> steps;
+
+    if(command == "scan")
+    {
+        steps.push_back([&]() { client.scan(timeoutMs); });
+    }
+    else
+    {
+        if(!parser.isSet(deviceOption))
+            return usageError("The " + command + " command needs --device");
+
+        QJsonObject configJson;
+        if(command == "configure")
+        {
+            if(!parser.isSet(configOption))
+                return usageError("The configure command needs --config");
+
+            QFile file;
+            const QString path = parser.value(configOption);
+            bool opened = false;
+            if(path == "-")
+            {
+                opened = file.open(stdin, QIODevice::ReadOnly);
+            }
+            else
+            {
+                file.setFileName(path);
+                opened = file.open(QIODevice::ReadOnly);
+            }
+            if(!opened)
+                return usageError("Cannot read " + path);
+
+            QJsonParseError parseError;
+            QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+            if(!doc.isObject())
+                return usageError("Invalid configuration: " + parseError.errorString());
+            configJson = doc.object();
+
+            // Checked against a default configuration before connecting
+            OfflineConfig check;
+            QString error;
+            if(!ConfigJson::fromJson(configJson, &check, &error))
+                return usageError("Invalid configuration: " + error);
+        }
+
+        QList<uint32_t> logIds;
+        for(const auto& value : parser.values(logOption))
+        {
+            bool ok = false;
+            logIds.push_back(value.toUInt(&ok));
+            if(!ok)
+                return usageError("Invalid log id: " + value);
+        }
+
+        static const QStringList LEVELS = { "fatal", "error", "warning", "info", "verbose" };
+        const int level = LEVELS.indexOf(parser.value(levelOption));
+        if(level < 0)
+            return usageError("Invalid level: " + parser.value(levelOption));
+
+        if(parser.isSet(dictionaryOption))
+        {
+            QString error;
+            if(!client.dictionary().load(parser.value(dictionaryOption), &error))
+                return usageError("Failed to load dictionary: " + error);
+        }
+
+        const QString device = parser.value(deviceOption);
+        steps.push_back([&client, device, timeoutMs]() { client.connectDevice(device, timeoutMs); });
+
+        if(command == "config")
+        {
+            steps.push_back([&client]() { client.readConfig(); });
+        }
+        else if(command == "configure")
+        {
+            steps.push_back([&client, configJson]() {
+                // Keys missing from the file keep the sensor's current values
+                OfflineConfig config = client.config();
+                ConfigJson::fromJson(configJson, &config);
+                client.writeConfig(config);
+            });
+        }
+        else if(command == "time")
+        {
+            steps.push_back([&client]() { client.syncTime(); });
+        }
+        else if(command == "list")
+        {
+            steps.push_back([&client]() { client.listLogs(); });
+        }
+        else if(command == "download")
+        {
+            const QString output = parser.value(outputOption);
+            steps.push_back([&client, logIds, output]() { client.downloadLogs(logIds, output); });
+        }
+        else if(command == "sync")
+        {
+            if(!parser.isSet(archiveOption))
+                return usageError("The sync command needs --archive");
+
+            const QString archive = parser.value(archiveOption);
+            const bool erase = parser.isSet(eraseOption);
+            steps.push_back([&sync, archive, erase]() { sync.start(archive, erase); });
+        }
+        else if(command == "erase")
+        {
+            steps.push_back([&client]() { client.eraseLogs(); });
+        }
+        else if(command == "stream")
+        {
+            const int durationMs = parser.value(durationOption).toInt() * 1000;
+            steps.push_back([&client, level, durationMs]() {
+                client.streamLogs((CommandPacket::Params::DebugLogParams::LogLevel) level, durationMs);
+            });
+        }
+        else
+        {
+            return usageError("Unknown command: " + command);
+        }
+
+        steps.push_back([&client]() { client.disconnectDevice(); });
+    }
+
+    int exitCode = ExitSuccess;
+    bool disconnecting = false;
+    auto onFinished = [&](bool success, const QString& error) {
+        if(!success && !disconnecting)
+        {
+            printEvent({ { "event", "error" }, { "message", error } });
+            exitCode = ExitFailure;
+
+            // Skip to leaving the sensor disconnected
+            disconnecting = true;
+            client.disconnectDevice();
+            return;
+        }
+
+        if(steps.isEmpty() || disconnecting)
+        {
+            if(exitCode == ExitSuccess)
+                printEvent({ { "event", "done" } });
+            app.exit(exitCode);
+            return;
+        }
+
+        steps.takeFirst()();
+    };
+    QObject::connect(&client, &HeadlessClient::finished, &app, [&](bool success, const QString& error) {
+        // A sync runs several client operations and finishes on its own
+        if(!sync.isRunning())
+            onFinished(success, error);
+    });
+    QObject::connect(&sync, &SyncEngine::finished, &app, onFinished);
+
+    QMetaObject::invokeMethod(&app, [&]() { steps.takeFirst()(); }, Qt::QueuedConnection);
+    return app.exec();
+}
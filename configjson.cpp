@@ -0,0 +1,170 @@
+#include "configjson.h"
+#include "protocol/ProtocolConstants.hpp"
+
+#include <QJsonArray>
+#include <QStringList>
+
+#include <algorithm>
+
+static const QPair<const char*, OfflineConfig::WakeUpBehavior> WAKE_UP_NAMES[] = {
+    { "alwaysOn", OfflineConfig::WakeUpAlwaysOn },
+    { "connector", OfflineConfig::WakeUpConnector },
+    { "movement", OfflineConfig::WakeUpMovement },
+    { "doubleTap", OfflineConfig::WakeUpDoubleTap },
+};
+
+static const QPair<const char*, OfflineConfig::OptionsFlags> OPTION_NAMES[] = {
+    { "logTapGestures", OfflineConfig::OptionsLogTapGestures },
+    { "logShakeGestures", OfflineConfig::OptionsLogShakeGestures },
+    { "compressECG", OfflineConfig::OptionsCompressECG },
+    { "shakeToConnect", OfflineConfig::OptionsShakeToConnect },
+    { "tripleTapToStartLog", OfflineConfig::OptionsTripleTapToStartLog },
+};
+
+// Indexed by OfflineConfig::Measurement
+static const char* const MEASUREMENT_NAMES[OfflineConfig::MeasCount] = {
+    "ecg",
+    "heartRate",
+    "rtoR",
+    "acc",
+    "gyro",
+    "magn",
+    "temp",
+    "activity",
+};
+
+struct AllowedValues
+{
+    template<size_t N>
+    constexpr AllowedValues(const uint16_t (&values)[N]) : begin(values), end(values + N) {}
+
+    const uint16_t* begin;
+    const uint16_t* end;
+};
+
+// Indexed by OfflineConfig::Measurement, the same value lists the settings panel offers
+static const AllowedValues MEASUREMENT_VALUES[OfflineConfig::MeasCount] = {
+    SENSOR_MEAS_SAMPLERATES_ECG,
+    SENSOR_MEAS_TOGGLE,
+    SENSOR_MEAS_TOGGLE,
+    SENSOR_MEAS_SAMPLERATES_IMU,
+    SENSOR_MEAS_SAMPLERATES_IMU,
+    SENSOR_MEAS_SAMPLERATES_IMU,
+    SENSOR_MEAS_TOGGLE,
+    SENSOR_MEAS_PRESETS_ACTIVITY_INTERVALS,
+};
+
+static bool fail(QString* error, const QString& message)
+{
+    if(error)
+        *error = message;
+    return false;
+}
+
+QJsonObject ConfigJson::toJson(const OfflineConfig& config)
+{
+    QJsonObject json;
+
+    for(const auto& wakeUp : WAKE_UP_NAMES)
+    {
+        if(wakeUp.second == config.wakeUpBehavior)
+            json["wakeUp"] = wakeUp.first;
+    }
+
+    json["sleepDelay"] = config.sleepDelay;
+
+    QJsonArray options;
+    for(const auto& option : OPTION_NAMES)
+    {
+        if(config.optionsFlags & option.second)
+            options.append(option.first);
+    }
+    json["options"] = options;
+
+    QJsonObject measurements;
+    for(int i = 0; i < OfflineConfig::MeasCount; i++)
+        measurements[MEASUREMENT_NAMES[i]] = config.measurementParams.array[i];
+    json["measurements"] = measurements;
+
+    return json;
+}
+
+bool ConfigJson::fromJson(const QJsonObject& json, OfflineConfig* config, QString* error)
+{
+    OfflineConfig result = *config;
+
+    if(json.contains("wakeUp"))
+    {
+        const QString name = json["wakeUp"].toString();
+        bool found = false;
+        for(const auto& wakeUp : WAKE_UP_NAMES)
+        {
+            if(name == wakeUp.first)
+            {
+                result.wakeUpBehavior = wakeUp.second;
+                found = true;
+            }
+        }
+        if(!found)
+            return fail(error, "Unknown wakeUp value: " + name);
+    }
+
+    if(json.contains("sleepDelay"))
+    {
+        const int delay = json["sleepDelay"].toInt(-1);
+        if(delay < 0 || delay > UINT16_MAX)
+            return fail(error, "sleepDelay must be 0-65535 seconds");
+        result.sleepDelay = (uint16_t) delay;
+    }
+
+    if(json.contains("options"))
+    {
+        result.optionsFlags = 0;
+        for(const auto& value : json["options"].toArray())
+        {
+            const QString name = value.toString();
+            bool found = false;
+            for(const auto& option : OPTION_NAMES)
+            {
+                if(name == option.first)
+                {
+                    result.optionsFlags |= option.second;
+                    found = true;
+                }
+            }
+            if(!found)
+                return fail(error, "Unknown option: " + name);
+        }
+    }
+
+    if(json.contains("measurements"))
+    {
+        const QJsonObject measurements = json["measurements"].toObject();
+        for(auto it = measurements.begin(); it != measurements.end(); it++)
+        {
+            int meas = -1;
+            for(int i = 0; i < OfflineConfig::MeasCount; i++)
+            {
+                if(it.key() == MEASUREMENT_NAMES[i])
+                    meas = i;
+            }
+            if(meas < 0)
+                return fail(error, "Unknown measurement: " + it.key());
+
+            const int value = it.value().toInt(-1);
+            const auto& allowed = MEASUREMENT_VALUES[meas];
+            if(std::find(allowed.begin, allowed.end, value) == allowed.end)
+            {
+                QStringList values;
+                for(const uint16_t* v = allowed.begin; v != allowed.end; v++)
+                    values.append(QString::number(*v));
+                return fail(error, QString("Invalid value %1 for measurement %2, allowed values are %3")
+                    .arg(it.value().toVariant().toString(), it.key(), values.join(", ")));
+            }
+            result.measurementParams.array[meas] = (uint16_t) value;
+        }
+    }
+
+    *config = result;
+    return true;
+}
@@ -0,0 +1,28 @@
+#ifndef CONFIGJSON_H
+#define CONFIGJSON_H
+
+#include <QJsonObject>
+#include <QString>
+
+#include "protocol/Protocol.hpp"
+
+/*
+ * JSON form of OfflineConfig for scripts and the command-line front end:
+ *
+ *   {
+ *     "wakeUp": "connector",
+ *     "sleepDelay": 1800,
+ *     "options": [ "logTapGestures" ],
+ *     "measurements": { "ecg": 125, "heartRate": 1, "acc": 0, ... }
+ *   }
+ *
+ * Missing keys keep the values of the configuration being updated, so a file
+ * can change just a few settings on top of the one read from the sensor.
+ */
+namespace ConfigJson
+{
+    QJsonObject toJson(const OfflineConfig& config);
+    bool fromJson(const QJsonObject& json, OfflineConfig* config, QString* error = nullptr);
+}
+
+#endif // CONFIGJSON_H
@@ -0,0 +1,47 @@
+#include "diskwriter.h"
+#include "sensordaemon.h"
+#include "sessionmanager.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QLoggingCategory>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // Shares settings and caches with the GUI
+    QCoreApplication::setOrganizationName("Movesense");
+    QCoreApplication::setApplicationName("movesense-offline-configurator");
+
+    // Logs and recordings still queued for the disk writer are completed before exiting
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, []() { DiskWriter::instance().flush(); });
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Movesense sensor daemon. Shares sensor connections with local clients over a local socket.");
+    parser.addHelpOption();
+
+    QCommandLineOption nameOption("name", "Server name or socket path.", "name", SensorDaemon::defaultServerName());
+    QCommandLineOption verboseOption({ "v", "verbose" }, "Print protocol diagnostics to stderr.");
+    parser.addOptions({ nameOption, verboseOption });
+    parser.process(app);
+
+    if(!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules("default.info=false");
+
+    SessionManager sessions;
+    SensorDaemon daemon(&sessions);
+
+    QTextStream err(stderr);
+    QString error;
+    if(!daemon.listen(parser.value(nameOption), &error))
+    {
+        err << "Failed to listen on " << parser.value(nameOption) << ": " << error << Qt::endl;
+        return 1;
+    }
+    err << "Listening on " << daemon.fullServerName() << Qt::endl;
+
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, &sessions, &SessionManager::closeAll);
+    return app.exec();
+}
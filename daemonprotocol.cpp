@@ -0,0 +1,46 @@
+#include "daemonprotocol.h"
+
+namespace DaemonProtocol
+{
+
+QByteArray encode(FrameType type, const QByteArray& payload)
+{
+    const int length = 1 + qMin((int) payload.size(), MAX_PAYLOAD_SIZE);
+
+    QByteArray frame;
+    frame.reserve(2 + length);
+    frame.append((char) (length & 0xFF));
+    frame.append((char) (length >> 8));
+    frame.append((char) type);
+    frame.append(payload.left(length - 1));
+    return frame;
+}
+
+std::optional<Frame> take(QByteArray& buffer)
+{
+    if(buffer.size() < 2)
+        return std::nullopt;
+
+    const int length = (uint8_t) buffer[0] | ((uint8_t) buffer[1] << 8);
+    if(buffer.size() < 2 + length)
+        return std::nullopt;
+
+    // A frame without a type is passed on as type zero, which no side accepts
+    Frame frame;
+    frame.type = length > 0 ? (FrameType) (uint8_t) buffer[2] : (FrameType) 0;
+    frame.payload = length > 0 ? buffer.mid(HEADER_SIZE, length - 1) : QByteArray();
+    buffer.remove(0, 2 + length);
+    return frame;
+}
+
+QByteArray channelPayload(uint8_t channel, const QByteArray& data)
+{
+    return QByteArray(1, (char) channel) + data;
+}
+
+QByteArray errorPayload(uint8_t channel, const QString& message)
+{
+    return QByteArray(1, (char) channel) + message.toUtf8();
+}
+
+}
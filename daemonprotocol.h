@@ -0,0 +1,55 @@
+#ifndef DAEMONPROTOCOL_H
+#define DAEMONPROTOCOL_H
+
+#include <QByteArray>
+#include <QString>
+#include <optional>
+
+/*
+ * Framing between the sensor daemon and its local clients. Each frame is
+ *
+ *   u16 length (little-endian, of what follows) | u8 type | payload
+ *
+ * Sensor traffic is carried as encoded protocol packets, so clients use the
+ * packet codec of the protocol library as they would over Bluetooth. Each open
+ * sensor is addressed by a one-byte channel chosen by the daemon.
+ */
+namespace DaemonProtocol
+{
+    constexpr int HEADER_SIZE = 3;
+    constexpr int MAX_PAYLOAD_SIZE = 0xFFFF - 1;
+    constexpr uint8_t NO_CHANNEL = 0xFF;
+
+    enum FrameType : uint8_t
+    {
+        // Client to daemon
+        FrameScan = 0x01,   // u32 duration in ms
+        FrameOpen = 0x02,   // Device address (UUID on macOS), UTF-8
+        FrameClose = 0x03,  // u8 channel
+        FramePacket = 0x04, // u8 channel | encoded packet
+
+        // Daemon to client
+        FrameDevice = 0x81,    // i16 rssi | u8 address length | address | u8 name length | name | advertisement
+        FrameScanDone = 0x82,  // Empty
+        FrameOpened = 0x83,    // u8 channel | device address, sent once the sensor's configuration is known
+        FrameClosed = 0x84,    // u8 channel
+        FrameReceived = 0x85,  // u8 channel | encoded packet
+        FrameError = 0x86,     // u8 channel or NO_CHANNEL | message, UTF-8
+    };
+
+    struct Frame
+    {
+        FrameType type;
+        QByteArray payload;
+    };
+
+    QByteArray encode(FrameType type, const QByteArray& payload = QByteArray());
+
+    // Takes the first complete frame from the buffer, if there is one
+    std::optional<Frame> take(QByteArray& buffer);
+
+    QByteArray channelPayload(uint8_t channel, const QByteArray& data);
+    QByteArray errorPayload(uint8_t channel, const QString& message);
+}
+
+#endif // DAEMONPROTOCOL_H
@@ -0,0 +1,355 @@
+#include "debuglogrecorder.h"
+#include "stallmonitor.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QtEndian>
+#include <limits>
+
+static const QByteArray SEGMENT_MAGIC = "MDLG";
+static constexpr quint16 SEGMENT_VERSION = 1;
+static constexpr qint64 SEGMENT_HEADER_SIZE = 6;
+static constexpr qint64 RECORD_HEADER_SIZE = 18;
+static constexpr qint64 INDEX_ENTRY_SIZE = 33;
+
+enum RecordFlags : quint8
+{
+    RecordEncoded = (1 << 0),
+};
+
+static QByteArray encodeRecord(const LogRecord& record)
+{
+    const LogMessage& msg = record.message;
+    const quint16 length = (quint16) (RECORD_HEADER_SIZE - 2 + msg.payload.size());
+
+    QByteArray bytes(RECORD_HEADER_SIZE, 0);
+    uchar* ptr = (uchar*) bytes.data();
+    qToLittleEndian<quint16>(length, ptr);
+    qToLittleEndian<qint64>(record.hostTime, ptr + 2);
+    qToLittleEndian<quint32>(msg.timestamp, ptr + 10);
+    ptr[14] = msg.level;
+    ptr[15] = msg.encoded ? RecordEncoded : 0;
+    qToLittleEndian<quint16>(msg.formatId, ptr + 16);
+    bytes.append(msg.payload);
+    return bytes;
+}
+
+// Decodes one record at pos, returns its size or 0 if the data is incomplete
+static qint64 decodeRecord(const QByteArray& data, qint64 pos, LogRecord* record)
+{
+    if(pos + RECORD_HEADER_SIZE > data.size())
+        return 0;
+
+    const uchar* ptr = (const uchar*) data.constData() + pos;
+    const qint64 size = 2 + qFromLittleEndian<quint16>(ptr);
+    if(size < RECORD_HEADER_SIZE || pos + size > data.size())
+        return 0;
+
+    record->hostTime = qFromLittleEndian<qint64>(ptr + 2);
+    record->message.timestamp = qFromLittleEndian<quint32>(ptr + 10);
+    record->message.level = ptr[14];
+    record->message.encoded = (ptr[15] & RecordEncoded) != 0;
+    record->message.formatId = qFromLittleEndian<quint16>(ptr + 16);
+    record->message.payload = data.mid(pos + RECORD_HEADER_SIZE, size - RECORD_HEADER_SIZE);
+    return size;
+}
+
+static quint8 levelMaskUpTo(uint8_t maxLevel)
+{
+    return maxLevel >= 7 ? 0xFF : (quint8) ((1 << (maxLevel + 1)) - 1);
+}
+
+DebugLogRecorder::DebugLogRecorder()
+{
+}
+
+DebugLogRecorder::~DebugLogRecorder()
+{
+    close();
+}
+
+QString DebugLogRecorder::defaultDirectory(const QString& deviceId)
+{
+    QString id = deviceId;
+    id.replace(':', '-');
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/debuglog/" + id;
+}
+
+bool DebugLogRecorder::open(const QString& directory)
+{
+    close();
+    if(!QDir().mkpath(directory))
+        return false;
+
+    _directory = directory;
+    return true;
+}
+
+void DebugLogRecorder::close()
+{
+    closeSegment();
+    _directory.clear();
+}
+
+bool DebugLogRecorder::isOpen() const
+{
+    return !_directory.isEmpty();
+}
+
+QString DebugLogRecorder::directory() const
+{
+    return _directory;
+}
+
+void DebugLogRecorder::append(const LogMessage& message)
+{
+    append(LogRecord { QDateTime::currentMSecsSinceEpoch(), message });
+}
+
+void DebugLogRecorder::append(const LogRecord& record)
+{
+    if(!isOpen())
+        return;
+
+    if(_segment.isOpen() && _segment.pos() >= SEGMENT_SIZE)
+        closeSegment();
+
+    if(!_segment.isOpen() && !openSegment(record.hostTime))
+        return;
+
+    QByteArray bytes = encodeRecord(record);
+    if(_block.count == 0)
+    {
+        _block.firstTime = record.hostTime;
+        _block.offset = _segment.pos();
+    }
+
+    _segment.write(bytes);
+    _block.lastTime = record.hostTime;
+    _block.length += bytes.size();
+    _block.count++;
+    _block.levelMask |= (quint8) (1 << qMin<int>(record.message.level, 7));
+
+    if(_block.count >= BLOCK_RECORDS)
+        writeIndexEntry();
+}
+
+QList<LogRecord> DebugLogRecorder::query(qint64 from, qint64 to, uint8_t maxLevel, int limit) const
+{
+    StallMonitor::Scope scope("DebugLogRecorder::query");
+
+    QList<LogRecord> results;
+    const quint8 mask = levelMaskUpTo(maxLevel);
+
+    // Make the active segment's buffered records visible to the reader
+    if(_segment.isOpen())
+        const_cast<QFile&>(_segment).flush();
+
+    auto collect = [&](const QByteArray& data) {
+        qint64 pos = 0;
+        LogRecord record;
+        while(results.size() < limit)
+        {
+            qint64 size = decodeRecord(data, pos, &record);
+            if(size == 0)
+                break;
+            pos += size;
+
+            if(record.hostTime >= from && record.hostTime <= to && record.message.level <= maxLevel)
+                results.push_back(record);
+        }
+    };
+
+    const QStringList segments = segmentPaths();
+    for(int s = 0; s < segments.size() && results.size() < limit; s++)
+    {
+        // Segments are named by the time of their first record
+        if(s + 1 < segments.size())
+        {
+            qint64 nextStart = QFileInfo(segments[s + 1]).baseName().mid(8).toLongLong();
+            if(nextStart < from)
+                continue;
+        }
+
+        QFile file(segments[s]);
+        if(!file.open(QIODevice::ReadOnly))
+            continue;
+
+        qint64 tailOffset = SEGMENT_HEADER_SIZE;
+        for(const auto& entry : readIndex(segments[s]))
+        {
+            tailOffset = entry.offset + entry.length;
+            if(entry.lastTime < from || entry.firstTime > to || !(entry.levelMask & mask))
+                continue;
+
+            file.seek(entry.offset);
+            collect(file.read(entry.length));
+            if(results.size() >= limit)
+                break;
+        }
+
+        if(results.size() < limit && file.size() > tailOffset)
+        {
+            file.seek(tailOffset);
+            collect(file.readAll());
+        }
+    }
+
+    return results;
+}
+
+bool DebugLogRecorder::timeRange(qint64* first, qint64* last) const
+{
+    const QStringList segments = segmentPaths();
+    if(segments.isEmpty())
+        return false;
+
+    QList<LogRecord> head = query(0, std::numeric_limits<qint64>::max(), 0xFF, 1);
+    if(head.isEmpty())
+        return false;
+    *first = head.front().hostTime;
+
+    // Last record is in the newest segment, either indexed or in its tail
+    if(_segment.isOpen())
+        const_cast<QFile&>(_segment).flush();
+
+    *last = *first;
+    QFile file(segments.back());
+    if(file.open(QIODevice::ReadOnly))
+    {
+        qint64 tailOffset = SEGMENT_HEADER_SIZE;
+        auto entries = readIndex(segments.back());
+        if(!entries.isEmpty())
+        {
+            *last = entries.back().lastTime;
+            tailOffset = entries.back().offset + entries.back().length;
+        }
+
+        file.seek(tailOffset);
+        QByteArray tail = file.readAll();
+        qint64 pos = 0;
+        LogRecord record;
+        while(qint64 size = decodeRecord(tail, pos, &record))
+        {
+            *last = record.hostTime;
+            pos += size;
+        }
+    }
+    return true;
+}
+
+QStringList DebugLogRecorder::segmentPaths() const
+{
+    QStringList paths;
+    if(_directory.isEmpty())
+        return paths;
+
+    QDir dir(_directory);
+    for(const auto& name : dir.entryList({ "segment-*.mlog" }, QDir::Files, QDir::Name))
+        paths.push_back(dir.filePath(name));
+    return paths;
+}
+
+QList<DebugLogRecorder::IndexEntry> DebugLogRecorder::readIndex(const QString& segmentPath)
+{
+    QList<IndexEntry> entries;
+    QFile file(indexPath(segmentPath));
+    if(!file.open(QIODevice::ReadOnly))
+        return entries;
+
+    const QByteArray data = file.readAll();
+    for(qint64 pos = 0; pos + INDEX_ENTRY_SIZE <= data.size(); pos += INDEX_ENTRY_SIZE)
+    {
+        const uchar* ptr = (const uchar*) data.constData() + pos;
+        IndexEntry entry;
+        entry.firstTime = qFromLittleEndian<qint64>(ptr);
+        entry.lastTime = qFromLittleEndian<qint64>(ptr + 8);
+        entry.offset = qFromLittleEndian<quint64>(ptr + 16);
+        entry.length = qFromLittleEndian<quint32>(ptr + 24);
+        entry.count = qFromLittleEndian<quint32>(ptr + 28);
+        entry.levelMask = ptr[32];
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+QString DebugLogRecorder::indexPath(const QString& segmentPath)
+{
+    QString path = segmentPath;
+    path.chop(4);
+    return path + "idx";
+}
+
+bool DebugLogRecorder::openSegment(qint64 firstTime)
+{
+    removeOldSegments();
+
+    QString name = QString::asprintf("segment-%016lld.mlog", (long long) firstTime);
+    QString path = QDir(_directory).filePath(name);
+
+    _segment.setFileName(path);
+    _index.setFileName(indexPath(path));
+    if(!_segment.open(QIODevice::WriteOnly | QIODevice::Append) ||
+       !_index.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        _segment.close();
+        _index.close();
+        return false;
+    }
+
+    if(_segment.size() == 0)
+    {
+        QByteArray header = SEGMENT_MAGIC;
+        header.resize(SEGMENT_HEADER_SIZE);
+        qToLittleEndian<quint16>(SEGMENT_VERSION, header.data() + 4);
+        _segment.write(header);
+    }
+
+    _block = IndexEntry();
+    return true;
+}
+
+void DebugLogRecorder::closeSegment()
+{
+    if(!_segment.isOpen())
+        return;
+
+    writeIndexEntry();
+    _segment.close();
+    _index.close();
+}
+
+void DebugLogRecorder::writeIndexEntry()
+{
+    if(_block.count == 0)
+        return;
+
+    QByteArray bytes(INDEX_ENTRY_SIZE, 0);
+    uchar* ptr = (uchar*) bytes.data();
+    qToLittleEndian<qint64>(_block.firstTime, ptr);
+    qToLittleEndian<qint64>(_block.lastTime, ptr + 8);
+    qToLittleEndian<quint64>(_block.offset, ptr + 16);
+    qToLittleEndian<quint32>(_block.length, ptr + 24);
+    qToLittleEndian<quint32>(_block.count, ptr + 28);
+    ptr[32] = _block.levelMask;
+
+    // Block data must be on disk before the index refers to it
+    _segment.flush();
+    _index.write(bytes);
+    _index.flush();
+
+    _block = IndexEntry();
+}
+
+void DebugLogRecorder::removeOldSegments()
+{
+    QStringList segments = segmentPaths();
+    while(segments.size() >= MAX_SEGMENTS)
+    {
+        QString oldest = segments.takeFirst();
+        QFile::remove(oldest);
+        QFile::remove(indexPath(oldest));
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef DEBUGLOGRECORDER_H
+#define DEBUGLOGRECORDER_H
+
+#include <QFile>
+#include <QList>
+#include <QString>
+
+#include "logmessage.h"
+
+struct LogRecord
+{
+    qint64 hostTime = 0; // Milliseconds since epoch when the message was received
+    LogMessage message;
+};
+
+/*
+ * Appends debug log messages to rotating binary segment files in a directory.
+ *
+ * Records are grouped into blocks of BLOCK_RECORDS. Each segment has a
+ * sidecar index with one entry per block holding the block's time range,
+ * file offset and a mask of the levels it contains, so queries only read
+ * blocks that can match. The newest, not yet indexed part of a segment is
+ * scanned directly.
+ */
+class DebugLogRecorder
+{
+public:
+    static constexpr qint64 SEGMENT_SIZE = 4 * 1024 * 1024;
+    static constexpr int MAX_SEGMENTS = 64;
+    static constexpr quint32 BLOCK_RECORDS = 256;
+
+    DebugLogRecorder();
+    ~DebugLogRecorder();
+
+    static QString defaultDirectory(const QString& deviceId);
+
+    bool open(const QString& directory);
+    void close();
+    bool isOpen() const;
+    QString directory() const;
+
+    void append(const LogMessage& message);
+    void append(const LogRecord& record);
+
+    // Records with from <= hostTime <= to and level <= maxLevel, oldest first
+    QList<LogRecord> query(qint64 from, qint64 to, uint8_t maxLevel, int limit) const;
+    bool timeRange(qint64* first, qint64* last) const;
+
+private:
+    struct IndexEntry
+    {
+        qint64 firstTime = 0;
+        qint64 lastTime = 0;
+        quint64 offset = 0;
+        quint32 length = 0;
+        quint32 count = 0;
+        quint8 levelMask = 0;
+    };
+
+    QStringList segmentPaths() const;
+    static QList<IndexEntry> readIndex(const QString& segmentPath);
+    static QString indexPath(const QString& segmentPath);
+
+    bool openSegment(qint64 firstTime);
+    void closeSegment();
+    void writeIndexEntry();
+    void removeOldSegments();
+
+    QString _directory;
+    QFile _segment;
+    QFile _index;
+    IndexEntry _block;
+};
+
+#endif // DEBUGLOGRECORDER_H
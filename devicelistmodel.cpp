@@ -0,0 +1,180 @@
+#include "devicelistmodel.h"
+
+DeviceListModel::DeviceListModel(QObject* parent)
+    : QAbstractListModel(parent)
+{
+}
+
+QString DeviceListModel::deviceKey(const QBluetoothDeviceInfo& info)
+{
+    // Addresses are not available on macOS, it uses UUIDs instead
+    if(info.address().isNull())
+        return info.deviceUuid().toString(QUuid::WithoutBraces);
+    return info.address().toString();
+}
+
+int DeviceListModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : _devices.size();
+}
+
+QVariant DeviceListModel::data(const QModelIndex& index, int role) const
+{
+    if(!index.isValid() || index.row() >= _devices.size())
+        return QVariant();
+
+    const auto& device = _devices.at(index.row());
+    const auto& info = device.info;
+    const auto& adv = device.advertisement;
+
+    switch(role)
+    {
+    case Qt::DisplayRole:
+    {
+        QString text = info.name().isEmpty() ? info.deviceUuid().toString() : info.name();
+        if(info.rssi() != 0)
+            text += QString::asprintf(" (%d dBm)", info.rssi());
+
+        if(adv)
+        {
+            text += QString::asprintf("\nv%u.%u", adv->versionMajor, adv->versionMinor);
+            if(adv->battery != Advertisement::BATTERY_UNKNOWN)
+                text += QString::asprintf(", %u%%", adv->battery);
+            text += QString::asprintf(", %u logs", adv->logCount);
+            if(adv->status & Advertisement::StatusLogging)
+                text += ", logging";
+            if(adv->status & Advertisement::StatusFault)
+                text += ", fault";
+            if(isUpToDate(index.row()))
+                text += ", up to date";
+        }
+        return text;
+    }
+    case Qt::ToolTipRole:
+    {
+        QString text = deviceKey(info);
+        if(adv)
+            text += QString::asprintf("\nConfiguration hash: %08x", adv->configHash);
+        return text;
+    }
+    case DeviceKeyRole:
+        return deviceKey(info);
+    case RssiRole:
+        return info.rssi();
+    case BatteryRole:
+        return adv && adv->battery != Advertisement::BATTERY_UNKNOWN ? QVariant(adv->battery) : QVariant();
+    case LogCountRole:
+        return adv ? QVariant(adv->logCount) : QVariant();
+    case UpToDateRole:
+        return isUpToDate(index.row());
+    default:
+        return QVariant();
+    }
+}
+
+void DeviceListModel::update(const QList<Device>& devices)
+{
+    QList<Device> added;
+    for(const auto& device : devices)
+    {
+        QString key = deviceKey(device.info);
+        auto it = _rows.constFind(key);
+        if(it == _rows.constEnd())
+        {
+            _rows.insert(key, _devices.size() + added.size());
+            added.push_back(device);
+            continue;
+        }
+
+        const int row = it.value();
+        if(row >= _devices.size())
+        {
+            // Seen earlier in the same batch
+            added[row - _devices.size()] = device;
+            continue;
+        }
+
+        Device merged = device;
+        // Scan responses without manufacturer data keep the last known status
+        if(!merged.advertisement)
+            merged.advertisement = _devices[row].advertisement;
+
+        const bool changed = isVisiblyDifferent(_devices[row], merged);
+        _devices[row] = merged;
+        if(changed)
+            emit dataChanged(index(row), index(row));
+    }
+
+    if(!added.isEmpty())
+    {
+        beginInsertRows(QModelIndex(), _devices.size(), _devices.size() + added.size() - 1);
+        _devices.append(added);
+        endInsertRows();
+    }
+}
+
+void DeviceListModel::clear()
+{
+    beginResetModel();
+    _devices.clear();
+    _rows.clear();
+    endResetModel();
+}
+
+QBluetoothDeviceInfo DeviceListModel::device(int row) const
+{
+    if(row < 0 || row >= _devices.size())
+        return QBluetoothDeviceInfo();
+    return _devices.at(row).info;
+}
+
+std::optional<Advertisement> DeviceListModel::advertisement(int row) const
+{
+    if(row < 0 || row >= _devices.size())
+        return std::nullopt;
+    return _devices.at(row).advertisement;
+}
+
+int DeviceListModel::rowOf(const QString& key) const
+{
+    return _rows.value(key, -1);
+}
+
+void DeviceListModel::setTargetConfig(const OfflineConfig& config)
+{
+    _targetHash = Advertisement::ConfigHash(config);
+    if(!_devices.isEmpty())
+        emit dataChanged(index(0), index(_devices.size() - 1));
+}
+
+void DeviceListModel::clearTargetConfig()
+{
+    _targetHash.reset();
+    if(!_devices.isEmpty())
+        emit dataChanged(index(0), index(_devices.size() - 1));
+}
+
+bool DeviceListModel::isUpToDate(int row) const
+{
+    if(!_targetHash || row < 0 || row >= _devices.size())
+        return false;
+
+    const auto& adv = _devices.at(row).advertisement;
+    return adv && adv->configHash == *_targetHash;
+}
+
+bool DeviceListModel::isVisiblyDifferent(const Device& a, const Device& b)
+{
+    if(a.info.name() != b.info.name() || a.info.rssi() != b.info.rssi())
+        return true;
+    if(a.advertisement.has_value() != b.advertisement.has_value())
+        return true;
+    if(!a.advertisement)
+        return false;
+
+    const auto& x = *a.advertisement;
+    const auto& y = *b.advertisement;
+    return x.versionMajor != y.versionMajor || x.versionMinor != y.versionMinor
+        || x.battery != y.battery || x.status != y.status
+        || x.logCount != y.logCount || x.configHash != y.configHash;
+}
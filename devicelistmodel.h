@@ -0,0 +1,64 @@
+#ifndef DEVICELISTMODEL_H
+#define DEVICELISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QBluetoothDeviceInfo>
+#include <QHash>
+#include <optional>
+
+#include "protocol/Protocol.hpp"
+
+/*
+ * Discovered devices in the order they were first seen. Devices are looked up
+ * by deviceKey() through a hash index, so applying a batch of advertisements
+ * costs one lookup each, new devices are inserted as one row range and known
+ * devices only signal the rows whose shown data changed.
+ */
+class DeviceListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles
+    {
+        DeviceKeyRole = Qt::UserRole,
+        RssiRole,
+        BatteryRole,
+        LogCountRole,
+        UpToDateRole,
+    };
+
+    struct Device
+    {
+        QBluetoothDeviceInfo info;
+        std::optional<Advertisement> advertisement;
+    };
+
+    explicit DeviceListModel(QObject* parent = nullptr);
+
+    static QString deviceKey(const QBluetoothDeviceInfo& info);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    void update(const QList<Device>& devices);
+    void clear();
+
+    QBluetoothDeviceInfo device(int row) const;
+    std::optional<Advertisement> advertisement(int row) const;
+    int rowOf(const QString& key) const;
+
+    // Devices advertising the hash of the target configuration are shown as up to date
+    void setTargetConfig(const OfflineConfig& config);
+    void clearTargetConfig();
+    bool isUpToDate(int row) const;
+
+private:
+    static bool isVisiblyDifferent(const Device& a, const Device& b);
+
+    QList<Device> _devices;
+    QHash<QString, int> _rows;
+    std::optional<uint32_t> _targetHash;
+};
+
+#endif // DEVICELISTMODEL_H
@@ -0,0 +1,590 @@
+#include "diskwriter.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QtLogging>
+
+#include <algorithm>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#include <cerrno>
+#else
+// Never created without liburing
+struct io_uring {};
+#endif
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static bool syncFile(QFile& file)
+{
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return fsync(file.handle()) == 0;
+#endif
+}
+
+// Atomically puts a file in place of another one, if there is one, and makes the
+// new directory entry durable. Readers of the path see either file, never none.
+static bool replaceFile(const QString& from, const QString& to, QString* error)
+{
+#ifdef Q_OS_WIN
+    if(!MoveFileExW((LPCWSTR) QDir::toNativeSeparators(from).utf16(), (LPCWSTR) QDir::toNativeSeparators(to).utf16(),
+        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        *error = "Failed to move " + from + " to " + to + ": " + qt_error_string(GetLastError());
+        return false;
+    }
+    return true;
+#else
+    if(::rename(QFile::encodeName(from).constData(), QFile::encodeName(to).constData()) != 0)
+    {
+        *error = "Failed to move " + from + " to " + to + ": " + qt_error_string(errno);
+        return false;
+    }
+
+    const QByteArray directory = QFile::encodeName(QFileInfo(to).absolutePath());
+    const int fd = ::open(directory.constData(), O_RDONLY);
+    const bool synced = fd >= 0 && fsync(fd) == 0;
+    if(!synced)
+        *error = "Failed to sync " + QFileInfo(to).absolutePath() + ": " + qt_error_string(errno);
+    if(fd >= 0)
+        ::close(fd);
+    return synced;
+#endif
+}
+
+#ifdef HAVE_LIBURING
+// Submits the prepared entries and passes each completion to the callback.
+// False if the ring failed, in which case the results of the round are unknown.
+template<typename Callback>
+static bool submitAndWait(io_uring* ring, size_t count, Callback callback)
+{
+    int result;
+    do
+        result = io_uring_submit(ring);
+    while(result == -EINTR);
+    if(result < 0)
+    {
+        qInfo("io_uring submit failed: %s", qt_error_string(-result).toStdString().c_str());
+        return false;
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        io_uring_cqe* cqe = nullptr;
+        do
+            result = io_uring_wait_cqe(ring, &cqe);
+        while(result == -EINTR);
+        if(result < 0)
+        {
+            qInfo("io_uring wait failed: %s", qt_error_string(-result).toStdString().c_str());
+            return false;
+        }
+
+        callback(io_uring_cqe_get_data(cqe), cqe->res);
+        io_uring_cqe_seen(ring, cqe);
+    }
+    return true;
+}
+#endif
+
+DiskWriter& DiskWriter::instance()
+{
+    static DiskWriter writer;
+    return writer;
+}
+
+DiskWriter::DiskWriter(QObject* parent)
+    : QObject(parent)
+{
+    _clock.start();
+
+    int workers = WORKER_COUNT;
+#ifdef HAVE_LIBURING
+    // Setting up a ring fails where io_uring is disabled, as in some containers
+    auto ring = std::make_unique<io_uring>();
+    const int result = io_uring_queue_init(RING_ENTRIES, ring.get(), 0);
+    if(result == 0)
+    {
+        _ring = std::move(ring);
+        workers = 1;
+    }
+    else
+    {
+        qInfo("io_uring is not available (%s), writing from %d threads",
+            qt_error_string(-result).toStdString().c_str(), WORKER_COUNT);
+    }
+#endif
+
+    for(int i = 0; i < workers; i++)
+    {
+        auto worker = std::make_unique<Worker>();
+        worker->thread = std::thread(&DiskWriter::run, this, std::ref(*worker));
+        _workers.push_back(std::move(worker));
+    }
+}
+
+DiskWriter::~DiskWriter()
+{
+    // Whatever was queued is still written before the threads end
+    _stopping = true;
+    for(auto& worker : _workers)
+    {
+        {
+            std::lock_guard lck(worker->mtx);
+        }
+        worker->cv.notify_all();
+    }
+    for(auto& worker : _workers)
+    {
+        if(worker->thread.joinable())
+            worker->thread.join();
+    }
+
+#ifdef HAVE_LIBURING
+    if(_ring)
+        io_uring_queue_exit(_ring.get());
+#endif
+}
+
+quint64 DiskWriter::open(const QString& path)
+{
+    const quint64 id = _nextId++;
+    enqueue({ Op::Open, id, path, QByteArray(), nowUs() });
+    return id;
+}
+
+void DiskWriter::write(quint64 file, const QByteArray& data)
+{
+    if(data.isEmpty())
+        return;
+    enqueue({ Op::Write, file, QString(), data, nowUs() });
+}
+
+void DiskWriter::close(quint64 file)
+{
+    enqueue({ Op::Close, file, QString(), QByteArray(), nowUs() });
+}
+
+void DiskWriter::discard(quint64 file)
+{
+    enqueue({ Op::Discard, file, QString(), QByteArray(), nowUs() });
+}
+
+quint64 DiskWriter::save(const QString& path, const QByteArray& data)
+{
+    const quint64 id = open(path);
+    write(id, data);
+    close(id);
+    return id;
+}
+
+void DiskWriter::flush()
+{
+    for(auto& worker : _workers)
+    {
+        std::unique_lock lck(worker->mtx);
+        worker->cv.wait(lck, [&worker]() { return worker->ops.empty() && !worker->busy; });
+    }
+}
+
+QString DiskWriter::backend() const
+{
+    return _ring ? "io_uring" : QString::asprintf("%d threads", (int) _workers.size());
+}
+
+DiskWriter::Metrics DiskWriter::metrics() const
+{
+    std::lock_guard lck(_metricsMtx);
+    return _metrics;
+}
+
+void DiskWriter::resetMetrics()
+{
+    std::lock_guard lck(_metricsMtx);
+
+    // What is still queued stays counted
+    Metrics metrics;
+    metrics.queueDepth = _metrics.queueDepth;
+    metrics.maxQueueDepth = _metrics.queueDepth;
+    metrics.queuedBytes = _metrics.queuedBytes;
+    _metrics = metrics;
+}
+
+QString DiskWriter::report() const
+{
+    const Metrics m = metrics();
+
+    QString text;
+    QTextStream out(&text);
+    out << "Disk writes, " << QDateTime::currentDateTime().toString(Qt::ISODate) << "\n";
+    out << "Backend: " << backend() << "\n";
+    out << "Files: " << m.files << " written, " << m.failures << " failed\n";
+    out << "Queue: " << m.queueDepth << " chunks (max " << m.maxQueueDepth << "), " << m.queuedBytes << " bytes\n";
+    out << "Rounds: " << m.rounds << ", " << m.chunks << " chunks in " << m.writes << " writes, "
+        << m.bytes << " bytes, " << m.syncs << " syncs\n\n";
+
+    out << "Latency            Writes     Syncs\n";
+    for(int i = 0; i < BUCKET_COUNT; i++)
+    {
+        if(m.writeLatency[i] == 0 && m.syncLatency[i] == 0)
+            continue;
+        out << bucketLabel(i).leftJustified(16) << QString::number(m.writeLatency[i]).rightJustified(9)
+            << QString::number(m.syncLatency[i]).rightJustified(10) << "\n";
+    }
+
+    out.flush();
+    return text;
+}
+
+void DiskWriter::enqueue(Op op)
+{
+    if(op.kind == Op::Write)
+    {
+        std::lock_guard lck(_metricsMtx);
+        _metrics.queueDepth++;
+        _metrics.maxQueueDepth = std::max(_metrics.maxQueueDepth, _metrics.queueDepth);
+        _metrics.queuedBytes += op.data.size();
+    }
+
+    // A file always goes to the same worker, which keeps its chunks in order
+    Worker& worker = *_workers[op.file % _workers.size()];
+    {
+        std::lock_guard lck(worker.mtx);
+        worker.ops.push_back(std::move(op));
+    }
+    worker.cv.notify_all();
+}
+
+void DiskWriter::run(Worker& worker)
+{
+    while(true)
+    {
+        std::deque<Op> ops;
+        {
+            std::unique_lock lck(worker.mtx);
+            worker.busy = false;
+            worker.cv.notify_all();
+            worker.cv.wait(lck, [this, &worker]() { return !worker.ops.empty() || _stopping; });
+            if(worker.ops.empty())
+                return;
+
+            ops.swap(worker.ops);
+            worker.busy = true;
+        }
+        process(worker, ops);
+    }
+}
+
+void DiskWriter::process(Worker& worker, std::deque<Op>& ops)
+{
+    std::vector<Batch> batches;
+    std::unordered_map<quint64, size_t> index;
+    qint64 chunks = 0;
+    qint64 bytes = 0;
+
+    auto batchOf = [&](quint64 id) -> Batch* {
+        auto it = index.find(id);
+        if(it != index.end())
+            return &batches[it->second];
+
+        auto file = worker.files.find(id);
+        if(file == worker.files.end())
+            return nullptr;
+
+        index[id] = batches.size();
+        batches.push_back({ id, file->second.get() });
+        return &batches.back();
+    };
+
+    for(Op& op : ops)
+    {
+        switch(op.kind)
+        {
+        case Op::Open:
+        {
+            auto file = std::make_unique<File>();
+            file->path = op.path;
+            // Unique per file, so saving the same path twice doesn't share a temporary
+            file->part.setFileName(QString("%1.%2.part").arg(op.path).arg(op.file));
+            if(!QDir().mkpath(QFileInfo(op.path).path()))
+                file->error = "Cannot create directory " + QFileInfo(op.path).path();
+            else if(!file->part.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered))
+                file->error = file->part.errorString();
+            worker.files[op.file] = std::move(file);
+            break;
+        }
+        case Op::Write:
+        {
+            chunks++;
+            bytes += op.data.size();
+
+            Batch* batch = batchOf(op.file);
+            if(!batch || batch->closedUs >= 0)
+                break;
+
+            if(!batch->pieces.empty() && batch->pieces.back().size() + op.data.size() <= MAX_WRITE_BYTES)
+                batch->pieces.back().append(op.data);
+            else
+                batch->pieces.push_back(op.data);
+            batch->queuedUs.push_back(op.queuedUs);
+            break;
+        }
+        case Op::Close:
+        case Op::Discard:
+        {
+            Batch* batch = batchOf(op.file);
+            if(!batch || batch->closedUs >= 0)
+                break;
+
+            batch->closedUs = op.queuedUs;
+            batch->discard = op.kind == Op::Discard;
+            break;
+        }
+        }
+    }
+
+    quint64 writes = 0;
+    for(const Batch& batch : batches)
+    {
+        if(!batch.discard && batch.file->error.isEmpty())
+            writes += batch.pieces.size();
+    }
+
+#ifdef HAVE_LIBURING
+    if(_ring)
+        writeRing(batches);
+    else
+#endif
+        writeBlocking(batches);
+
+    {
+        std::lock_guard lck(_metricsMtx);
+        _metrics.queueDepth -= chunks;
+        _metrics.queuedBytes -= bytes;
+        _metrics.rounds++;
+        _metrics.writes += writes;
+        _metrics.chunks += chunks;
+        _metrics.bytes += bytes;
+
+        const qint64 now = nowUs();
+        for(const Batch& batch : batches)
+        {
+            for(qint64 queued : batch.queuedUs)
+                _metrics.writeLatency[bucketOf(now - queued)]++;
+        }
+    }
+
+    std::vector<Batch*> closing;
+    for(Batch& batch : batches)
+    {
+        if(batch.closedUs >= 0 && !batch.discard && batch.file->error.isEmpty())
+            closing.push_back(&batch);
+    }
+
+    if(!closing.empty())
+    {
+#ifdef HAVE_LIBURING
+        if(_ring)
+            syncRing(closing);
+        else
+#endif
+            syncBlocking(closing);
+
+        std::lock_guard lck(_metricsMtx);
+        _metrics.syncs += closing.size();
+    }
+
+    for(Batch& batch : batches)
+    {
+        if(batch.closedUs >= 0)
+            complete(worker, batch);
+    }
+}
+
+void DiskWriter::writeBlocking(std::vector<Batch>& batches)
+{
+    for(Batch& batch : batches)
+    {
+        File& file = *batch.file;
+        if(batch.discard || !file.error.isEmpty())
+            continue;
+
+        for(const QByteArray& piece : batch.pieces)
+        {
+            if(file.part.write(piece) != piece.size())
+            {
+                file.error = file.part.errorString();
+                break;
+            }
+            file.offset += piece.size();
+        }
+    }
+}
+
+void DiskWriter::syncBlocking(std::vector<Batch*>& batches)
+{
+    for(Batch* batch : batches)
+    {
+        if(!syncFile(batch->file->part))
+            batch->file->error = "Failed to sync: " + qt_error_string();
+    }
+}
+
+#ifdef HAVE_LIBURING
+void DiskWriter::writeRing(std::vector<Batch>& batches)
+{
+    struct Pending
+    {
+        File* file;
+        const QByteArray* piece;
+        qint64 offset;
+    };
+
+    // Offsets are assigned up front, so the writes of a file can complete in any order
+    std::vector<Pending> pending;
+    for(Batch& batch : batches)
+    {
+        File* file = batch.file;
+        if(batch.discard || !file->error.isEmpty())
+            continue;
+
+        for(const QByteArray& piece : batch.pieces)
+        {
+            pending.push_back({ file, &piece, file->offset });
+            file->offset += piece.size();
+        }
+    }
+
+    for(size_t first = 0; first < pending.size(); first += RING_ENTRIES)
+    {
+        const size_t count = std::min<size_t>(RING_ENTRIES, pending.size() - first);
+        for(size_t i = first; i < first + count; i++)
+        {
+            io_uring_sqe* sqe = io_uring_get_sqe(_ring.get());
+            io_uring_prep_write(sqe, pending[i].file->part.handle(), pending[i].piece->constData(),
+                pending[i].piece->size(), pending[i].offset);
+            io_uring_sqe_set_data(sqe, &pending[i]);
+        }
+
+        const bool ok = submitAndWait(_ring.get(), count, [](void* data, int result) {
+            Pending* write = (Pending*) data;
+            if(result < 0)
+                write->file->error = qt_error_string(-result);
+            else if(result != write->piece->size())
+                write->file->error = "Short write";
+        });
+        if(!ok)
+        {
+            for(size_t i = first; i < first + count; i++)
+                pending[i].file->error = "The io_uring failed";
+        }
+    }
+}
+
+void DiskWriter::syncRing(std::vector<Batch*>& batches)
+{
+    for(size_t first = 0; first < batches.size(); first += RING_ENTRIES)
+    {
+        const size_t count = std::min<size_t>(RING_ENTRIES, batches.size() - first);
+        for(size_t i = first; i < first + count; i++)
+        {
+            io_uring_sqe* sqe = io_uring_get_sqe(_ring.get());
+            io_uring_prep_fsync(sqe, batches[i]->file->part.handle(), 0);
+            io_uring_sqe_set_data(sqe, batches[i]->file);
+        }
+
+        const bool ok = submitAndWait(_ring.get(), count, [](void* data, int result) {
+            if(result < 0)
+                ((File*) data)->error = "Failed to sync: " + qt_error_string(-result);
+        });
+        if(!ok)
+        {
+            for(size_t i = first; i < first + count; i++)
+                batches[i]->file->error = "The io_uring failed";
+        }
+    }
+}
+#endif
+
+void DiskWriter::complete(Worker& worker, Batch& batch)
+{
+    File& file = *batch.file;
+    file.part.close();
+
+    bool success = false;
+    if(batch.discard)
+    {
+        file.part.remove();
+    }
+    else if(file.error.isEmpty())
+    {
+        // An earlier copy is only replaced once the new one is complete
+        success = replaceFile(file.part.fileName(), file.path, &file.error);
+    }
+
+    if(!success)
+        file.part.remove();
+
+    if(!batch.discard)
+    {
+        {
+            std::lock_guard lck(_metricsMtx);
+            if(success)
+            {
+                _metrics.files++;
+                _metrics.syncLatency[bucketOf(nowUs() - batch.closedUs)]++;
+            }
+            else
+            {
+                _metrics.failures++;
+            }
+        }
+
+        if(!success)
+            qInfo("Failed to write %s: %s", file.path.toStdString().c_str(), file.error.toStdString().c_str());
+        emit finished(batch.id, file.path, success, file.error);
+    }
+
+    worker.files.erase(batch.id);
+}
+
+qint64 DiskWriter::nowUs() const
+{
+    return _clock.nsecsElapsed() / 1000;
+}
+
+int DiskWriter::bucketOf(qint64 us)
+{
+    int bucket = 0;
+    while(us >= 1 && bucket < BUCKET_COUNT - 1)
+    {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+QString DiskWriter::bucketLabel(int bucket)
+{
+    if(bucket == 0)
+        return "< 1 us";
+    if(bucket == BUCKET_COUNT - 1)
+        return QString::asprintf(">= %d us", 1 << (bucket - 1));
+    return QString::asprintf("%d - %d us", 1 << (bucket - 1), (1 << bucket) - 1);
+}
@@ -0,0 +1,155 @@
+#ifndef DISKWRITER_H
+#define DISKWRITER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct io_uring;
+
+/*
+ * Writes files off the GUI thread. Chunks of a file can be queued from any
+ * thread as they arrive. Each file is written under a temporary name, synced
+ * and renamed into place over any earlier copy when it is closed, so a file at
+ * its final path is always complete. The directory is synced after the rename. finished() is emitted from a writer thread, receivers get
+ * it queued on their own thread.
+ *
+ * Chunks that pile up while a round of writes is in progress are coalesced
+ * per file into writes of up to MAX_WRITE_BYTES. When built with liburing, a
+ * single thread submits the writes and syncs of every file in a round through
+ * one io_uring. Otherwise files are spread over WORKER_COUNT threads that use
+ * blocking writes.
+ */
+class DiskWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int WORKER_COUNT = 4;
+    static constexpr int MAX_WRITE_BYTES = 1 << 20;
+    static constexpr unsigned RING_ENTRIES = 64;
+    static constexpr int BUCKET_COUNT = 24; // Powers of two from 1 us, the last one is open ended
+
+    struct Metrics
+    {
+        qint64 queueDepth = 0; // Chunks waiting to be written
+        qint64 maxQueueDepth = 0;
+        qint64 queuedBytes = 0;
+        quint64 files = 0;
+        quint64 failures = 0;
+        quint64 rounds = 0;
+        quint64 writes = 0; // Write calls or submissions, after coalescing
+        quint64 chunks = 0;
+        quint64 bytes = 0;
+        quint64 syncs = 0;
+        quint64 writeLatency[BUCKET_COUNT] = {}; // From queueing a chunk until it is written
+        quint64 syncLatency[BUCKET_COUNT] = {}; // From closing a file until it is synced and in place
+    };
+
+    static DiskWriter& instance();
+
+    // Starts a file, the returned id is used for the calls below
+    quint64 open(const QString& path);
+    void write(quint64 file, const QByteArray& data);
+    // Syncs the file and moves it to its path, then reports it through finished()
+    void close(quint64 file);
+    // Drops the file without creating it at its path, finished() isn't emitted
+    void discard(quint64 file);
+    // Writes and closes a whole file at once
+    quint64 save(const QString& path, const QByteArray& data);
+    // Blocks until everything queued before the call is on disk. The front ends
+    // call it on aboutToQuit, so files queued at exit are still completed.
+    void flush();
+
+    QString backend() const;
+    Metrics metrics() const;
+    void resetMetrics();
+    QString report() const;
+
+signals:
+    void finished(quint64 file, const QString& path, bool success, const QString& error);
+
+private:
+    explicit DiskWriter(QObject* parent = nullptr);
+    ~DiskWriter();
+
+    struct Op
+    {
+        enum Kind
+        {
+            Open,
+            Write,
+            Close,
+            Discard,
+        } kind;
+        quint64 file;
+        QString path;
+        QByteArray data;
+        qint64 queuedUs;
+    };
+
+    struct File
+    {
+        QString path;
+        QFile part;
+        qint64 offset = 0;
+        QString error;
+    };
+
+    struct Worker
+    {
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::deque<Op> ops;
+        bool busy = false;
+        std::thread thread;
+        std::unordered_map<quint64, std::unique_ptr<File>> files; // Only touched by the thread
+    };
+
+    // Work on one file in a round, in the order its ops were queued
+    struct Batch
+    {
+        quint64 id;
+        File* file;
+        std::vector<QByteArray> pieces;
+        std::vector<qint64> queuedUs;
+        qint64 closedUs = -1;
+        bool discard = false;
+    };
+
+    void enqueue(Op op);
+    void run(Worker& worker);
+    void process(Worker& worker, std::deque<Op>& ops);
+    void writeBlocking(std::vector<Batch>& batches);
+    void syncBlocking(std::vector<Batch*>& batches);
+    // Only defined when built with liburing
+    void writeRing(std::vector<Batch>& batches);
+    void syncRing(std::vector<Batch*>& batches);
+    void complete(Worker& worker, Batch& batch);
+    qint64 nowUs() const;
+
+    static int bucketOf(qint64 us);
+    static QString bucketLabel(int bucket);
+
+    QElapsedTimer _clock;
+    std::atomic<quint64> _nextId = 1;
+    std::atomic<bool> _stopping = false;
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::unique_ptr<io_uring> _ring;
+
+    mutable std::mutex _metricsMtx;
+    Metrics _metrics;
+};
+
+#endif // DISKWRITER_H
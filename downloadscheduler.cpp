@@ -0,0 +1,466 @@
+#include "downloadscheduler.h"
+
+#include <QJsonArray>
+#include <algorithm>
+
+DownloadScheduler::DownloadScheduler(QObject* parent)
+    : QObject(parent)
+    , _scanner(this)
+{
+    _scanTimer.setSingleShot(true);
+    connect(&_scanTimer, &QTimer::timeout, &_scanner, &Scanner::stop);
+    connect(&_scanner, &Scanner::stateChanged, this, &DownloadScheduler::onScannerStateChanged);
+    connect(&_scanner, &Scanner::errorOccurred, this, [this](const QString& message) {
+        emit event({ { "event", "error" }, { "message", message } });
+        onScannerStateChanged(Scanner::Stopped);
+    });
+    connect(_scanner.model(), &QAbstractItemModel::rowsInserted, this, &DownloadScheduler::onDevicesChanged);
+    connect(_scanner.model(), &QAbstractItemModel::dataChanged, this, &DownloadScheduler::onDevicesChanged);
+}
+
+DownloadScheduler::~DownloadScheduler()
+{
+    qDeleteAll(_drains);
+}
+
+void DownloadScheduler::setTargets(const QStringList& targets)
+{
+    _targets = targets;
+}
+
+void DownloadScheduler::setOutputDirectory(const QString& directory)
+{
+    _directory = directory;
+}
+
+void DownloadScheduler::setConcurrency(int connections)
+{
+    _concurrency = qMax(1, connections);
+}
+
+void DownloadScheduler::setScanTimeout(int ms)
+{
+    _scanTimeoutMs = ms;
+}
+
+void DownloadScheduler::start()
+{
+    if(_running)
+        return;
+
+    qDeleteAll(_drains);
+    _drains.clear();
+    _missing.clear();
+    _scanned = false;
+    _running = true;
+    _active = 0;
+    _elapsed.start();
+
+    // One scan finds the sensors and how many logs each has
+    _scanTimer.start(_scanTimeoutMs);
+    _scanner.start();
+}
+
+bool DownloadScheduler::isRunning() const
+{
+    return _running;
+}
+
+QJsonObject DownloadScheduler::summary() const
+{
+    QJsonArray devices;
+    qint64 bytes = 0;
+    int drained = 0;
+    for(const Drain* drain : _drains)
+    {
+        QJsonObject device = drainEvent(*drain, QString());
+        device.remove("event");
+        device["status"] = drain->state == Drain::Done ? "drained" : drain->state == Drain::Failed ? "failed" : "pending";
+        device["connections"] = drain->connections;
+        device["preemptions"] = drain->preemptions;
+        device["completedAtMs"] = drain->completedAtMs;
+        if(!drain->error.isEmpty())
+            device["error"] = drain->error;
+        devices.append(device);
+
+        bytes += drain->downloadedBytes;
+        if(drain->state == Drain::Done)
+            drained++;
+    }
+
+    const qint64 elapsedMs = _running ? _elapsed.elapsed() : _elapsedMs;
+    return {
+        { "event", "summary" },
+        { "elapsedMs", elapsedMs },
+        { "bytes", bytes },
+        { "bytesPerHour", elapsedMs > 0 ? qRound64(bytes * 3600000.0 / elapsedMs) : 0 },
+        { "devices", devices },
+        { "drained", drained },
+        { "failed", (int) _drains.size() - drained },
+        { "notFound", QJsonArray::fromStringList(_missing) },
+    };
+}
+
+void DownloadScheduler::onScannerStateChanged(Scanner::State state)
+{
+    if(state != Scanner::Stopped || !_running || _scanned)
+        return;
+
+    _scanned = true;
+    _scanTimer.stop();
+
+    // Taken once the scan is over, so the signal strengths and log counts are the latest ones
+    DeviceListModel* model = _scanner.model();
+    for(int row = 0; row < model->rowCount(); row++)
+    {
+        const QBluetoothDeviceInfo info = model->device(row);
+        if(!matches(info))
+            continue;
+
+        Drain* drain = new Drain();
+        drain->info = info;
+        drain->advertisement = model->advertisement(row);
+        drain->key = DeviceListModel::deviceKey(info);
+        _drains.push_back(drain);
+
+        if(drain->advertisement && drain->advertisement->logCount == 0)
+        {
+            drain->listed = true;
+            drain->state = Drain::Done;
+            drain->completedAtMs = _elapsed.elapsed();
+            emit event(drainEvent(*drain, "drained"));
+        }
+    }
+
+    for(const auto& target : _targets)
+    {
+        auto found = std::find_if(_drains.begin(), _drains.end(), [&target](const Drain* d) {
+            return d->key.compare(target, Qt::CaseInsensitive) == 0 || d->info.name() == target;
+        });
+        if(found == _drains.end())
+        {
+            _missing.push_back(target);
+            emit event({ { "event", "error" }, { "message", "Device not found: " + target } });
+        }
+    }
+
+    fillSlots();
+    checkFinished();
+}
+
+void DownloadScheduler::onDevicesChanged()
+{
+    if(!_running || !_scanTimer.isActive() || _targets.isEmpty())
+        return;
+
+    // Scanning competes with the transfers for the radio, so stop once everything is found
+    DeviceListModel* model = _scanner.model();
+    for(const auto& target : _targets)
+    {
+        bool found = false;
+        for(int row = 0; row < model->rowCount() && !found; row++)
+        {
+            const QBluetoothDeviceInfo info = model->device(row);
+            found = DeviceListModel::deviceKey(info).compare(target, Qt::CaseInsensitive) == 0 || info.name() == target;
+        }
+        if(!found)
+            return;
+    }
+    _scanner.stop();
+}
+
+void DownloadScheduler::fillSlots()
+{
+    while(_active < _concurrency)
+    {
+        Drain* drain = bestWaiting();
+        if(!drain)
+            return;
+
+        if(!drain->client)
+        {
+            drain->client = new HeadlessClient(this);
+            connect(drain->client, &HeadlessClient::event, this, [this, drain](const QJsonObject& e) {
+                onClientEvent(*drain, e);
+            });
+            connect(drain->client, &HeadlessClient::finished, this, [this, drain](bool success, const QString& error) {
+                onClientFinished(*drain, success, error);
+            });
+        }
+
+        QJsonObject scheduled = drainEvent(*drain, "scheduled");
+        scheduled["estimatedBytes"] = estimatedBytes(*drain);
+        scheduled["estimatedMs"] = remainingMs(*drain);
+        scheduled["expectedBytesPerSecond"] = qRound(expectedRate(*drain));
+        emit event(scheduled);
+
+        _active++;
+        drain->connections++;
+        drain->state = Drain::Connecting;
+        drain->slice.start();
+        drain->client->connectDevice(drain->info);
+    }
+}
+
+void DownloadScheduler::continueDrain(Drain& drain)
+{
+    if(drain.remaining.isEmpty())
+    {
+        leave(drain);
+        return;
+    }
+
+    // A log boundary is the only point where the connection can be handed over
+    if(drain.slice.elapsed() >= MIN_SLICE_MS)
+    {
+        Drain* waiting = bestWaiting();
+        if(waiting && remainingMs(*waiting) < PREEMPT_RATIO * remainingMs(drain))
+        {
+            QJsonObject preempted = drainEvent(drain, "preempted");
+            preempted["by"] = waiting->key;
+            preempted["heldMs"] = drain.slice.elapsed();
+            preempted["remainingBytes"] = drain.pendingBytes;
+            emit event(preempted);
+
+            drain.preemptions++;
+            leave(drain);
+            return;
+        }
+    }
+
+    drain.state = Drain::Downloading;
+    drain.lastCached = false;
+    drain.transfer.start();
+    const QList<LogListPacket::LogItem> next = { drain.remaining.front() };
+    drain.client->downloadLogs(next, _directory);
+}
+
+void DownloadScheduler::leave(Drain& drain)
+{
+    drain.state = Drain::Leaving;
+    drain.client->disconnectDevice();
+}
+
+void DownloadScheduler::release(Drain& drain)
+{
+    _active--;
+
+    if(drain.listed && drain.remaining.isEmpty())
+    {
+        drain.state = Drain::Done;
+        drain.completedAtMs = _elapsed.elapsed();
+        emit event(drainEvent(drain, "drained"));
+    }
+    else if(drain.failures >= MAX_FAILURES)
+    {
+        drain.state = Drain::Failed;
+        QJsonObject failed = drainEvent(drain, "failed");
+        failed["error"] = drain.error;
+        emit event(failed);
+    }
+    else
+    {
+        // Preempted, or failed with retries left, it queues again with what it has left
+        drain.state = Drain::Waiting;
+    }
+
+    fillSlots();
+    checkFinished();
+}
+
+void DownloadScheduler::onClientFinished(Drain& drain, bool success, const QString& error)
+{
+    if(drain.state == Drain::Leaving)
+    {
+        release(drain);
+        return;
+    }
+
+    if(!success)
+    {
+        drain.failures++;
+        drain.error = error;
+        // Also after a failed connection attempt, in which case there is nothing to disconnect
+        leave(drain);
+        return;
+    }
+
+    switch(drain.state)
+    {
+    case Drain::Connecting:
+        if(drain.listed)
+        {
+            continueDrain(drain);
+        }
+        else
+        {
+            drain.state = Drain::Listing;
+            drain.client->listLogs();
+        }
+        break;
+    case Drain::Listing:
+    {
+        drain.listed = true;
+        drain.remaining = drain.client->logs();
+        drain.pendingBytes = 0;
+        for(const auto& item : drain.remaining)
+            drain.pendingBytes += item.size;
+
+        QJsonObject listed = drainEvent(drain, "listed");
+        listed["logs"] = (int) drain.remaining.size();
+        listed["pendingBytes"] = drain.pendingBytes;
+        emit event(listed);
+
+        continueDrain(drain);
+        break;
+    }
+    case Drain::Downloading:
+    {
+        const auto item = drain.remaining.takeFirst();
+        drain.pendingBytes -= item.size;
+
+        // Logs served from the cache say nothing about the link
+        const qint64 elapsedMs = drain.transfer.elapsed();
+        if(!drain.lastCached && item.size > 0 && elapsedMs > 0)
+        {
+            const double sample = item.size * 1000.0 / elapsedMs;
+            drain.bytesPerSecond = drain.bytesPerSecond > 0.0
+                ? drain.bytesPerSecond + THROUGHPUT_WEIGHT * (sample - drain.bytesPerSecond)
+                : sample;
+            drain.downloadedBytes += item.size;
+        }
+
+        continueDrain(drain);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void DownloadScheduler::onClientEvent(Drain& drain, const QJsonObject& e)
+{
+    const QString name = e["event"].toString();
+    if(name == "downloaded")
+        drain.lastCached = e["cached"].toBool();
+
+    // Transfer progress of many sensors at once is too much for a report
+    if(name != "progress")
+        emit event(e);
+}
+
+void DownloadScheduler::checkFinished()
+{
+    if(!_running || !_scanned)
+        return;
+    if(!std::all_of(_drains.begin(), _drains.end(), [](const Drain* d) { return d->state == Drain::Done || d->state == Drain::Failed; }))
+        return;
+
+    _running = false;
+    _elapsedMs = _elapsed.elapsed();
+
+    const QJsonObject report = summary();
+    emit event(report);
+    emit finished(report["failed"].toInt() == 0 && _missing.isEmpty() && !_drains.isEmpty());
+}
+
+DownloadScheduler::Drain* DownloadScheduler::bestWaiting()
+{
+    // Shortest remaining time first, which minimizes the mean time for a sensor to be drained
+    Drain* best = nullptr;
+    qint64 bestMs = 0;
+    for(Drain* drain : _drains)
+    {
+        if(drain->state != Drain::Waiting)
+            continue;
+
+        const qint64 ms = remainingMs(*drain);
+        if(!best || ms < bestMs)
+        {
+            best = drain;
+            bestMs = ms;
+        }
+    }
+    return best;
+}
+
+double DownloadScheduler::expectedRate(const Drain& drain) const
+{
+    if(drain.bytesPerSecond > 0.0)
+        return drain.bytesPerSecond;
+
+    // What the measured sensors would reach with a strong signal
+    double sum = 0.0;
+    int measured = 0;
+    for(const Drain* other : _drains)
+    {
+        if(other->bytesPerSecond > 0.0)
+        {
+            sum += other->bytesPerSecond / signalFactor(other->info.rssi());
+            measured++;
+        }
+    }
+
+    const double base = measured > 0 ? sum / measured : DEFAULT_BYTES_PER_SECOND;
+    return base * signalFactor(drain.info.rssi());
+}
+
+qint64 DownloadScheduler::estimatedBytes(const Drain& drain) const
+{
+    if(drain.listed)
+        return drain.pendingBytes;
+
+    // Until listed, each advertised log is assumed to be as large as the ones listed so far
+    qint64 bytes = 0;
+    int logs = 0;
+    for(const Drain* other : _drains)
+    {
+        if(!other->listed)
+            continue;
+        for(const auto& item : other->remaining)
+            bytes += item.size;
+        logs += other->remaining.size();
+    }
+
+    const qint64 average = logs > 0 ? bytes / logs : DEFAULT_LOG_BYTES;
+    return average * (drain.advertisement ? drain.advertisement->logCount : 1);
+}
+
+qint64 DownloadScheduler::remainingMs(const Drain& drain) const
+{
+    const qint64 transferMs = qRound64(estimatedBytes(drain) * 1000.0 / expectedRate(drain));
+    return drain.state == Drain::Waiting ? transferMs + CONNECT_OVERHEAD_MS : transferMs;
+}
+
+double DownloadScheduler::signalFactor(int rssi)
+{
+    // Zero when the platform doesn't report it
+    if(rssi == 0)
+        return 1.0;
+    return std::clamp((rssi + 100) / 40.0, 0.25, 1.0);
+}
+
+bool DownloadScheduler::matches(const QBluetoothDeviceInfo& info) const
+{
+    if(_targets.isEmpty())
+        return true;
+
+    for(const auto& target : _targets)
+    {
+        if(DeviceListModel::deviceKey(info).compare(target, Qt::CaseInsensitive) == 0 || info.name() == target)
+            return true;
+    }
+    return false;
+}
+
+QJsonObject DownloadScheduler::drainEvent(const Drain& drain, const QString& kind) const
+{
+    return {
+        { "event", kind },
+        { "device", drain.key },
+        { "name", drain.info.name() },
+        { "rssi", drain.info.rssi() },
+        { "bytes", drain.downloadedBytes },
+        { "bytesPerSecond", qRound(drain.bytesPerSecond) },
+    };
+}
@@ -0,0 +1,130 @@
+#ifndef DOWNLOADSCHEDULER_H
+#define DOWNLOADSCHEDULER_H
+
+#include <QObject>
+#include <QBluetoothDeviceInfo>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QTimer>
+#include <optional>
+
+#include "headlessclient.h"
+#include "scanner.h"
+
+/*
+ * Drains the logs of more sensors than there are connections for. Waiting
+ * sensors are ordered by their estimated remaining transfer time, shortest
+ * first: pending bytes, from the advertised log count until the listing is
+ * known, over the expected throughput. Throughput is measured per sensor
+ * while it transfers. Sensors not measured yet are expected to reach the
+ * fleet's measured rate, scaled down for a weak signal.
+ *
+ * Transfers can't be cancelled, so preemption happens between logs. A sensor
+ * that has held its connection for at least MIN_SLICE_MS gives it up when a
+ * waiting one could finish in under PREEMPT_RATIO of its own remaining time,
+ * reconnection included, and queues again with what it has left.
+ */
+class DownloadScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_SCAN_TIMEOUT_MS = 15000;
+    static constexpr double DEFAULT_BYTES_PER_SECOND = 8000.0;
+    static constexpr qint64 DEFAULT_LOG_BYTES = 256 * 1024;
+    static constexpr qint64 CONNECT_OVERHEAD_MS = 5000;
+    static constexpr qint64 MIN_SLICE_MS = 60000;
+    static constexpr double PREEMPT_RATIO = 0.5;
+    static constexpr double THROUGHPUT_WEIGHT = 0.3;
+    static constexpr int MAX_FAILURES = 2;
+
+    explicit DownloadScheduler(QObject* parent = nullptr);
+    ~DownloadScheduler();
+
+    // Sensors by address or name, every sensor found by the scan if empty
+    void setTargets(const QStringList& targets);
+    void setOutputDirectory(const QString& directory);
+    void setConcurrency(int connections);
+    void setScanTimeout(int ms);
+
+    void start();
+    bool isRunning() const;
+
+    QJsonObject summary() const;
+
+signals:
+    void event(const QJsonObject& event);
+    void finished(bool success);
+
+private:
+    struct Drain
+    {
+        enum State
+        {
+            Waiting,
+            Connecting,
+            Listing,
+            Downloading,
+            Leaving,
+            Done,
+            Failed,
+        };
+
+        QBluetoothDeviceInfo info;
+        std::optional<Advertisement> advertisement;
+        QString key;
+        State state = Waiting;
+        HeadlessClient* client = nullptr;
+
+        bool listed = false;
+        QList<LogListPacket::LogItem> remaining;
+        qint64 pendingBytes = 0;
+        qint64 downloadedBytes = 0;
+        double bytesPerSecond = 0.0; // Zero until measured
+        bool lastCached = false;
+
+        QElapsedTimer slice;
+        QElapsedTimer transfer;
+        int connections = 0;
+        int preemptions = 0;
+        int failures = 0;
+        QString error;
+        qint64 completedAtMs = -1;
+    };
+
+    void onScannerStateChanged(Scanner::State state);
+    void onDevicesChanged();
+
+    void fillSlots();
+    void continueDrain(Drain& drain);
+    void leave(Drain& drain);
+    void release(Drain& drain);
+    void onClientFinished(Drain& drain, bool success, const QString& error);
+    void onClientEvent(Drain& drain, const QJsonObject& e);
+    void checkFinished();
+
+    Drain* bestWaiting();
+    double expectedRate(const Drain& drain) const;
+    qint64 estimatedBytes(const Drain& drain) const;
+    qint64 remainingMs(const Drain& drain) const;
+    static double signalFactor(int rssi);
+    bool matches(const QBluetoothDeviceInfo& info) const;
+    QJsonObject drainEvent(const Drain& drain, const QString& kind) const;
+
+    QStringList _targets;
+    QString _directory = ".";
+    int _concurrency = 1;
+    int _scanTimeoutMs = DEFAULT_SCAN_TIMEOUT_MS;
+
+    Scanner _scanner;
+    QTimer _scanTimer;
+    QList<Drain*> _drains;
+    QStringList _missing;
+    int _active = 0;
+    bool _scanned = false;
+    bool _running = false;
+    QElapsedTimer _elapsed;
+    qint64 _elapsedMs = 0;
+};
+
+#endif // DOWNLOADSCHEDULER_H
@@ -0,0 +1,753 @@
+#include "headlessclient.h"
+#include "configjson.h"
+#include "timesync.h"
+
+#include <QDir>
+#include <QJsonArray>
+#include <algorithm>
+
+static const char* const LEVEL_NAMES[] = { "fatal", "error", "warning", "info", "verbose" };
+
+HeadlessClient::HeadlessClient(QObject* parent)
+    : QObject(parent)
+    , _scanner(this)
+{
+    _timeout.setSingleShot(true);
+    connect(&_timeout, &QTimer::timeout, this, &HeadlessClient::onTimeout);
+
+    connect(&_scanner, &Scanner::stateChanged, this, &HeadlessClient::onScannerStateChanged);
+    connect(&_scanner, &Scanner::errorOccurred, this, [this](const QString& message) {
+        if(_op == Scanning || (_op == Connecting && !_sensor))
+            fail(message);
+    });
+    connect(_scanner.model(), &QAbstractItemModel::rowsInserted, this, &HeadlessClient::onDevicesChanged);
+    connect(_scanner.model(), &QAbstractItemModel::dataChanged, this, &HeadlessClient::onDevicesChanged);
+
+    connect(&DiskWriter::instance(), &DiskWriter::finished, this, &HeadlessClient::onLogSaved);
+}
+
+void HeadlessClient::scan(int durationMs)
+{
+    if(!begin(Scanning))
+        return;
+
+    _timeout.start(durationMs);
+    _scanner.start();
+}
+
+void HeadlessClient::connectDevice(const QString& device, int scanTimeoutMs)
+{
+    if(isConnected())
+    {
+        finishLater(false, "Already connected");
+        return;
+    }
+    if(!begin(Connecting))
+        return;
+
+    // The device info needed for connecting is only available from a scan
+    _target = device;
+    _hasConfig = false;
+    _timeout.start(scanTimeoutMs);
+    _scanner.start();
+}
+
+void HeadlessClient::connectDevice(const QBluetoothDeviceInfo& info)
+{
+    if(isConnected())
+    {
+        finishLater(false, "Already connected");
+        return;
+    }
+    if(!begin(Connecting))
+        return;
+
+    _target = DeviceListModel::deviceKey(info);
+    _hasConfig = false;
+    attach(info);
+}
+
+void HeadlessClient::disconnectDevice()
+{
+    if(!_sensor)
+    {
+        finishLater(true, QString());
+        return;
+    }
+    if(!begin(Disconnecting))
+        return;
+
+    _timeout.start(DISCONNECT_TIMEOUT_MS);
+    _sensor->disconnectDevice();
+}
+
+void HeadlessClient::readConfig()
+{
+    if(!isConnected())
+    {
+        finishLater(false, "Not connected");
+        return;
+    }
+
+    // The configuration is read as part of connecting
+    emit event({ { "event", "config" }, { "device", deviceId() }, { "config", ConfigJson::toJson(_config) } });
+    finishLater(true, QString());
+}
+
+void HeadlessClient::writeConfig(const OfflineConfig& config)
+{
+    if(!isConnected())
+    {
+        finishLater(false, "Not connected");
+        return;
+    }
+    if(!begin(WritingConfig))
+        return;
+
+    _config = config;
+    startRequest(_sensor->sendConfig(config));
+}
+
+void HeadlessClient::verifyConfig(const OfflineConfig& expected)
+{
+    if(!isConnected())
+    {
+        finishLater(false, "Not connected");
+        return;
+    }
+    if(!begin(VerifyingConfig))
+        return;
+
+    _expectedConfig = expected;
+    startRequest(_sensor->sendCommand(CommandPacket::CmdReadConfig, {}));
+}
+
+void HeadlessClient::syncTime()
+{
+    if(!isConnected())
+    {
+        finishLater(false, "Not connected");
+        return;
+    }
+    if(!begin(SyncingTime))
+        return;
+
+    // Joins the sync started on connecting if it is still running
+    _sensor->syncTime();
+}
+
+void HeadlessClient::listLogs()
+{
+    if(!isConnected())
+    {
+        finishLater(false, "Not connected");
+        return;
+    }
+    if(!begin(Listing))
+        return;
+
+    _logs.clear();
+    startRequest(_sensor->sendCommand(CommandPacket::CmdListLogs, {}));
+}
+
+void HeadlessClient::downloadLogs(const QList<uint32_t>& logIds, const QString& directory)
+{
+    if(!isConnected())
+    {
+        finishLater(false, "Not connected");
+        return;
+    }
+    if(!QDir().mkpath(directory))
+    {
+        finishLater(false, "Cannot create directory " + directory);
+        return;
+    }
+    if(!begin(Downloading))
+        return;
+
+    // Downloads need the sizes and modification times from a fresh listing
+    _downloadIds = logIds;
+    _downloadDirectory = directory;
+    _downloadQueue.clear();
+    _logs.clear();
+    startRequest(_sensor->sendCommand(CommandPacket::CmdListLogs, {}));
+}
+
+void HeadlessClient::downloadLogs(const QList<LogListPacket::LogItem>& items, const QString& directory)
+{
+    if(!isConnected())
+    {
+        finishLater(false, "Not connected");
+        return;
+    }
+    if(!QDir().mkpath(directory))
+    {
+        finishLater(false, "Cannot create directory " + directory);
+        return;
+    }
+    if(!begin(Downloading))
+        return;
+
+    // The items come from an earlier listing, so this starts transferring right away
+    _downloadIds.clear();
+    _downloadDirectory = directory;
+    _downloadQueue = items;
+    QMetaObject::invokeMethod(this, [this]() {
+        if(_op == Downloading)
+            downloadNext();
+    }, Qt::QueuedConnection);
+}
+
+void HeadlessClient::eraseLogs()
+{
+    if(!isConnected())
+    {
+        finishLater(false, "Not connected");
+        return;
+    }
+    if(!begin(Erasing))
+        return;
+
+    startRequest(_sensor->sendCommand(CommandPacket::CmdClearLogs, {}));
+}
+
+void HeadlessClient::streamLogs(CommandPacket::Params::DebugLogParams::LogLevel level, int durationMs)
+{
+    if(!isConnected())
+    {
+        finishLater(false, "Not connected");
+        return;
+    }
+    if(!begin(Streaming))
+        return;
+
+    // Encoded messages are cheaper to send, but only readable with a dictionary
+    auto format = _dictionary.isEmpty()
+        ? CommandPacket::Params::DebugLogParams::LogFormatText
+        : CommandPacket::Params::DebugLogParams::LogFormatEncoded;
+    _sensor->startStreamingLogMessages(level,
+        CommandPacket::Params::DebugLogParams::User | CommandPacket::Params::DebugLogParams::System,
+        format);
+
+    if(durationMs > 0)
+        _timeout.start(durationMs);
+}
+
+bool HeadlessClient::isBusy() const
+{
+    return _op != Idle;
+}
+
+bool HeadlessClient::isConnected() const
+{
+    return _sensor && _hasConfig;
+}
+
+QString HeadlessClient::deviceId() const
+{
+    return _sensor ? _sensor->deviceId() : QString();
+}
+
+QString HeadlessClient::deviceName() const
+{
+    return _sensor ? _sensor->name() : QString();
+}
+
+const OfflineConfig& HeadlessClient::config() const
+{
+    return _config;
+}
+
+const QList<LogListPacket::LogItem>& HeadlessClient::logs() const
+{
+    return _logs;
+}
+
+LogDictionary& HeadlessClient::dictionary()
+{
+    return _dictionary;
+}
+
+bool HeadlessClient::begin(Operation op)
+{
+    if(_op != Idle)
+    {
+        finishLater(false, "Another operation is in progress");
+        return false;
+    }
+
+    _op = op;
+    return true;
+}
+
+void HeadlessClient::succeed()
+{
+    _timeout.stop();
+    _op = Idle;
+    _requestRef = Packet::INVALID_REF;
+    emit finished(true, QString());
+}
+
+void HeadlessClient::fail(const QString& error)
+{
+    if(_op == Scanning || _op == Connecting)
+        _scanner.stop();
+    if(_op == Connecting && _sensor)
+    {
+        _sensor->disconnectDevice();
+        releaseSensor();
+    }
+    if(_op == Streaming && _sensor)
+        _sensor->stopStreamingLogMessages();
+
+    _timeout.stop();
+    _op = Idle;
+    _requestRef = Packet::INVALID_REF;
+    // Logs still being written finish on their own but aren't reported anymore,
+    // a partly received one never shows up at its path
+    discardStream();
+    _saves.clear();
+    emit finished(false, error);
+}
+
+void HeadlessClient::finishLater(bool success, const QString& error)
+{
+    // Callers may start the next operation from the signal, so never emit from within a call
+    QMetaObject::invokeMethod(this, [this, success, error]() {
+        emit finished(success, error);
+    }, Qt::QueuedConnection);
+}
+
+void HeadlessClient::onTimeout()
+{
+    switch(_op)
+    {
+    case Scanning:
+        // Results are reported once the scanner has stopped
+        _scanner.stop();
+        break;
+    case Connecting:
+        fail(_sensor ? "Timed out connecting to " + _target : "Device not found: " + _target);
+        break;
+    case Streaming:
+        _sensor->stopStreamingLogMessages();
+        succeed();
+        break;
+    case Disconnecting:
+        // The link is gone as far as this client is concerned
+        releaseSensor();
+        succeed();
+        break;
+    default:
+        fail("Timed out waiting for the sensor");
+        break;
+    }
+}
+
+void HeadlessClient::onScannerStateChanged(Scanner::State state)
+{
+    if(state != Scanner::Stopped)
+        return;
+
+    if(_op == Scanning)
+    {
+        DeviceListModel* model = _scanner.model();
+        for(int row = 0; row < model->rowCount(); row++)
+            emit event(deviceEvent(model->device(row), model->advertisement(row)));
+        succeed();
+    }
+    else if(_op == Connecting && !_sensor)
+    {
+        fail("Device not found: " + _target);
+    }
+}
+
+void HeadlessClient::onDevicesChanged()
+{
+    if(_op != Connecting || _sensor)
+        return;
+
+    DeviceListModel* model = _scanner.model();
+    for(int row = 0; row < model->rowCount(); row++)
+    {
+        const QBluetoothDeviceInfo info = model->device(row);
+        if(DeviceListModel::deviceKey(info).compare(_target, Qt::CaseInsensitive) != 0 && info.name() != _target)
+            continue;
+
+        _scanner.stop();
+        attach(info);
+        return;
+    }
+}
+
+void HeadlessClient::attach(const QBluetoothDeviceInfo& info)
+{
+    // Deleted later so the sensor can't be destroyed while it is emitting a signal
+    _sensor = QSharedPointer<Sensor>(new Sensor(nullptr, info), &QObject::deleteLater);
+    connect(_sensor.get(), &Sensor::onStateChanged, this, &HeadlessClient::onSensorStateChanged);
+    connect(_sensor.get(), &Sensor::onConfigUpdated, this, &HeadlessClient::onSensorConfig);
+    connect(_sensor.get(), &Sensor::onError, this, &HeadlessClient::onSensorError);
+    connect(_sensor.get(), &Sensor::onStatusResponse, this, &HeadlessClient::onSensorStatus);
+    connect(_sensor.get(), &Sensor::onLogListReceived, this, &HeadlessClient::onSensorLogList);
+    connect(_sensor.get(), &Sensor::onDataReceived, this, &HeadlessClient::onSensorChunk);
+    connect(_sensor.get(), &Sensor::onDataTransmissionCompleted, this, &HeadlessClient::onSensorData);
+    connect(_sensor.get(), &Sensor::onDataTransmissionProgressUpdate, this, &HeadlessClient::onSensorProgress);
+    connect(_sensor.get(), &Sensor::onReceiveLogStream, this, [this](const DebugMessagePacket& packet) {
+        onSensorLogMessage(LogMessage::fromPacket(packet));
+    });
+    connect(_sensor.get(), &Sensor::onReceiveEncodedLogStream, this, [this](const EncodedDebugMessagePacket& packet) {
+        onSensorLogMessage(LogMessage::fromPacket(packet));
+    });
+    connect(_sensor->timeSync(), &TimeSync::finished, this, &HeadlessClient::onTimeSynced);
+    _cache.setSensorDevice(_sensor);
+
+    _timeout.start(CONNECT_TIMEOUT_MS);
+    _sensor->connectDevice();
+}
+
+void HeadlessClient::onSensorStateChanged(Sensor::State state)
+{
+    if(state != Sensor::Disconnected)
+        return;
+
+    releaseSensor();
+
+    if(_op == Disconnecting)
+        succeed();
+    else if(_op != Idle && _op != Scanning)
+        fail("Sensor disconnected");
+}
+
+void HeadlessClient::onSensorConfig(const OfflineConfig& config)
+{
+    _config = config;
+    _hasConfig = true;
+
+    if(_op == Connecting)
+    {
+        const QBluetoothAddress adapter = _sensor->localAdapter();
+        emit event({
+            { "event", "connected" },
+            { "device", deviceId() },
+            { "name", _sensor->name() },
+            { "adapter", adapter.isNull() ? "default" : adapter.toString() },
+        });
+        succeed();
+    }
+    else if(_op == VerifyingConfig)
+    {
+        const QJsonObject actual = ConfigJson::toJson(config);
+        if(actual != ConfigJson::toJson(_expectedConfig))
+        {
+            fail("Configuration on the sensor differs from the one written");
+            return;
+        }
+
+        emit event({ { "event", "configVerified" }, { "device", deviceId() }, { "config", actual } });
+        succeed();
+    }
+}
+
+void HeadlessClient::onSensorError(Sensor::Error error, QString msg)
+{
+    if(_op == Idle || _op == Disconnecting)
+        return;
+
+    QString message = QString::asprintf("Sensor reported an error: %u", error);
+    if(!msg.isEmpty())
+        message += " " + msg;
+    fail(message);
+}
+
+void HeadlessClient::onSensorStatus(uint8_t ref, uint16_t status)
+{
+    if(ref != _requestRef)
+        return;
+
+    if(status >= 300)
+    {
+        fail(QString::asprintf("Request failed with status %u", status));
+        return;
+    }
+
+    switch(_op)
+    {
+    case WritingConfig:
+        emit event({ { "event", "configWritten" }, { "device", deviceId() }, { "config", ConfigJson::toJson(_config) } });
+        succeed();
+        break;
+    case Erasing:
+        _cache.prune({});
+        emit event({ { "event", "erased" }, { "device", deviceId() } });
+        succeed();
+        break;
+    default:
+        // Listings, downloads and configuration reads complete with their data
+        break;
+    }
+}
+
+void HeadlessClient::onSensorLogList(uint8_t ref, const QList<LogListPacket::LogItem>& items, bool complete)
+{
+    if(ref != _requestRef)
+        return;
+
+    _timeout.start(RESPONSE_TIMEOUT_MS);
+    _logs.append(items);
+    if(!complete)
+        return;
+    _requestRef = Packet::INVALID_REF;
+    _cache.prune(_logs);
+
+    if(_op == Listing)
+    {
+        QJsonArray logs;
+        for(const auto& item : _logs)
+            logs.append(logItemJson(item));
+        emit event({ { "event", "logs" }, { "device", deviceId() }, { "logs", logs } });
+        succeed();
+        return;
+    }
+
+    if(_op == Downloading)
+    {
+        for(const auto& item : _logs)
+        {
+            if(_downloadIds.isEmpty() || _downloadIds.contains(item.id))
+                _downloadQueue.push_back(item);
+        }
+
+        for(uint32_t id : _downloadIds)
+        {
+            auto found = std::find_if(_logs.begin(), _logs.end(), [id](const auto& item) { return item.id == id; });
+            if(found == _logs.end())
+            {
+                fail(QString::asprintf("No log with id %u", id));
+                return;
+            }
+        }
+
+        downloadNext();
+    }
+}
+
+void HeadlessClient::onSensorChunk(uint8_t ref, const QByteArray& chunk)
+{
+    if(ref != _requestRef || _op != Downloading || !_stream)
+        return;
+
+    DiskWriter::instance().write(_stream, chunk);
+}
+
+void HeadlessClient::onSensorData(uint8_t ref, const QByteArray& data)
+{
+    // The log already went to disk chunk by chunk, it isn't copied into the prefetch cache
+    Q_UNUSED(data);
+    if(ref != _requestRef || _op != Downloading || _downloadQueue.isEmpty())
+        return;
+
+    _requestRef = Packet::INVALID_REF;
+    _downloadQueue.removeFirst();
+
+    // Its chunks are already queued, closing it syncs the file and reports it through onLogSaved()
+    DiskWriter::instance().close(_stream);
+    _stream = 0;
+
+    // The next transfer overlaps with writing this one
+    downloadNext();
+}
+
+void HeadlessClient::onSensorProgress(uint8_t ref, const TransferProgress& progress)
+{
+    if(ref != _requestRef || _op != Downloading || _downloadQueue.isEmpty())
+        return;
+
+    _timeout.start(RESPONSE_TIMEOUT_MS);
+    emit event({
+        { "event", "progress" },
+        { "device", deviceId() },
+        { "log", (qint64) _downloadQueue.front().id },
+        { "received", (qint64) progress.receivedBytes },
+        { "total", (qint64) progress.totalBytes },
+        { "bytesPerSecond", qRound(progress.averageBytesPerSecond) },
+    });
+}
+
+void HeadlessClient::onTimeSynced(bool success, const QString& error)
+{
+    if(_op != SyncingTime)
+        return;
+    if(!success)
+    {
+        fail(error);
+        return;
+    }
+
+    const auto& result = _sensor->timeSync()->result();
+    QJsonObject synced = {
+        { "event", "timeSynced" },
+        { "device", deviceId() },
+        { "roundTripUs", result.roundTripUs },
+    };
+    if(result.measured)
+    {
+        synced["offsetBeforeUs"] = result.offsetBeforeUs;
+        synced["offsetAfterUs"] = result.offsetAfterUs;
+        synced["uncertaintyUs"] = result.uncertaintyUs();
+    }
+    if(result.hasDrift)
+    {
+        synced["driftPpm"] = result.driftPpm;
+        synced["driftUncertaintyPpm"] = result.driftUncertaintyPpm;
+        synced["driftIntervalS"] = result.driftIntervalS;
+    }
+    emit event(synced);
+    succeed();
+}
+
+void HeadlessClient::onSensorLogMessage(const LogMessage& message)
+{
+    if(_op != Streaming)
+        return;
+
+    emit event({
+        { "event", "log" },
+        { "device", deviceId() },
+        { "timestamp", (qint64) message.timestamp },
+        { "level", message.level < 5 ? LEVEL_NAMES[message.level] : "unknown" },
+        { "text", message.text(_dictionary) },
+    });
+}
+
+void HeadlessClient::releaseSensor()
+{
+    if(!_sensor)
+        return;
+
+    _cache.setSensorDevice(nullptr);
+    disconnect(_sensor.get(), nullptr, this, nullptr);
+    _sensor.reset();
+    _hasConfig = false;
+}
+
+void HeadlessClient::startRequest(uint8_t ref)
+{
+    if(ref == Packet::INVALID_REF)
+    {
+        fail("Failed to send the request");
+        return;
+    }
+
+    _requestRef = ref;
+    _timeout.start(RESPONSE_TIMEOUT_MS);
+}
+
+void HeadlessClient::downloadNext()
+{
+    // Logs downloaded before, also by the GUI's prefetch, are served from the cache
+    while(!_downloadQueue.isEmpty() && _cache.isCached(_downloadQueue.front()))
+    {
+        const auto item = _downloadQueue.takeFirst();
+        saveLog(item, _cache.readCached(item), true);
+    }
+
+    if(_downloadQueue.isEmpty())
+    {
+        // Done once the last log is on disk
+        if(_saves.isEmpty())
+            succeed();
+        else
+            _timeout.stop();
+        return;
+    }
+
+    // Written as the data arrives, so disk writes of all sessions overlap with the transfers
+    const auto& item = _downloadQueue.front();
+    _stream = DiskWriter::instance().open(logPath(item));
+    _saves.insert(_stream, { item, false });
+
+    CommandPacket::Params params;
+    params.readLog.logIndex = (uint16_t) item.id;
+    startRequest(_sensor->sendCommand(CommandPacket::CmdReadLog, params));
+}
+
+QString HeadlessClient::logPath(const LogListPacket::LogItem& item) const
+{
+    QString id = deviceId();
+    id.replace(':', '-');
+    return QDir(_downloadDirectory).filePath(QString::asprintf("%s-%u.sbem", id.toStdString().c_str(), item.id));
+}
+
+void HeadlessClient::saveLog(const LogListPacket::LogItem& item, const QByteArray& data, bool cached)
+{
+    _saves.insert(DiskWriter::instance().save(logPath(item), data), { item, cached });
+}
+
+void HeadlessClient::discardStream()
+{
+    if(!_stream)
+        return;
+
+    DiskWriter::instance().discard(_stream);
+    _saves.remove(_stream);
+    _stream = 0;
+}
+
+void HeadlessClient::onLogSaved(quint64 file, const QString& path, bool success, const QString& error)
+{
+    auto it = _saves.find(file);
+    if(it == _saves.end())
+        return;
+
+    const PendingSave save = it.value();
+    _saves.erase(it);
+    if(_op != Downloading)
+        return;
+
+    if(!success)
+    {
+        fail("Failed to write " + path + ": " + error);
+        return;
+    }
+
+    QJsonObject result = logItemJson(save.item);
+    result["event"] = "downloaded";
+    result["device"] = deviceId();
+    result["path"] = path;
+    result["cached"] = save.cached;
+    emit event(result);
+
+    if(_saves.isEmpty() && _downloadQueue.isEmpty() && _requestRef == Packet::INVALID_REF)
+        succeed();
+}
+
+QJsonObject HeadlessClient::deviceEvent(const QBluetoothDeviceInfo& info, const std::optional<Advertisement>& adv)
+{
+    QJsonObject device = {
+        { "event", "device" },
+        { "device", DeviceListModel::deviceKey(info) },
+        { "name", info.name() },
+        { "rssi", info.rssi() },
+    };
+
+    if(adv)
+    {
+        device["protocol"] = QString::asprintf("%u.%u", adv->versionMajor, adv->versionMinor);
+        if(adv->battery != Advertisement::BATTERY_UNKNOWN)
+            device["battery"] = adv->battery;
+        device["logCount"] = adv->logCount;
+        device["logging"] = !!(adv->status & Advertisement::StatusLogging);
+        device["fault"] = !!(adv->status & Advertisement::StatusFault);
+        device["configHash"] = QString::asprintf("%08x", adv->configHash);
+    }
+    return device;
+}
+
+QJsonObject HeadlessClient::logItemJson(const LogListPacket::LogItem& item)
+{
+    return {
+        { "id", (qint64) item.id },
+        { "size", (qint64) item.size },
+        { "modified", (qint64) item.modified },
+    };
+}
@@ -0,0 +1,144 @@
+#ifndef HEADLESSCLIENT_H
+#define HEADLESSCLIENT_H
+
+#include <QObject>
+#include <QHash>
+#include <QJsonObject>
+#include <QSharedPointer>
+#include <QTimer>
+
+#include "diskwriter.h"
+#include "scanner.h"
+#include "sensor.h"
+#include "logdictionary.h"
+#include "logmessage.h"
+#include "logprefetcher.h"
+
+/*
+ * Sensor operations for unattended use, without any widgets. One operation
+ * runs at a time and every operation ends with exactly one finished() signal.
+ * Results and progress are reported as JSON objects through event(), each
+ * with an "event" field naming its kind.
+ */
+class HeadlessClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int CONNECT_TIMEOUT_MS = 30000;
+    // A request fails when the sensor stays silent for this long
+    static constexpr int RESPONSE_TIMEOUT_MS = 15000;
+    static constexpr int DISCONNECT_TIMEOUT_MS = 5000;
+
+    explicit HeadlessClient(QObject* parent = nullptr);
+
+    void scan(int durationMs);
+    // Device is matched by address (or UUID on macOS) or by name
+    void connectDevice(const QString& device, int scanTimeoutMs);
+    // Connects to a device found by an earlier scan
+    void connectDevice(const QBluetoothDeviceInfo& info);
+    void disconnectDevice();
+
+    void readConfig();
+    void writeConfig(const OfflineConfig& config);
+    // Reads the configuration back and fails if it differs from the expected one
+    void verifyConfig(const OfflineConfig& expected);
+    void syncTime();
+    void listLogs();
+    // Downloads the given logs, or all of them when the list is empty
+    void downloadLogs(const QList<uint32_t>& logIds, const QString& directory);
+    void downloadLogs(const QList<LogListPacket::LogItem>& items, const QString& directory);
+    void eraseLogs();
+    // Streams until the duration has passed, or until disconnected if it is zero
+    void streamLogs(CommandPacket::Params::DebugLogParams::LogLevel level, int durationMs);
+
+    bool isBusy() const;
+    bool isConnected() const;
+    QString deviceId() const;
+    QString deviceName() const;
+    const OfflineConfig& config() const;
+    // Listing from the last list or download operation
+    const QList<LogListPacket::LogItem>& logs() const;
+    LogDictionary& dictionary();
+
+signals:
+    void event(const QJsonObject& event);
+    void finished(bool success, const QString& error);
+
+private:
+    enum Operation
+    {
+        Idle,
+        Scanning,
+        Connecting,
+        WritingConfig,
+        VerifyingConfig,
+        SyncingTime,
+        Listing,
+        Downloading,
+        Erasing,
+        Streaming,
+        Disconnecting,
+    };
+
+    bool begin(Operation op);
+    void succeed();
+    void fail(const QString& error);
+    void finishLater(bool success, const QString& error);
+    void onTimeout();
+
+    void attach(const QBluetoothDeviceInfo& info);
+    void onScannerStateChanged(Scanner::State state);
+    void onDevicesChanged();
+
+    void onSensorStateChanged(Sensor::State state);
+    void onSensorConfig(const OfflineConfig& config);
+    void onSensorError(Sensor::Error error, QString msg);
+    void onSensorStatus(uint8_t ref, uint16_t status);
+    void onSensorLogList(uint8_t ref, const QList<LogListPacket::LogItem>& items, bool complete);
+    void onSensorChunk(uint8_t ref, const QByteArray& chunk);
+    void onSensorData(uint8_t ref, const QByteArray& data);
+    void onSensorProgress(uint8_t ref, const TransferProgress& progress);
+    void onSensorLogMessage(const LogMessage& message);
+    void onTimeSynced(bool success, const QString& error);
+
+    void releaseSensor();
+    void startRequest(uint8_t ref);
+    void downloadNext();
+    QString logPath(const LogListPacket::LogItem& item) const;
+    void saveLog(const LogListPacket::LogItem& item, const QByteArray& data, bool cached);
+    void discardStream();
+    void onLogSaved(quint64 file, const QString& path, bool success, const QString& error);
+
+    static QJsonObject deviceEvent(const QBluetoothDeviceInfo& info, const std::optional<Advertisement>& adv);
+    static QJsonObject logItemJson(const LogListPacket::LogItem& item);
+
+    Operation _op = Idle;
+    QTimer _timeout;
+    Scanner _scanner;
+    QString _target;
+
+    QSharedPointer<Sensor> _sensor;
+    OfflineConfig _config = {};
+    OfflineConfig _expectedConfig = {};
+    bool _hasConfig = false;
+    uint8_t _requestRef = Packet::INVALID_REF;
+
+    QList<LogListPacket::LogItem> _logs;
+    QList<uint32_t> _downloadIds;
+    QList<LogListPacket::LogItem> _downloadQueue;
+    QString _downloadDirectory;
+    LogPrefetcher _cache; // Only read, logs the GUI prefetched are saved without a transfer
+
+    struct PendingSave
+    {
+        LogListPacket::LogItem item;
+        bool cached;
+    };
+    QHash<quint64, PendingSave> _saves; // Logs still being written, by DiskWriter file
+    quint64 _stream = 0; // DiskWriter file the log being downloaded is streamed into
+
+    LogDictionary _dictionary;
+};
+
+#endif // HEADLESSCLIENT_H
@@ -0,0 +1,611 @@
+#include "jobrunner.h"
+#include "configjson.h"
+#include "sessionmanager.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSettings>
+#include <algorithm>
+
+static bool fail(QString* error, const QString& message)
+{
+    if(error)
+        *error = message;
+    return false;
+}
+
+static bool readJsonObject(const QString& path, QJsonObject* object, QString* error)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+        return fail(error, "Cannot read " + path);
+
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if(!doc.isObject())
+        return fail(error, path + ": " + parseError.errorString());
+
+    *object = doc.object();
+    return true;
+}
+
+JobRunner::JobRunner(QObject* parent)
+    : QObject(parent)
+    , _scanner(this)
+{
+    _scanTimer.setSingleShot(true);
+    connect(&_scanTimer, &QTimer::timeout, &_scanner, &Scanner::stop);
+    connect(&_scanner, &Scanner::stateChanged, this, &JobRunner::onScannerStateChanged);
+    connect(&_scanner, &Scanner::errorOccurred, this, [this](const QString& message) {
+        emit event({ { "event", "error" }, { "message", message } });
+        onScannerStateChanged(Scanner::Stopped);
+    });
+    connect(_scanner.model(), &QAbstractItemModel::rowsInserted, this, &JobRunner::onDevicesChanged);
+    connect(_scanner.model(), &QAbstractItemModel::dataChanged, this, &JobRunner::onDevicesChanged);
+}
+
+JobRunner::~JobRunner()
+{
+    qDeleteAll(_workers);
+}
+
+bool JobRunner::load(const QString& path, QString* error)
+{
+    QJsonObject job;
+    if(!readJsonObject(path, &job, error))
+        return false;
+    return load(job, QFileInfo(path).absolutePath(), error);
+}
+
+bool JobRunner::load(const QJsonObject& job, const QString& baseDirectory, QString* error)
+{
+    const QDir base(baseDirectory);
+
+    _targets.clear();
+    _allDevices = false;
+    if(job["devices"].toString() == "*")
+    {
+        _allDevices = true;
+    }
+    else
+    {
+        for(const auto& value : job["devices"].toArray())
+            _targets.push_back(value.toString());
+        if(_targets.isEmpty())
+            return fail(error, "The job has no devices");
+    }
+
+    // The same limit as in the GUI unless the job asks for less or more
+    QSettings settings;
+    const int maxConnections = settings.value("sessions/maxConnections", SessionManager::DEFAULT_MAX_CONNECTIONS).toInt();
+    _concurrency = qMax(1, job["concurrency"].toInt(maxConnections));
+    _scanTimeoutMs = job.contains("scanTimeout") ? job["scanTimeout"].toInt() * 1000 : DEFAULT_SCAN_TIMEOUT_MS;
+    const int retries = job["retries"].toInt(DEFAULT_RETRIES);
+
+    _steps.clear();
+    QHash<QString, int> index;
+    for(const auto& value : job["steps"].toArray())
+    {
+        const QJsonObject json = value.toObject();
+
+        Step step;
+        step.id = json["id"].toString();
+        if(step.id.isEmpty() || index.contains(step.id))
+            return fail(error, "Each step needs a unique id: '" + step.id + "'");
+        if(!parseAction(json["action"].toString(), &step.action))
+            return fail(error, "Unknown action in step " + step.id + ": " + json["action"].toString());
+
+        for(const auto& dep : json["after"].toArray())
+            step.after.push_back(dep.toString());
+        step.retries = qMax(0, json["retries"].toInt(retries));
+
+        // A preset file and inline settings can be combined, inline ones win
+        if(json.contains("preset"))
+        {
+            if(!readJsonObject(base.absoluteFilePath(json["preset"].toString()), &step.config, error))
+                return false;
+        }
+        const QJsonObject overrides = json["config"].toObject();
+        for(auto it = overrides.begin(); it != overrides.end(); it++)
+            step.config[it.key()] = it.value();
+
+        OfflineConfig check;
+        QString configError;
+        if(!ConfigJson::fromJson(step.config, &check, &configError))
+            return fail(error, "Invalid configuration in step " + step.id + ": " + configError);
+        if(step.action == ActionConfigure && step.config.isEmpty())
+            return fail(error, "Step " + step.id + " has no configuration to write");
+
+        step.output = base.absoluteFilePath(json["output"].toString("logs"));
+        step.archive = base.absoluteFilePath(json["archive"].toString("archive"));
+        step.erase = json["erase"].toBool();
+        for(const auto& id : json["logs"].toArray())
+            step.logIds.push_back((uint32_t) id.toInteger());
+
+        index.insert(step.id, _steps.size());
+        _steps.push_back(step);
+    }
+    if(_steps.isEmpty())
+        return fail(error, "The job has no steps");
+
+    // Order the steps so that each comes after its dependencies, which also finds cycles
+    QList<int> pending(_steps.size(), 0);
+    for(int i = 0; i < _steps.size(); i++)
+    {
+        for(const auto& dep : _steps[i].after)
+        {
+            if(!index.contains(dep))
+                return fail(error, "Step " + _steps[i].id + " depends on unknown step " + dep);
+            pending[i]++;
+        }
+    }
+
+    _order.clear();
+    QList<int> ready;
+    for(int i = 0; i < _steps.size(); i++)
+    {
+        if(pending[i] == 0)
+            ready.push_back(i);
+    }
+    while(!ready.isEmpty())
+    {
+        const int next = ready.takeFirst();
+        _order.push_back(next);
+        for(int i = 0; i < _steps.size(); i++)
+        {
+            if(_steps[i].after.contains(_steps[next].id) && --pending[i] == 0)
+                ready.push_back(i);
+        }
+    }
+    if(_order.size() != _steps.size())
+        return fail(error, "The step dependencies form a cycle");
+
+    return true;
+}
+
+void JobRunner::start()
+{
+    if(_running || _steps.isEmpty())
+        return;
+
+    qDeleteAll(_workers);
+    _workers.clear();
+    for(const auto& target : _targets)
+    {
+        Worker* worker = new Worker();
+        worker->target = target;
+        _workers.push_back(worker);
+    }
+
+    _running = true;
+    _active = 0;
+    _elapsed.start();
+
+    // One scan finds all sensors, the connections are made after it
+    _scanTimer.start(_scanTimeoutMs);
+    _scanner.start();
+}
+
+bool JobRunner::isRunning() const
+{
+    return _running;
+}
+
+QJsonObject JobRunner::summary() const
+{
+    QJsonArray devices;
+    int succeeded = 0;
+    for(const Worker* worker : _workers)
+    {
+        QJsonObject device = workerSummary(*worker);
+        if(device["status"].toString() == "succeeded")
+            succeeded++;
+        devices.append(device);
+    }
+
+    return {
+        { "event", "summary" },
+        { "elapsedMs", _running ? _elapsed.elapsed() : _elapsedMs },
+        { "devices", devices },
+        { "succeeded", succeeded },
+        { "failed", (int) _workers.size() - succeeded },
+    };
+}
+
+void JobRunner::onScannerStateChanged(Scanner::State state)
+{
+    if(state != Scanner::Stopped || !_running)
+        return;
+
+    _scanTimer.stop();
+    for(Worker* worker : _workers)
+    {
+        if(worker->found || worker->done)
+            continue;
+
+        worker->done = true;
+        for(int i = 0; i < _steps.size(); i++)
+            worker->results.push_back({ StepSkipped, 0, 0, "Device not found" });
+        emit event({ { "event", "deviceDone" }, { "device", worker->target }, { "status", "notFound" } });
+    }
+
+    launchWorkers();
+    checkFinished();
+}
+
+void JobRunner::onDevicesChanged()
+{
+    if(!_running || !_scanTimer.isActive())
+        return;
+
+    DeviceListModel* model = _scanner.model();
+    for(int row = 0; row < model->rowCount(); row++)
+    {
+        const QBluetoothDeviceInfo info = model->device(row);
+        const QString key = DeviceListModel::deviceKey(info);
+
+        if(_allDevices)
+        {
+            auto known = std::find_if(_workers.begin(), _workers.end(), [&key](const Worker* w) { return w->target == key; });
+            if(known == _workers.end())
+            {
+                Worker* worker = new Worker();
+                worker->target = key;
+                worker->info = info;
+                worker->found = true;
+                _workers.push_back(worker);
+            }
+            continue;
+        }
+
+        for(Worker* worker : _workers)
+        {
+            if(!worker->found && matches(worker->target, info))
+            {
+                worker->info = info;
+                worker->found = true;
+            }
+        }
+    }
+
+    // Scanning competes with the connections for the radio, so stop once everything is found
+    if(!_allDevices && std::all_of(_workers.begin(), _workers.end(), [](const Worker* w) { return w->found; }))
+        _scanner.stop();
+}
+
+void JobRunner::launchWorkers()
+{
+    for(Worker* worker : _workers)
+    {
+        if(_active >= _concurrency)
+            return;
+        if(!worker->found || worker->started)
+            continue;
+
+        worker->started = true;
+        worker->elapsed.start();
+        for(int i = 0; i < _steps.size(); i++)
+            worker->results.push_back(StepResult());
+
+        worker->client = new HeadlessClient(this);
+        connect(worker->client, &HeadlessClient::event, this, [this, worker](const QJsonObject& e) {
+            // Transfer progress of many sensors at once is too much for a report.
+            // A running sync forwards the client's events itself.
+            if(e["event"].toString() != "progress" && !(worker->sync && worker->sync->isRunning()))
+                emit event(e);
+        });
+        connect(worker->client, &HeadlessClient::finished, this, [this, worker](bool success, const QString& error) {
+            onClientFinished(*worker, success, error);
+        });
+
+        _active++;
+        runNext(*worker);
+    }
+}
+
+void JobRunner::runNext(Worker& worker)
+{
+    for(int i : _order)
+    {
+        StepResult& result = worker.results[i];
+        if(result.status != StepPending)
+            continue;
+
+        if(worker.linkFailed)
+        {
+            result.status = StepSkipped;
+            result.error = "Not connected";
+            emitStep(worker, i, "skipped");
+            continue;
+        }
+
+        QString failedDep;
+        for(const auto& dep : _steps[i].after)
+        {
+            auto it = std::find_if(_steps.begin(), _steps.end(), [&dep](const Step& s) { return s.id == dep; });
+            if(worker.results[it - _steps.begin()].status != StepSucceeded)
+                failedDep = dep;
+        }
+        if(!failedDep.isEmpty())
+        {
+            result.status = StepSkipped;
+            result.error = "Step " + failedDep + " did not succeed";
+            emitStep(worker, i, "skipped");
+            continue;
+        }
+
+        worker.current = i;
+        runStep(worker);
+        return;
+    }
+
+    finishWorker(worker);
+}
+
+void JobRunner::runStep(Worker& worker)
+{
+    HeadlessClient* client = worker.client;
+    const Step& step = _steps[worker.current];
+
+    // Also reconnects for a retry after the link was lost
+    if(!client->isConnected())
+    {
+        worker.connecting = true;
+        client->connectDevice(worker.info);
+        return;
+    }
+
+    worker.results[worker.current].attempts++;
+    worker.stepTimer.start();
+
+    switch(step.action)
+    {
+    case ActionSyncTime:
+        client->syncTime();
+        break;
+    case ActionConfigure:
+    {
+        // Settings missing from the step keep the sensor's current values
+        OfflineConfig config = client->config();
+        ConfigJson::fromJson(step.config, &config);
+        worker.written = config;
+        client->writeConfig(config);
+        break;
+    }
+    case ActionVerifyConfig:
+    {
+        if(!worker.written && step.config.isEmpty())
+        {
+            onStepFinished(worker, false, "No configuration to verify against");
+            break;
+        }
+
+        OfflineConfig expected = worker.written.value_or(client->config());
+        ConfigJson::fromJson(step.config, &expected);
+        client->verifyConfig(expected);
+        break;
+    }
+    case ActionList:
+        client->listLogs();
+        break;
+    case ActionDownload:
+        client->downloadLogs(step.logIds, step.output);
+        break;
+    case ActionErase:
+        client->eraseLogs();
+        break;
+    case ActionSync:
+        if(!worker.sync)
+        {
+            Worker* w = &worker;
+            worker.sync = new SyncEngine(client, this);
+            connect(worker.sync, &SyncEngine::event, this, [this](const QJsonObject& e) {
+                if(e["event"].toString() != "progress")
+                    emit event(e);
+            });
+            connect(worker.sync, &SyncEngine::finished, this, [this, w](bool success, const QString& error) {
+                onStepFinished(*w, success, error);
+            });
+        }
+        worker.sync->start(step.archive, step.erase);
+        break;
+    }
+}
+
+void JobRunner::onClientFinished(Worker& worker, bool success, const QString& error)
+{
+    // A sync runs several client operations and finishes on its own
+    if(worker.sync && worker.sync->isRunning())
+        return;
+
+    if(worker.disconnecting)
+    {
+        worker.disconnecting = false;
+        worker.done = true;
+        worker.elapsedMs = worker.elapsed.elapsed();
+        worker.client->deleteLater();
+        worker.client = nullptr;
+        if(worker.sync)
+        {
+            worker.sync->deleteLater();
+            worker.sync = nullptr;
+        }
+
+        emit event({ { "event", "deviceDone" }, { "device", worker.target }, { "status", workerSummary(worker)["status"] } });
+
+        _active--;
+        launchWorkers();
+        checkFinished();
+        return;
+    }
+
+    if(worker.connecting)
+    {
+        worker.connecting = false;
+        if(success)
+        {
+            runStep(worker);
+            return;
+        }
+
+        // A connection attempt counts as an attempt of the step waiting for it
+        worker.results[worker.current].attempts++;
+        worker.stepTimer.start();
+        onStepFinished(worker, false, "Connecting failed: " + error);
+        if(worker.results[worker.current].status == StepFailed)
+            worker.linkFailed = true;
+        return;
+    }
+
+    onStepFinished(worker, success, error);
+}
+
+void JobRunner::onStepFinished(Worker& worker, bool success, const QString& error)
+{
+    const int i = worker.current;
+    StepResult& result = worker.results[i];
+    result.elapsedMs += worker.stepTimer.elapsed();
+
+    if(success)
+    {
+        result.status = StepSucceeded;
+        result.error.clear();
+        emitStep(worker, i, "succeeded");
+        runNext(worker);
+        return;
+    }
+
+    result.error = error;
+    if(result.attempts <= _steps[i].retries)
+    {
+        emitStep(worker, i, "retrying");
+        Worker* w = &worker;
+        QTimer::singleShot(RETRY_DELAY_MS, this, [this, w]() { runStep(*w); });
+        return;
+    }
+
+    result.status = StepFailed;
+    emitStep(worker, i, "failed");
+
+    // runNext() decides on the remaining steps once linkFailed is known
+    QMetaObject::invokeMethod(this, [this, w = &worker]() { runNext(*w); }, Qt::QueuedConnection);
+}
+
+void JobRunner::finishWorker(Worker& worker)
+{
+    worker.current = -1;
+    worker.disconnecting = true;
+    worker.client->disconnectDevice();
+}
+
+void JobRunner::checkFinished()
+{
+    if(!_running || _scanTimer.isActive())
+        return;
+    if(!std::all_of(_workers.begin(), _workers.end(), [](const Worker* w) { return w->done; }))
+        return;
+
+    _running = false;
+    _elapsedMs = _elapsed.elapsed();
+
+    const QJsonObject report = summary();
+    emit event(report);
+    emit finished(report["failed"].toInt() == 0 && !_workers.isEmpty());
+}
+
+void JobRunner::emitStep(const Worker& worker, int step, const QString& status)
+{
+    const StepResult& result = worker.results[step];
+    QJsonObject e = {
+        { "event", "step" },
+        { "device", worker.target },
+        { "step", _steps[step].id },
+        { "action", actionName(_steps[step].action) },
+        { "status", status },
+        { "attempts", result.attempts },
+        { "elapsedMs", result.elapsedMs },
+    };
+    if(!result.error.isEmpty())
+        e["error"] = result.error;
+    emit event(e);
+}
+
+bool JobRunner::parseAction(const QString& name, Action* action)
+{
+    for(Action candidate : { ActionSyncTime, ActionConfigure, ActionVerifyConfig, ActionList, ActionDownload, ActionErase, ActionSync })
+    {
+        if(name == actionName(candidate))
+        {
+            *action = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+QString JobRunner::actionName(Action action)
+{
+    switch(action)
+    {
+    case ActionSyncTime: return "syncTime";
+    case ActionConfigure: return "configure";
+    case ActionVerifyConfig: return "verifyConfig";
+    case ActionList: return "list";
+    case ActionDownload: return "download";
+    case ActionErase: return "erase";
+    case ActionSync: return "sync";
+    }
+    return QString();
+}
+
+QString JobRunner::statusName(StepStatus status)
+{
+    switch(status)
+    {
+    case StepPending: return "pending";
+    case StepSucceeded: return "succeeded";
+    case StepFailed: return "failed";
+    case StepSkipped: return "skipped";
+    }
+    return QString();
+}
+
+bool JobRunner::matches(const QString& target, const QBluetoothDeviceInfo& info) const
+{
+    return DeviceListModel::deviceKey(info).compare(target, Qt::CaseInsensitive) == 0 || info.name() == target;
+}
+
+QJsonObject JobRunner::workerSummary(const Worker& worker) const
+{
+    QJsonArray steps;
+    bool allSucceeded = worker.found;
+    for(int i = 0; i < worker.results.size() && i < _steps.size(); i++)
+    {
+        const StepResult& result = worker.results[i];
+        QJsonObject step = {
+            { "step", _steps[i].id },
+            { "action", actionName(_steps[i].action) },
+            { "status", statusName(result.status) },
+            { "attempts", result.attempts },
+            { "elapsedMs", result.elapsedMs },
+        };
+        if(!result.error.isEmpty())
+            step["error"] = result.error;
+        steps.append(step);
+
+        if(result.status != StepSucceeded)
+            allSucceeded = false;
+    }
+
+    QString status = !worker.found ? "notFound" : allSucceeded ? "succeeded" : "failed";
+    return {
+        { "device", worker.found ? DeviceListModel::deviceKey(worker.info) : worker.target },
+        { "name", worker.info.name() },
+        { "status", status },
+        { "elapsedMs", worker.done ? worker.elapsedMs : (worker.started ? worker.elapsed.elapsed() : 0) },
+        { "steps", steps },
+    };
+}
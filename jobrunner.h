@@ -0,0 +1,160 @@
+#ifndef JOBRUNNER_H
+#define JOBRUNNER_H
+
+#include <QObject>
+#include <QBluetoothDeviceInfo>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QTimer>
+#include <optional>
+
+#include "headlessclient.h"
+#include "scanner.h"
+#include "syncengine.h"
+
+/*
+ * Runs a job file over many sensors at once. A job names the sensors and a
+ * graph of steps, and the steps of each sensor run in dependency order on
+ * its own connection. Up to `concurrency` sensors are worked on at a time.
+ *
+ *   {
+ *     "devices": [ "0C:8C:DC:00:00:01", "Movesense 200830000123" ],
+ *     "concurrency": 4,
+ *     "retries": 2,
+ *     "steps": [
+ *       { "id": "time", "action": "syncTime" },
+ *       { "id": "config", "action": "configure", "preset": "presets/ecg.json" },
+ *       { "id": "verify", "action": "verifyConfig", "after": [ "config" ] },
+ *       { "id": "download", "action": "download", "output": "logs" },
+ *       { "id": "erase", "action": "erase", "after": [ "download", "verify" ] }
+ *     ]
+ *   }
+ *
+ * "devices" can also be "*" to run the job on every sensor found by the scan.
+ * A failed step is retried, reconnecting first if the link was lost, and the
+ * steps depending on a step that failed for good are skipped. Paths are
+ * relative to the job file.
+ */
+class JobRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_SCAN_TIMEOUT_MS = 15000;
+    static constexpr int DEFAULT_RETRIES = 1;
+    static constexpr int RETRY_DELAY_MS = 2000;
+
+    explicit JobRunner(QObject* parent = nullptr);
+    ~JobRunner();
+
+    bool load(const QString& path, QString* error = nullptr);
+    bool load(const QJsonObject& job, const QString& baseDirectory, QString* error = nullptr);
+
+    void start();
+    bool isRunning() const;
+
+    // Per-sensor and per-step outcome and timing, complete once finished
+    QJsonObject summary() const;
+
+signals:
+    void event(const QJsonObject& event);
+    void finished(bool success);
+
+private:
+    enum Action
+    {
+        ActionSyncTime,
+        ActionConfigure,
+        ActionVerifyConfig,
+        ActionList,
+        ActionDownload,
+        ActionErase,
+        ActionSync,
+    };
+
+    struct Step
+    {
+        QString id;
+        Action action;
+        QStringList after;
+        QJsonObject config;     // ActionConfigure, ActionVerifyConfig
+        QString output;         // ActionDownload
+        QList<uint32_t> logIds; // ActionDownload, empty for all
+        QString archive;        // ActionSync
+        bool erase = false;     // ActionSync
+        int retries = DEFAULT_RETRIES;
+    };
+
+    enum StepStatus
+    {
+        StepPending,
+        StepSucceeded,
+        StepFailed,
+        StepSkipped,
+    };
+
+    struct StepResult
+    {
+        StepStatus status = StepPending;
+        int attempts = 0;
+        qint64 elapsedMs = 0;
+        QString error;
+    };
+
+    struct Worker
+    {
+        QString target;
+        QBluetoothDeviceInfo info;
+        HeadlessClient* client = nullptr;
+        SyncEngine* sync = nullptr;
+        bool found = false;
+        bool started = false;
+        bool done = false;
+
+        bool connecting = false;
+        bool linkFailed = false;
+        bool disconnecting = false;
+        int current = -1; // Index into _steps of the step running now
+        QList<StepResult> results; // Indexed like _steps
+        std::optional<OfflineConfig> written;
+
+        QElapsedTimer elapsed;
+        qint64 elapsedMs = 0;
+        QElapsedTimer stepTimer;
+    };
+
+    void onScannerStateChanged(Scanner::State state);
+    void onDevicesChanged();
+    void launchWorkers();
+
+    void runNext(Worker& worker);
+    void runStep(Worker& worker);
+    void onClientFinished(Worker& worker, bool success, const QString& error);
+    void onStepFinished(Worker& worker, bool success, const QString& error);
+    void finishWorker(Worker& worker);
+    void checkFinished();
+    void emitStep(const Worker& worker, int step, const QString& status);
+
+    static bool parseAction(const QString& name, Action* action);
+    static QString actionName(Action action);
+    static QString statusName(StepStatus status);
+    bool matches(const QString& target, const QBluetoothDeviceInfo& info) const;
+    QJsonObject workerSummary(const Worker& worker) const;
+
+    QList<Step> _steps;
+    QList<int> _order; // Step indices sorted so that dependencies come first
+    QStringList _targets;
+    bool _allDevices = false;
+    int _concurrency = 1;
+    int _scanTimeoutMs = DEFAULT_SCAN_TIMEOUT_MS;
+
+    Scanner _scanner;
+    QTimer _scanTimer;
+    QList<Worker*> _workers;
+    int _active = 0;
+    bool _running = false;
+    QElapsedTimer _elapsed;
+    qint64 _elapsedMs = 0;
+};
+
+#endif // JOBRUNNER_H
@@ -0,0 +1,92 @@
+#include "liveplot.h"
+
+#include <QPainter>
+#include <QPainterPath>
+#include <algorithm>
+#include <limits>
+
+LivePlot::LivePlot(const QString& title, size_t channels, size_t historyLength, QWidget* parent)
+    : QWidget(parent)
+    , _title(title)
+    , _channels(channels)
+{
+    for(auto& channel : _channels)
+        channel.samples.resize(historyLength);
+
+    setMinimumHeight(120);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void LivePlot::append(size_t channel, const float* values, size_t count)
+{
+    auto& history = _channels[channel];
+    const size_t length = history.samples.size();
+    for(size_t i = 0; i < count; i++)
+    {
+        history.samples[history.writePos] = values[i];
+        history.writePos = (history.writePos + 1) % length;
+    }
+    history.count = std::min(length, history.count + count);
+}
+
+void LivePlot::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event);
+    static const QColor colors[] = { QColor(0xd6, 0x27, 0x28), QColor(0x2c, 0xa0, 0x2c), QColor(0x1f, 0x77, 0xb4) };
+
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().base());
+    painter.setPen(palette().text().color());
+    painter.drawText(rect().adjusted(4, 2, -4, -2), Qt::AlignLeft | Qt::AlignTop, _title);
+
+    float minValue = std::numeric_limits<float>::max();
+    float maxValue = std::numeric_limits<float>::lowest();
+    for(const auto& history : _channels)
+    {
+        const size_t length = history.samples.size();
+        for(size_t i = 0; i < history.count; i++)
+        {
+            float value = history.samples[(history.writePos + length - history.count + i) % length];
+            minValue = std::min(minValue, value);
+            maxValue = std::max(maxValue, value);
+        }
+    }
+
+    if(minValue > maxValue)
+        return;
+    if(maxValue - minValue < 1e-6f)
+    {
+        minValue -= 1.0f;
+        maxValue += 1.0f;
+    }
+
+    const QRectF area = QRectF(rect()).adjusted(4, 18, -4, -4);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.drawText(area, Qt::AlignRight | Qt::AlignTop, QString::number(maxValue, 'g', 4));
+    painter.drawText(area, Qt::AlignRight | Qt::AlignBottom, QString::number(minValue, 'g', 4));
+
+    for(size_t c = 0; c < _channels.size(); c++)
+    {
+        const auto& history = _channels[c];
+        const size_t length = history.samples.size();
+        if(history.count < 2)
+            continue;
+
+        // Draw at most one point per pixel column
+        const size_t step = std::max<size_t>(1, history.count / std::max(1, (int) area.width()));
+        QPainterPath path;
+        for(size_t i = 0; i < history.count; i += step)
+        {
+            float value = history.samples[(history.writePos + length - history.count + i) % length];
+            qreal x = area.left() + area.width() * i / (length - 1);
+            qreal y = area.bottom() - area.height() * (value - minValue) / (maxValue - minValue);
+            if(i == 0)
+                path.moveTo(x, y);
+            else
+                path.lineTo(x, y);
+        }
+
+        painter.setPen(QPen(colors[c % 3], 1.0));
+        painter.drawPath(path);
+    }
+}
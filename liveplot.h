@@ -0,0 +1,32 @@
+#ifndef LIVEPLOT_H
+#define LIVEPLOT_H
+
+#include <QWidget>
+#include <vector>
+
+// Scrolling line plot of the most recent samples of one or more channels
+class LivePlot : public QWidget
+{
+    Q_OBJECT
+
+public:
+    LivePlot(const QString& title, size_t channels, size_t historyLength, QWidget* parent = nullptr);
+
+    void append(size_t channel, const float* values, size_t count);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    struct History
+    {
+        std::vector<float> samples;
+        size_t writePos = 0;
+        size_t count = 0;
+    };
+
+    QString _title;
+    std::vector<History> _channels;
+};
+
+#endif // LIVEPLOT_H
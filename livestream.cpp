@@ -0,0 +1,93 @@
+#include "livestream.h"
+
+#include <QtEndian>
+
+LiveStream::LiveStream()
+{
+    for(auto& meas : _measurements)
+        meas = std::make_unique<Measurement>();
+}
+
+void LiveStream::decode(const LiveDataPacket& packet)
+{
+    const auto& format = LiveDataPacket::FORMATS[packet.measurement];
+    const size_t valueSize = LiveDataPacket::SampleSize(format.type);
+    const size_t sampleSize = format.channels * valueSize;
+
+    auto& meas = *_measurements[packet.measurement];
+    const uint8_t* data = packet.samples.get_read_ptr();
+    const size_t count = packet.samples.get_read_size() / sampleSize;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        for(size_t c = 0; c < format.channels; c++)
+        {
+            const uint8_t* value = data + i * sampleSize + c * valueSize;
+            float sample = 0;
+            switch(format.type)
+            {
+            case LiveDataPacket::SampleInt32:
+                sample = (float) qFromLittleEndian<qint32>(value);
+                break;
+            case LiveDataPacket::SampleUInt16:
+                sample = (float) qFromLittleEndian<quint16>(value);
+                break;
+            case LiveDataPacket::SampleFloat32:
+                sample = qFromLittleEndian<float>(value);
+                break;
+            }
+            meas.channels[c].push(sample);
+        }
+    }
+
+    meas.lastTimestamp.store(packet.timestamp, std::memory_order_relaxed);
+}
+
+void LiveStream::clear()
+{
+    for(auto& meas : _measurements)
+    {
+        for(auto& channel : meas->channels)
+            channel.clear();
+        meas->lastTimestamp.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool LiveStream::decode(const QByteArray& data)
+{
+    Packet::Type type;
+    uint8_t ref;
+    ReadableBuffer buffer((const uint8_t*) data.constData(), data.size());
+    if(!buffer.read(&type, 1) || type != Packet::TypeLiveData || !buffer.read(&ref, 1) || !buffer.seek_read(0))
+        return false;
+
+    LiveDataPacket packet(ref);
+    if(!packet.Read(buffer))
+        return false;
+
+    decode(packet);
+    return true;
+}
+
+LiveStream::Channel& LiveStream::channel(OfflineConfig::Measurement meas, size_t channel)
+{
+    return _measurements[meas]->channels[channel];
+}
+
+size_t LiveStream::channelCount(OfflineConfig::Measurement meas) const
+{
+    return LiveDataPacket::FORMATS[meas].channels;
+}
+
+size_t LiveStream::dropped(OfflineConfig::Measurement meas) const
+{
+    size_t dropped = 0;
+    for(const auto& channel : _measurements[meas]->channels)
+        dropped += channel.dropped();
+    return dropped;
+}
+
+uint32_t LiveStream::lastTimestamp(OfflineConfig::Measurement meas) const
+{
+    return _measurements[meas]->lastTimestamp.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,49 @@
+#ifndef LIVESTREAM_H
+#define LIVESTREAM_H
+
+#include "protocol/Protocol.hpp"
+#include "ringbuffer.h"
+
+#include <QByteArray>
+
+#include <array>
+#include <memory>
+
+/*
+ * Decodes live measurement packets into one ring buffer per channel.
+ * Decoding is the producer side, run on the thread of a LiveStreamDecoder,
+ * and a view reading at its own frame rate on the GUI thread is the consumer
+ * side.
+ */
+class LiveStream
+{
+public:
+    static constexpr size_t MAX_CHANNELS = 3;
+    static constexpr size_t CHANNEL_CAPACITY = 16384; // 32 s of 512 Hz ECG
+
+    using Channel = RingBuffer<float, CHANNEL_CAPACITY>;
+
+    LiveStream();
+
+    void decode(const LiveDataPacket& packet);
+    // Takes an encoded packet, false if it isn't valid live data
+    bool decode(const QByteArray& packet);
+    // Drops all samples and counters, for a new stream. Not while decoding or reading.
+    void clear();
+
+    Channel& channel(OfflineConfig::Measurement meas, size_t channel);
+    size_t channelCount(OfflineConfig::Measurement meas) const;
+    size_t dropped(OfflineConfig::Measurement meas) const;
+    uint32_t lastTimestamp(OfflineConfig::Measurement meas) const;
+
+private:
+    struct Measurement
+    {
+        std::array<Channel, MAX_CHANNELS> channels;
+        std::atomic<uint32_t> lastTimestamp { 0 };
+    };
+
+    std::array<std::unique_ptr<Measurement>, OfflineConfig::MeasCount> _measurements;
+};
+
+#endif // LIVESTREAM_H
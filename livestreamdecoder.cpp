@@ -0,0 +1,37 @@
+#include "livestreamdecoder.h"
+#include "sensor.h"
+
+LiveStreamDecoder::LiveStreamDecoder(LiveStream& stream, QObject* parent)
+    : QObject(parent)
+    , _stream(stream)
+    , _worker(new QObject())
+{
+    _thread.setObjectName("LiveStreamDecoder");
+    _worker->moveToThread(&_thread);
+    _thread.start();
+}
+
+LiveStreamDecoder::~LiveStreamDecoder()
+{
+    disconnect(_packets);
+    _thread.quit();
+    _thread.wait();
+    delete _worker;
+}
+
+void LiveStreamDecoder::setSensorDevice(Sensor* sensor)
+{
+    disconnect(_packets);
+    if(!sensor)
+        return;
+
+    // Every packet passes through here, the decoder keeps only live data
+    _packets = connect(sensor, &Sensor::onPacketReceived, _worker, [this](const QByteArray& packet) {
+        _stream.decode(packet);
+    });
+}
+
+void LiveStreamDecoder::clear()
+{
+    QMetaObject::invokeMethod(_worker, [this]() { _stream.clear(); }, Qt::BlockingQueuedConnection);
+}
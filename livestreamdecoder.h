@@ -0,0 +1,37 @@
+#ifndef LIVESTREAMDECODER_H
+#define LIVESTREAMDECODER_H
+
+#include <QObject>
+#include <QThread>
+
+#include "livestream.h"
+
+class Sensor;
+
+/*
+ * Decodes the live data of a sensor into a LiveStream on a thread of its own.
+ * Packets are handed over as they arrive from the transport, so the thread
+ * that shows the stream only pops samples from the rings at its frame rate
+ * and a slow frame can't hold up decoding.
+ */
+class LiveStreamDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LiveStreamDecoder(LiveStream& stream, QObject* parent = nullptr);
+    ~LiveStreamDecoder();
+
+    void setSensorDevice(Sensor* sensor);
+    // Empties the stream once the packets received so far are decoded.
+    // Blocks, and the caller may not read the stream meanwhile.
+    void clear();
+
+private:
+    LiveStream& _stream;
+    QThread _thread;
+    QObject* _worker; // Lives on _thread, packets are queued to it
+    QMetaObject::Connection _packets;
+};
+
+#endif // LIVESTREAMDECODER_H
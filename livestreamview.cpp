@@ -0,0 +1,172 @@
+#include "livestreamview.h"
+#include "protocol/ProtocolConstants.hpp"
+#include "stallmonitor.h"
+
+#include <QGridLayout>
+#include <QHBoxLayout>
+
+constexpr int LIVE_VIEW_FRAME_RATE = 30;
+constexpr int LIVE_VIEW_HISTORY_SECONDS = 5;
+
+LiveStreamView::LiveStreamView(QWidget *parent)
+    : QDialog(parent)
+    , decoder(stream)
+    , frameSamples(LiveStream::CHANNEL_CAPACITY)
+{
+    setWindowTitle("Live Measurements");
+    resize(800, 600);
+
+    struct Option
+    {
+        OfflineConfig::Measurement measurement;
+        const char* label;
+        QList<uint16_t> rates;
+    };
+
+    const QList<Option> options = {
+        { OfflineConfig::MeasECG, "Single-lead ECG", QList<uint16_t>::fromReadOnlyData(SENSOR_MEAS_SAMPLERATES_ECG) },
+        { OfflineConfig::MeasHR, "Heart rate", QList<uint16_t>::fromReadOnlyData(SENSOR_MEAS_TOGGLE) },
+        { OfflineConfig::MeasAcc, "Linear acceleration", QList<uint16_t>::fromReadOnlyData(SENSOR_MEAS_SAMPLERATES_IMU) },
+        { OfflineConfig::MeasGyro, "Gyroscope", QList<uint16_t>::fromReadOnlyData(SENSOR_MEAS_SAMPLERATES_IMU) },
+        { OfflineConfig::MeasMagn, "Magnetometer", QList<uint16_t>::fromReadOnlyData(SENSOR_MEAS_SAMPLERATES_IMU) },
+    };
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    QGridLayout* controls = new QGridLayout();
+    int row = 0;
+    for(const auto& option : options)
+    {
+        QComboBox* rate = new QComboBox();
+        for(uint16_t value : option.rates)
+        {
+            if(value == SENSOR_MEAS_OFF)
+                rate->addItem("Off", value);
+            else if(option.rates.size() == 2)
+                rate->addItem("On", value);
+            else
+                rate->addItem(QString::asprintf("%u Hz", value), value);
+        }
+
+        controls->addWidget(new QLabel(option.label), row, 0);
+        controls->addWidget(rate, row, 1);
+        subscriptions.push_back({ option.measurement, option.label, rate, nullptr });
+        row++;
+    }
+    layout->addLayout(controls);
+
+    QHBoxLayout* buttons = new QHBoxLayout();
+    statusLabel = new QLabel();
+    startButton = new QPushButton("Start");
+    stopButton = new QPushButton("Stop");
+    buttons->addWidget(statusLabel, 1);
+    buttons->addWidget(startButton);
+    buttons->addWidget(stopButton);
+    layout->addLayout(buttons);
+
+    plotsLayout = new QVBoxLayout();
+    layout->addLayout(plotsLayout, 1);
+
+    connect(startButton, &QPushButton::clicked, this, &LiveStreamView::onStart);
+    connect(stopButton, &QPushButton::clicked, this, &LiveStreamView::onStop);
+    connect(&frameTimer, &QTimer::timeout, this, &LiveStreamView::onFrame);
+    frameTimer.setInterval(1000 / LIVE_VIEW_FRAME_RATE);
+
+    stopButton->setEnabled(false);
+}
+
+LiveStreamView::~LiveStreamView()
+{
+}
+
+void LiveStreamView::setSensorDevice(QSharedPointer<Sensor> sensor)
+{
+    if(this->sensor)
+    {
+        onStop();
+        disconnect(this->sensor.get(), nullptr, this, nullptr);
+    }
+
+    this->sensor = sensor;
+    decoder.setSensorDevice(this->sensor.get());
+
+    bool supported = this->sensor && this->sensor->isProtocolVersionAtLeast(1, 4);
+    startButton->setEnabled(supported);
+    statusLabel->setText(supported || !this->sensor ? "" : "Live streaming is not supported by the sensor firmware");
+}
+
+void LiveStreamView::onStart()
+{
+    if(!sensor)
+        return;
+
+    // Samples and drops of a previous stream would show up in the new one
+    decoder.clear();
+
+    for(auto& sub : subscriptions)
+    {
+        uint16_t rate = sub.rate->currentData().toUInt();
+        if(rate == SENSOR_MEAS_OFF)
+            continue;
+
+        // Heart rate arrives about once per second, others at their sample rate
+        size_t historyLength = sub.measurement == OfflineConfig::MeasHR
+            ? 60 : rate * LIVE_VIEW_HISTORY_SECONDS;
+
+        sub.plot = new LivePlot(sub.label + " (" + sub.rate->currentText() + ")",
+            stream.channelCount(sub.measurement), historyLength, this);
+        plotsLayout->addWidget(sub.plot);
+        sub.rate->setEnabled(false);
+
+        sensor->startLiveStream(sub.measurement, rate);
+    }
+
+    startButton->setEnabled(false);
+    stopButton->setEnabled(true);
+    frameTimer.start();
+}
+
+void LiveStreamView::onStop()
+{
+    frameTimer.stop();
+
+    for(auto& sub : subscriptions)
+    {
+        if(sub.plot)
+        {
+            if(sensor)
+                sensor->stopLiveStream(sub.measurement);
+            delete sub.plot;
+            sub.plot = nullptr;
+        }
+        sub.rate->setEnabled(true);
+    }
+
+    startButton->setEnabled(sensor && sensor->isProtocolVersionAtLeast(1, 4));
+    stopButton->setEnabled(false);
+}
+
+void LiveStreamView::onFrame()
+{
+    StallMonitor::Scope scope("LiveStreamView::onFrame");
+
+    QString status;
+
+    for(auto& sub : subscriptions)
+    {
+        if(!sub.plot)
+            continue;
+
+        for(size_t c = 0; c < stream.channelCount(sub.measurement); c++)
+        {
+            size_t count = stream.channel(sub.measurement, c).pop(frameSamples.data(), frameSamples.size());
+            sub.plot->append(c, frameSamples.data(), count);
+        }
+        sub.plot->update();
+
+        size_t dropped = stream.dropped(sub.measurement);
+        if(dropped > 0)
+            status += QString::asprintf("%zu samples dropped ", dropped);
+    }
+
+    statusLabel->setText(status);
+}
@@ -0,0 +1,54 @@
+#ifndef LIVESTREAMVIEW_H
+#define LIVESTREAMVIEW_H
+
+#include <QDialog>
+#include <QComboBox>
+#include <QLabel>
+#include <QPushButton>
+#include <QTimer>
+#include <QVBoxLayout>
+
+#include <vector>
+
+#include "sensor.h"
+#include "livestream.h"
+#include "livestreamdecoder.h"
+#include "liveplot.h"
+
+class LiveStreamView : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit LiveStreamView(QWidget *parent = nullptr);
+    ~LiveStreamView();
+
+    void setSensorDevice(QSharedPointer<Sensor> sensor);
+
+private:
+    void onStart();
+    void onStop();
+    void onFrame();
+
+    struct Subscription
+    {
+        OfflineConfig::Measurement measurement;
+        QString label;
+        QComboBox* rate;
+        LivePlot* plot;
+    };
+
+    QSharedPointer<Sensor> sensor;
+    LiveStream stream;
+    LiveStreamDecoder decoder;
+    std::vector<float> frameSamples; // Popped from a channel on each frame
+
+    QList<Subscription> subscriptions;
+    QVBoxLayout* plotsLayout;
+    QPushButton* startButton;
+    QPushButton* stopButton;
+    QLabel* statusLabel;
+    QTimer frameTimer;
+};
+
+#endif // LIVESTREAMVIEW_H
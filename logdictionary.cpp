@@ -0,0 +1,307 @@
+#include "logdictionary.h"
+
+#include <QFile>
+#include <QtEndian>
+#include <cctype>
+#include <cstring>
+
+static QByteArray unescape(const QByteArray& text)
+{
+    QByteArray out;
+    out.reserve(text.size());
+    for(qsizetype i = 0; i < text.size(); i++)
+    {
+        char c = text[i];
+        if(c == '\\' && i + 1 < text.size())
+        {
+            char next = text[++i];
+            switch(next)
+            {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            default: out += next; break;
+            }
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out;
+}
+
+bool LogDictionary::load(const QString& path, QString* error)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        if(error)
+            *error = file.errorString();
+        return false;
+    }
+
+    QHash<uint16_t, QList<Segment>> formats;
+    int lineNumber = 0;
+    while(!file.atEnd())
+    {
+        QByteArray line = file.readLine();
+        lineNumber++;
+
+        if(line.endsWith('\n'))
+            line.chop(1);
+        if(line.endsWith('\r'))
+            line.chop(1);
+        if(line.trimmed().isEmpty() || line.startsWith('#'))
+            continue;
+
+        qsizetype tab = line.indexOf('\t');
+        bool ok = false;
+        uint id = tab > 0 ? line.left(tab).trimmed().toUInt(&ok) : 0;
+        if(!ok || id > 0xFFFF)
+        {
+            if(error)
+                *error = QString::asprintf("Invalid entry on line %d", lineNumber);
+            return false;
+        }
+
+        formats[(uint16_t) id] = compile(unescape(line.mid(tab + 1)));
+    }
+
+    _formats = formats;
+    _path = path;
+    return true;
+}
+
+void LogDictionary::clear()
+{
+    _formats.clear();
+    _path.clear();
+}
+
+bool LogDictionary::isEmpty() const
+{
+    return _formats.isEmpty();
+}
+
+qsizetype LogDictionary::size() const
+{
+    return _formats.size();
+}
+
+QString LogDictionary::path() const
+{
+    return _path;
+}
+
+QList<LogDictionary::Segment> LogDictionary::compile(const QByteArray& fmt)
+{
+    QList<Segment> segments;
+    Segment current;
+
+    qsizetype i = 0;
+    while(i < fmt.size())
+    {
+        char c = fmt[i];
+        if(c != '%')
+        {
+            current.literal += QChar::fromLatin1(c);
+            i++;
+            continue;
+        }
+
+        if(i + 1 < fmt.size() && fmt[i + 1] == '%')
+        {
+            current.literal += '%';
+            i += 2;
+            continue;
+        }
+
+        // Parse: %[flags][width][.precision][length]conversion
+        qsizetype start = i++;
+        QByteArray spec = "%";
+        uint8_t starArgs = 0;
+
+        // strchr() also finds the terminator, so a NUL in the format isn't a flag
+        while(i < fmt.size() && fmt[i] != '\0' && strchr("-+ #0", fmt[i]))
+            spec += fmt[i++];
+
+        while(i < fmt.size() && (isdigit((unsigned char) fmt[i]) || fmt[i] == '*'))
+        {
+            if(fmt[i] == '*')
+                starArgs++;
+            spec += fmt[i++];
+        }
+
+        if(i < fmt.size() && fmt[i] == '.')
+        {
+            spec += fmt[i++];
+            while(i < fmt.size() && (isdigit((unsigned char) fmt[i]) || fmt[i] == '*'))
+            {
+                if(fmt[i] == '*')
+                    starArgs++;
+                spec += fmt[i++];
+            }
+        }
+
+        int longs = 0;
+        while(i < fmt.size() && fmt[i] != '\0' && strchr("hlzjtL", fmt[i]))
+        {
+            if(fmt[i] == 'l')
+                longs++;
+            i++;
+        }
+
+        if(i >= fmt.size())
+        {
+            current.literal += QString::fromLatin1(fmt.mid(start));
+            break;
+        }
+
+        char conv = fmt[i++];
+        ArgType type = ArgNone;
+        switch(conv)
+        {
+        case 'd': case 'i':
+            type = longs >= 2 ? ArgInt64 : ArgInt32;
+            break;
+        case 'u': case 'x': case 'X': case 'o':
+            type = longs >= 2 ? ArgUInt64 : ArgUInt32;
+            break;
+        case 'c':
+            type = ArgInt32;
+            break;
+        case 'f': case 'F': case 'e': case 'E':
+        case 'g': case 'G': case 'a': case 'A':
+            type = ArgFloat;
+            break;
+        case 's':
+            type = ArgString;
+            break;
+        case 'p':
+            type = ArgPointer;
+            break;
+        default:
+            break;
+        }
+
+        if(type == ArgNone)
+        {
+            // Unsupported conversion, print it as is
+            current.literal += QString::fromLatin1(fmt.mid(start, i - start));
+            continue;
+        }
+
+        if(type == ArgInt64 || type == ArgUInt64)
+            spec += "ll";
+        // Pointers are 32-bit addresses, printed as hex with the given flags and width
+        if(type == ArgPointer)
+            spec = spec == "%" ? "0x%08x" : "0x" + spec.replace('#', "") + "x";
+        else
+            spec += conv;
+
+        current.spec = spec;
+        current.type = type;
+        current.starArgs = starArgs;
+        segments.push_back(current);
+        current = Segment();
+    }
+
+    if(!current.literal.isEmpty())
+        segments.push_back(current);
+
+    return segments;
+}
+
+QString LogDictionary::format(uint16_t id, const QByteArray& args) const
+{
+    auto it = _formats.constFind(id);
+    if(it == _formats.constEnd())
+    {
+        QString line = QString::asprintf("<unknown format #%u>", id);
+        if(!args.isEmpty())
+            line += " " + QString::fromLatin1(args.toHex(' '));
+        return line;
+    }
+
+    const char* ptr = args.constData();
+    qsizetype remaining = args.size();
+
+    auto take = [&](void* dst, qsizetype len) {
+        if(len > remaining)
+            return false;
+        memcpy(dst, ptr, len);
+        ptr += len;
+        remaining -= len;
+        return true;
+    };
+
+    QString line;
+    for(const auto& segment : *it)
+    {
+        line += segment.literal;
+        if(segment.type == ArgNone)
+            continue;
+
+        QByteArray spec = segment.spec;
+        bool ok = true;
+        for(uint8_t s = 0; s < segment.starArgs && ok; s++)
+        {
+            qint32 value = 0;
+            ok = take(&value, sizeof(value));
+            spec.replace(spec.indexOf('*'), 1, QByteArray::number(qFromLittleEndian(value)));
+        }
+
+        switch(segment.type)
+        {
+        case ArgInt32:
+        case ArgUInt32:
+        case ArgPointer:
+        {
+            quint32 value = 0;
+            ok = ok && take(&value, sizeof(value));
+            if(ok)
+                line += QString::asprintf(spec.constData(), qFromLittleEndian(value));
+            break;
+        }
+        case ArgInt64:
+        case ArgUInt64:
+        {
+            quint64 value = 0;
+            ok = ok && take(&value, sizeof(value));
+            if(ok)
+                line += QString::asprintf(spec.constData(), (unsigned long long) qFromLittleEndian(value));
+            break;
+        }
+        case ArgFloat:
+        {
+            float value = 0;
+            ok = ok && take(&value, sizeof(value));
+            if(ok)
+                line += QString::asprintf(spec.constData(), (double) value);
+            break;
+        }
+        case ArgString:
+        {
+            qsizetype len = ok ? strnlen(ptr, remaining) : 0;
+            ok = ok && len < remaining;
+            if(ok)
+            {
+                line += QString::asprintf(spec.constData(), QByteArray(ptr, len).constData());
+                ptr += len + 1;
+                remaining -= len + 1;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        if(!ok)
+        {
+            line += "<truncated>";
+            break;
+        }
+    }
+    return line;
+}
@@ -0,0 +1,56 @@
+#ifndef LOGDICTIONARY_H
+#define LOGDICTIONARY_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+
+/*
+ * Format string dictionary for encoded debug messages.
+ *
+ * The dictionary file is plain text with one entry per line:
+ *   <id><TAB><format string>
+ * Empty lines and lines starting with '#' are ignored. The format string
+ * may use the C escapes \n, \t, \" and \\.
+ */
+class LogDictionary
+{
+public:
+    bool load(const QString& path, QString* error = nullptr);
+    void clear();
+
+    bool isEmpty() const;
+    qsizetype size() const;
+    QString path() const;
+
+    QString format(uint16_t id, const QByteArray& args) const;
+
+private:
+    enum ArgType
+    {
+        ArgNone,
+        ArgInt32,
+        ArgUInt32,
+        ArgInt64,
+        ArgUInt64,
+        ArgFloat,
+        ArgString,
+        ArgPointer,
+    };
+
+    struct Segment
+    {
+        QString literal;
+        QByteArray spec;
+        ArgType type = ArgNone;
+        uint8_t starArgs = 0;
+    };
+
+    static QList<Segment> compile(const QByteArray& fmt);
+
+    QHash<uint16_t, QList<Segment>> _formats;
+    QString _path;
+};
+
+#endif // LOGDICTIONARY_H
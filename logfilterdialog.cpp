@@ -0,0 +1,107 @@
+#include "logfilterdialog.h"
+
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QGroupBox>
+#include <QVBoxLayout>
+
+LogFilterDialog::LogFilterDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("Download Filtered Log");
+
+    static const char* measurementLabels[OfflineConfig::MeasCount] = {
+        "Single-lead ECG",
+        "Heart rate",
+        "R-to-R intervals",
+        "Linear acceleration",
+        "Gyroscope",
+        "Magnetometer",
+        "Temperature",
+        "Activity",
+    };
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+
+    QGroupBox* measurementGroup = new QGroupBox("Measurements");
+    QVBoxLayout* measurementLayout = new QVBoxLayout(measurementGroup);
+    for(int i = 0; i < OfflineConfig::MeasCount; i++)
+    {
+        measurements[i] = new QCheckBox(measurementLabels[i]);
+        measurements[i]->setChecked(true);
+        measurementLayout->addWidget(measurements[i]);
+    }
+    layout->addWidget(measurementGroup);
+
+    QGroupBox* timeGroup = new QGroupBox("Time window");
+    QFormLayout* timeLayout = new QFormLayout(timeGroup);
+    {
+        timeWindow = new QComboBox();
+        timeWindow->addItem("Entire log", WindowEntireLog);
+        timeWindow->addItem("Last minutes of the log", WindowLast);
+        timeWindow->addItem("Range from the start of the log", WindowRange);
+        timeLayout->addRow("Read", timeWindow);
+
+        offsetMinutes = new QSpinBox();
+        offsetMinutes->setRange(0, 7 * 24 * 60);
+        offsetMinutes->setSuffix(" min");
+        timeLayout->addRow("Offset", offsetMinutes);
+
+        spanMinutes = new QSpinBox();
+        spanMinutes->setRange(0, 7 * 24 * 60);
+        spanMinutes->setSuffix(" min");
+        spanMinutes->setSpecialValueText("Until the end");
+        timeLayout->addRow("Duration", spanMinutes);
+    }
+    layout->addWidget(timeGroup);
+
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout->addWidget(buttons);
+
+    connect(timeWindow, &QComboBox::currentIndexChanged, this, &LogFilterDialog::onTimeWindowChanged);
+    onTimeWindowChanged(timeWindow->currentIndex());
+}
+
+CommandPacket::Params::ReadLogFilteredParams LogFilterDialog::params(uint16_t logIndex) const
+{
+    CommandPacket::Params::ReadLogFilteredParams params = {};
+    params.logIndex = logIndex;
+
+    for(int i = 0; i < OfflineConfig::MeasCount; i++)
+    {
+        if(measurements[i]->isChecked())
+            params.measurements |= (1 << i);
+    }
+
+    switch(timeWindow->currentData().toInt())
+    {
+    case WindowLast:
+    {
+        params.flags = CommandPacket::Params::ReadLogFilteredParams::TimeFromEnd;
+        params.timeOffset = offsetMinutes->value() * 60;
+        params.timeSpan = 0;
+        break;
+    }
+    case WindowRange:
+    {
+        params.timeOffset = offsetMinutes->value() * 60;
+        params.timeSpan = spanMinutes->value() * 60;
+        break;
+    }
+    default:
+        break;
+    }
+
+    return params;
+}
+
+void LogFilterDialog::onTimeWindowChanged(int index)
+{
+    int window = timeWindow->itemData(index).toInt();
+    offsetMinutes->setEnabled(window != WindowEntireLog);
+    spanMinutes->setEnabled(window == WindowRange);
+    if(window == WindowLast && offsetMinutes->value() == 0)
+        offsetMinutes->setValue(10);
+}
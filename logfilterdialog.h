@@ -0,0 +1,36 @@
+#ifndef LOGFILTERDIALOG_H
+#define LOGFILTERDIALOG_H
+
+#include <QDialog>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QSpinBox>
+
+#include "protocol/Protocol.hpp"
+
+class LogFilterDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit LogFilterDialog(QWidget *parent = nullptr);
+
+    CommandPacket::Params::ReadLogFilteredParams params(uint16_t logIndex) const;
+
+private:
+    void onTimeWindowChanged(int index);
+
+    enum TimeWindow
+    {
+        WindowEntireLog,
+        WindowLast,
+        WindowRange,
+    };
+
+    QCheckBox* measurements[OfflineConfig::MeasCount];
+    QComboBox* timeWindow;
+    QSpinBox* offsetMinutes;
+    QSpinBox* spanMinutes;
+};
+
+#endif // LOGFILTERDIALOG_H
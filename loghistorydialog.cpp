@@ -0,0 +1,120 @@
+#include "loghistorydialog.h"
+
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+
+LogHistoryDialog::LogHistoryDialog(const DebugLogRecorder& recorder, const LogDictionary& dictionary, QWidget *parent)
+    : QDialog(parent)
+    , recorder(recorder)
+    , dictionary(dictionary)
+{
+    setWindowTitle("Debug Log History");
+    resize(720, 480);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+
+    QFormLayout* filterLayout = new QFormLayout();
+    {
+        QDateTime now = QDateTime::currentDateTime();
+        qint64 first = 0;
+        qint64 last = 0;
+        bool hasRecords = recorder.timeRange(&first, &last);
+
+        fromTime = new QDateTimeEdit(hasRecords ? QDateTime::fromMSecsSinceEpoch(first) : now.addSecs(-3600));
+        fromTime->setDisplayFormat("yyyy-MM-dd hh:mm:ss");
+        fromTime->setCalendarPopup(true);
+        filterLayout->addRow("From", fromTime);
+
+        toTime = new QDateTimeEdit(hasRecords ? QDateTime::fromMSecsSinceEpoch(last).addSecs(1) : now);
+        toTime->setDisplayFormat("yyyy-MM-dd hh:mm:ss");
+        toTime->setCalendarPopup(true);
+        filterLayout->addRow("To", toTime);
+
+        maxLevel = new QComboBox();
+        maxLevel->addItem("Fatal", CommandPacket::Params::DebugLogParams::LogLevelFatal);
+        maxLevel->addItem("Error", CommandPacket::Params::DebugLogParams::LogLevelError);
+        maxLevel->addItem("Warning", CommandPacket::Params::DebugLogParams::LogLevelWarning);
+        maxLevel->addItem("Info", CommandPacket::Params::DebugLogParams::LogLevelInfo);
+        maxLevel->addItem("Verbose", CommandPacket::Params::DebugLogParams::LogLevelVerbose);
+        maxLevel->setCurrentIndex(maxLevel->count() - 1);
+        filterLayout->addRow("Level", maxLevel);
+    }
+    layout->addLayout(filterLayout);
+
+    results = new QListWidget();
+    results->setUniformItemSizes(true);
+    layout->addWidget(results);
+
+    QHBoxLayout* buttonLayout = new QHBoxLayout();
+    {
+        statusLabel = new QLabel();
+        buttonLayout->addWidget(statusLabel, 1);
+
+        QPushButton* searchButton = new QPushButton("Search");
+        connect(searchButton, &QPushButton::clicked, this, &LogHistoryDialog::onSearch);
+        buttonLayout->addWidget(searchButton);
+
+        loadMoreButton = new QPushButton("Load More");
+        loadMoreButton->setEnabled(false);
+        connect(loadMoreButton, &QPushButton::clicked, this, &LogHistoryDialog::onLoadMore);
+        buttonLayout->addWidget(loadMoreButton);
+    }
+    layout->addLayout(buttonLayout);
+
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Close);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout->addWidget(buttons);
+
+    if(!recorder.isOpen())
+        statusLabel->setText("Recording is not available");
+}
+
+void LogHistoryDialog::onSearch()
+{
+    results->clear();
+    resultCount = 0;
+    nextFrom = 0;
+    skipAtFrom = 0;
+    loadPage(fromTime->dateTime().toMSecsSinceEpoch());
+}
+
+void LogHistoryDialog::onLoadMore()
+{
+    loadPage(nextFrom);
+}
+
+void LogHistoryDialog::loadPage(qint64 from)
+{
+    const qint64 to = toTime->dateTime().toMSecsSinceEpoch();
+    const uint8_t level = (uint8_t) maxLevel->currentData().toUInt();
+
+    // Records that share the last timestamp of the previous page were already shown
+    const int skip = from == nextFrom ? skipAtFrom : 0;
+    QList<LogRecord> page = recorder.query(from, to, level, PAGE_SIZE + skip);
+    page.remove(0, qMin<qsizetype>(skip, page.size()));
+
+    for(const auto& record : page)
+    {
+        QString time = QDateTime::fromMSecsSinceEpoch(record.hostTime).toString("yyyy-MM-dd hh:mm:ss.zzz");
+        results->addItem(time + "  " + record.message.toString(dictionary));
+    }
+
+    resultCount += page.size();
+
+    if(!page.isEmpty())
+    {
+        const qint64 last = page.back().hostTime;
+        int sameTime = 0;
+        for(auto it = page.crbegin(); it != page.crend() && it->hostTime == last; ++it)
+            sameTime++;
+
+        skipAtFrom = (last == nextFrom ? skip : 0) + sameTime;
+        nextFrom = last;
+    }
+
+    const bool more = page.size() == PAGE_SIZE;
+    loadMoreButton->setEnabled(more);
+    statusLabel->setText(QString::asprintf("%d messages%s", resultCount, more ? ", more available" : ""));
+}
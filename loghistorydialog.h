@@ -0,0 +1,42 @@
+#ifndef LOGHISTORYDIALOG_H
+#define LOGHISTORYDIALOG_H
+
+#include <QDialog>
+#include <QComboBox>
+#include <QDateTimeEdit>
+#include <QLabel>
+#include <QListWidget>
+#include <QPushButton>
+
+#include "debuglogrecorder.h"
+
+class LogHistoryDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    static constexpr int PAGE_SIZE = 1000;
+
+    LogHistoryDialog(const DebugLogRecorder& recorder, const LogDictionary& dictionary, QWidget *parent = nullptr);
+
+private:
+    void onSearch();
+    void onLoadMore();
+    void loadPage(qint64 from);
+
+    const DebugLogRecorder& recorder;
+    const LogDictionary& dictionary;
+
+    QDateTimeEdit* fromTime;
+    QDateTimeEdit* toTime;
+    QComboBox* maxLevel;
+    QListWidget* results;
+    QLabel* statusLabel;
+    QPushButton* loadMoreButton;
+
+    qint64 nextFrom = 0;
+    int skipAtFrom = 0;
+    int resultCount = 0;
+};
+
+#endif // LOGHISTORYDIALOG_H
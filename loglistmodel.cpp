@@ -0,0 +1,196 @@
+#include "loglistmodel.h"
+
+#include <QDateTime>
+#include <QSettings>
+#include <QtEndian>
+
+static constexpr int CACHE_ITEM_SIZE = 16;
+
+LogListModel::LogListModel(QObject* parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+int LogListModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : _items.size();
+}
+
+int LogListModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant LogListModel::data(const QModelIndex& index, int role) const
+{
+    if(!index.isValid() || index.row() >= _items.size())
+        return QVariant();
+
+    const auto& item = _items.at(index.row());
+    if(role == SortRole)
+    {
+        switch(index.column())
+        {
+        case ColumnId: return item.id;
+        case ColumnModified: return (qulonglong) item.modified;
+        case ColumnSize: return item.size;
+        }
+    }
+    else if(role == Qt::DisplayRole)
+    {
+        switch(index.column())
+        {
+        case ColumnId:
+            return QString::asprintf("LOG# %u", item.id);
+        case ColumnModified:
+            // Sensor timestamps are in microseconds
+            return QDateTime::fromMSecsSinceEpoch(item.modified / 1000).toString("yyyy-MM-dd hh:mm:ss");
+        case ColumnSize:
+            if(item.size >= 1024 * 1024)
+                return QString::asprintf("%.2f MB", item.size / (1024.0 * 1024.0));
+            if(item.size >= 1024)
+                return QString::asprintf("%.1f kB", item.size / 1024.0);
+            return QString::asprintf("%u B", item.size);
+        }
+    }
+    else if(role == Qt::TextAlignmentRole && index.column() == ColumnSize)
+    {
+        return QVariant(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    return QVariant();
+}
+
+QVariant LogListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QVariant();
+
+    switch(section)
+    {
+    case ColumnId: return "Log";
+    case ColumnModified: return "Modified";
+    case ColumnSize: return "Size";
+    }
+    return QVariant();
+}
+
+void LogListModel::setItems(const QList<LogListPacket::LogItem>& items)
+{
+    beginResetModel();
+    _items = items;
+    rebuildIndex();
+    endResetModel();
+}
+
+void LogListModel::reconcile(const QList<LogListPacket::LogItem>& items)
+{
+    QHash<uint32_t, const LogListPacket::LogItem*> fresh;
+    fresh.reserve(items.size());
+    for(const auto& item : items)
+        fresh.insert(item.id, &item);
+
+    // Remove logs that are gone, as contiguous row ranges from the end
+    for(int row = _items.size() - 1; row >= 0;)
+    {
+        if(fresh.contains(_items[row].id))
+        {
+            row--;
+            continue;
+        }
+
+        int last = row;
+        while(row >= 0 && !fresh.contains(_items[row].id))
+            row--;
+
+        beginRemoveRows(QModelIndex(), row + 1, last);
+        _items.remove(row + 1, last - row);
+        endRemoveRows();
+    }
+    rebuildIndex();
+
+    // Update logs that were rewritten, append new ones
+    QList<LogListPacket::LogItem> added;
+    for(const auto& item : items)
+    {
+        auto it = _rows.constFind(item.id);
+        if(it == _rows.constEnd())
+        {
+            added.push_back(item);
+            continue;
+        }
+
+        auto& known = _items[it.value()];
+        if(known.modified != item.modified || known.size != item.size)
+        {
+            known = item;
+            emit dataChanged(index(it.value(), 0), index(it.value(), ColumnCount - 1));
+        }
+    }
+
+    if(!added.isEmpty())
+    {
+        beginInsertRows(QModelIndex(), _items.size(), _items.size() + added.size() - 1);
+        _items.append(added);
+        rebuildIndex();
+        endInsertRows();
+    }
+}
+
+void LogListModel::clear()
+{
+    setItems({});
+}
+
+const QList<LogListPacket::LogItem>& LogListModel::items() const
+{
+    return _items;
+}
+
+const LogListPacket::LogItem& LogListModel::item(int row) const
+{
+    return _items.at(row);
+}
+
+QList<LogListPacket::LogItem> LogListModel::loadCached(const QString& deviceId)
+{
+    QSettings settings;
+    QByteArray data = settings.value("logList/" + deviceId + "/items").toByteArray();
+
+    QList<LogListPacket::LogItem> items;
+    items.reserve(data.size() / CACHE_ITEM_SIZE);
+    for(qsizetype pos = 0; pos + CACHE_ITEM_SIZE <= data.size(); pos += CACHE_ITEM_SIZE)
+    {
+        const uchar* ptr = (const uchar*) data.constData() + pos;
+        LogListPacket::LogItem item;
+        item.id = qFromLittleEndian<quint32>(ptr);
+        item.size = qFromLittleEndian<quint32>(ptr + 4);
+        item.modified = qFromLittleEndian<quint64>(ptr + 8);
+        items.push_back(item);
+    }
+    return items;
+}
+
+void LogListModel::saveCached(const QString& deviceId, const QList<LogListPacket::LogItem>& items)
+{
+    // One packed value instead of a key per log keeps large listings cheap to store
+    QByteArray data(items.size() * CACHE_ITEM_SIZE, 0);
+    uchar* ptr = (uchar*) data.data();
+    for(const auto& item : items)
+    {
+        qToLittleEndian<quint32>(item.id, ptr);
+        qToLittleEndian<quint32>(item.size, ptr + 4);
+        qToLittleEndian<quint64>(item.modified, ptr + 8);
+        ptr += CACHE_ITEM_SIZE;
+    }
+
+    QSettings settings;
+    settings.setValue("logList/" + deviceId + "/items", data);
+}
+
+void LogListModel::rebuildIndex()
+{
+    _rows.clear();
+    _rows.reserve(_items.size());
+    for(int row = 0; row < _items.size(); row++)
+        _rows.insert(_items[row].id, row);
+}
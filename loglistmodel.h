@@ -0,0 +1,55 @@
+#ifndef LOGLISTMODEL_H
+#define LOGLISTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QHash>
+
+#include "protocol/Protocol.hpp"
+
+/*
+ * Logs stored on a sensor. Rows are formatted only when a view asks for them,
+ * and reconcile() applies a fresh listing as row-level removes, updates and
+ * inserts, keeping the selection and scroll position of a view intact.
+ */
+class LogListModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        ColumnId,
+        ColumnModified,
+        ColumnSize,
+        ColumnCount,
+    };
+
+    // Raw value of a cell, used for sorting
+    static constexpr int SortRole = Qt::UserRole;
+
+    explicit LogListModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    void setItems(const QList<LogListPacket::LogItem>& items);
+    void reconcile(const QList<LogListPacket::LogItem>& items);
+    void clear();
+
+    const QList<LogListPacket::LogItem>& items() const;
+    const LogListPacket::LogItem& item(int row) const;
+
+    // Last known listing of a device, persisted between sessions
+    static QList<LogListPacket::LogItem> loadCached(const QString& deviceId);
+    static void saveCached(const QString& deviceId, const QList<LogListPacket::LogItem>& items);
+
+private:
+    void rebuildIndex();
+
+    QList<LogListPacket::LogItem> _items;
+    QHash<uint32_t, int> _rows;
+};
+
+#endif // LOGLISTMODEL_H
@@ -0,0 +1,47 @@
+#include "logmessage.h"
+
+LogMessage LogMessage::fromPacket(const DebugMessagePacket& packet)
+{
+    LogMessage msg;
+    msg.level = packet.level;
+    msg.timestamp = packet.timestamp;
+    msg.payload = QByteArray(
+        (const char*) packet.message.get_read_ptr(),
+        packet.message.get_read_size());
+    return msg;
+}
+
+LogMessage LogMessage::fromPacket(const EncodedDebugMessagePacket& packet)
+{
+    LogMessage msg;
+    msg.level = packet.level;
+    msg.timestamp = packet.timestamp;
+    msg.encoded = true;
+    msg.formatId = packet.formatId;
+    msg.payload = QByteArray(
+        (const char*) packet.args.get_read_ptr(),
+        packet.args.get_read_size());
+    return msg;
+}
+
+QString LogMessage::text(const LogDictionary& dictionary) const
+{
+    if(encoded)
+        return dictionary.format(formatId, payload);
+    return QString::fromUtf8(payload);
+}
+
+QString LogMessage::toString(const LogDictionary& dictionary) const
+{
+    static const QString levelLabels[] = { "[FATAL]", "[ERROR]", "[WARNING]", "[INFO]", "[VERBOSE]" };
+
+    uint32_t ms = timestamp % 1000;
+    uint32_t epoch = timestamp / 1000;
+
+    QString line = QString::asprintf("%u.%03u ", epoch, ms);
+    if(level <= 4)
+        line += levelLabels[level] + " ";
+
+    line += text(dictionary);
+    return line;
+}
@@ -0,0 +1,25 @@
+#ifndef LOGMESSAGE_H
+#define LOGMESSAGE_H
+
+#include "protocol/Protocol.hpp"
+#include "logdictionary.h"
+
+#include <QByteArray>
+#include <QString>
+
+struct LogMessage
+{
+    uint8_t level = 4;
+    uint32_t timestamp = 0;
+    bool encoded = false;
+    uint16_t formatId = 0;
+    QByteArray payload;
+
+    static LogMessage fromPacket(const DebugMessagePacket& packet);
+    static LogMessage fromPacket(const EncodedDebugMessagePacket& packet);
+
+    QString text(const LogDictionary& dictionary) const;
+    QString toString(const LogDictionary& dictionary) const;
+};
+
+#endif // LOGMESSAGE_H
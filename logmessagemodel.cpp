@@ -0,0 +1,164 @@
+#include "logmessagemodel.h"
+#include "stallmonitor.h"
+
+LogMessageModel::LogMessageModel(const LogDictionary& dictionary, QObject* parent)
+    : QAbstractListModel(parent)
+    , _dictionary(dictionary)
+{
+    _entries.resize(_capacity);
+
+    _flushTimer.setSingleShot(true);
+    setFlushRate(DEFAULT_FLUSH_RATE);
+    connect(&_flushTimer, &QTimer::timeout, this, &LogMessageModel::flush);
+}
+
+int LogMessageModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : _count;
+}
+
+QVariant LogMessageModel::data(const QModelIndex& index, int role) const
+{
+    if(!index.isValid() || index.row() >= _count)
+        return QVariant();
+
+    const Entry& entry = at(index.row());
+    switch(role)
+    {
+    case Qt::DisplayRole:
+    {
+        // Formatted only for rows the view actually shows
+        QString line = entry.message.toString(_dictionary);
+        if(entry.repeat > 1)
+            line += QString::asprintf(" (x%u)", entry.repeat);
+        return line;
+    }
+    default:
+        return QVariant();
+    }
+}
+
+void LogMessageModel::append(const LogMessage& message)
+{
+    if(!_pending.empty() && isRepeat(_pending.back().message, message))
+    {
+        _pending.back().repeat++;
+        _pending.back().message.timestamp = message.timestamp;
+    }
+    else if(_pending.empty() && _count > 0 && isRepeat(at(_count - 1).message, message))
+    {
+        at(_count - 1).repeat++;
+        at(_count - 1).message.timestamp = message.timestamp;
+        _lastRowChanged = true;
+    }
+    else
+    {
+        // Anything older than the capacity would be dropped on flush anyway
+        if((int) _pending.size() >= _capacity)
+            _pending.pop_front();
+        _pending.push_back({ message, 1 });
+    }
+
+    if(!_flushTimer.isActive())
+    {
+        _flushTimer.start();
+        _pendingSince.start();
+    }
+}
+
+void LogMessageModel::clear()
+{
+    beginResetModel();
+    _head = 0;
+    _count = 0;
+    _pending.clear();
+    _lastRowChanged = false;
+    _lagMs = 0;
+    endResetModel();
+}
+
+void LogMessageModel::refresh()
+{
+    if(_count > 0)
+        emit dataChanged(index(0), index(_count - 1), { Qt::DisplayRole });
+}
+
+void LogMessageModel::setCapacity(int capacity)
+{
+    beginResetModel();
+    _capacity = capacity;
+    _entries.assign(_capacity, Entry());
+    _head = 0;
+    _count = 0;
+    _pending.clear();
+    endResetModel();
+}
+
+void LogMessageModel::setFlushRate(int flushesPerSecond)
+{
+    _flushTimer.setInterval(1000 / qMax(1, flushesPerSecond));
+}
+
+qint64 LogMessageModel::lagMs() const
+{
+    return _lagMs;
+}
+
+bool LogMessageModel::isRepeat(const LogMessage& a, const LogMessage& b)
+{
+    return a.level == b.level
+        && a.encoded == b.encoded
+        && a.formatId == b.formatId
+        && a.payload == b.payload;
+}
+
+void LogMessageModel::flush()
+{
+    StallMonitor::Scope scope("LogMessageModel::flush");
+
+    if(_lastRowChanged && _count > 0)
+    {
+        QModelIndex last = index(_count - 1);
+        emit dataChanged(last, last, { Qt::DisplayRole });
+    }
+    _lastRowChanged = false;
+
+    const int incoming = (int) _pending.size();
+    if(incoming == 0)
+    {
+        _lagMs = _pendingSince.elapsed();
+        emit flushed();
+        return;
+    }
+
+    const int overflow = _count + incoming - _capacity;
+    if(overflow > 0)
+    {
+        beginRemoveRows(QModelIndex(), 0, overflow - 1);
+        _head = (_head + overflow) % _capacity;
+        _count -= overflow;
+        endRemoveRows();
+    }
+
+    beginInsertRows(QModelIndex(), _count, _count + incoming - 1);
+    for(auto& entry : _pending)
+    {
+        _entries[(_head + _count) % _capacity] = std::move(entry);
+        _count++;
+    }
+    endInsertRows();
+
+    _pending.clear();
+    _lagMs = _pendingSince.elapsed();
+    emit flushed();
+}
+
+LogMessageModel::Entry& LogMessageModel::at(int row)
+{
+    return _entries[(_head + row) % _capacity];
+}
+
+const LogMessageModel::Entry& LogMessageModel::at(int row) const
+{
+    return _entries[(_head + row) % _capacity];
+}
@@ -0,0 +1,70 @@
+#ifndef LOGMESSAGEMODEL_H
+#define LOGMESSAGEMODEL_H
+
+#include <QAbstractListModel>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <deque>
+#include <vector>
+
+#include "logmessage.h"
+
+/*
+ * Fixed-capacity list of debug messages. Appended messages are queued and
+ * inserted in batches at most flushRate times per second; once the capacity
+ * is reached the oldest messages are dropped. Consecutive identical messages
+ * are collapsed into one row with a repeat count.
+ */
+class LogMessageModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_CAPACITY = 100000;
+    static constexpr int DEFAULT_FLUSH_RATE = 20;
+
+    explicit LogMessageModel(const LogDictionary& dictionary, QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    void append(const LogMessage& message);
+    void clear();
+    void refresh();
+
+    void setCapacity(int capacity);
+    void setFlushRate(int flushesPerSecond);
+    // How long the messages of the last flush waited for it, including the
+    // flush itself. Stays near the flush interval while the view keeps up.
+    qint64 lagMs() const;
+
+signals:
+    void flushed();
+
+private:
+    struct Entry
+    {
+        LogMessage message;
+        uint32_t repeat = 1;
+    };
+
+    static bool isRepeat(const LogMessage& a, const LogMessage& b);
+
+    void flush();
+    Entry& at(int row);
+    const Entry& at(int row) const;
+
+    const LogDictionary& _dictionary;
+    std::vector<Entry> _entries;
+    int _head = 0;
+    int _count = 0;
+    int _capacity = DEFAULT_CAPACITY;
+
+    std::deque<Entry> _pending;
+    bool _lastRowChanged = false;
+    QTimer _flushTimer;
+    QElapsedTimer _pendingSince;
+    qint64 _lagMs = 0;
+};
+
+#endif // LOGMESSAGEMODEL_H
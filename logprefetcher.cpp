@@ -0,0 +1,263 @@
+#include "logprefetcher.h"
+#include "diskwriter.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QStandardPaths>
+#include <algorithm>
+
+LogPrefetcher::LogPrefetcher(QObject* parent)
+    : QObject(parent)
+{
+    connect(&DiskWriter::instance(), &DiskWriter::finished, this, [this](quint64 file, const QString& path) {
+        onWritten(file, path);
+    });
+}
+
+void LogPrefetcher::setSensorDevice(QSharedPointer<Sensor> sensor)
+{
+    if(_sensor)
+        disconnect(_sensor.get(), nullptr, this, nullptr);
+
+    _sensor = sensor;
+    _queue.clear();
+    _activeRef = Packet::INVALID_REF;
+    _paused = false;
+
+    if(_sensor)
+    {
+        connect(_sensor.get(), &Sensor::onDataTransmissionCompleted, this, &LogPrefetcher::onDataReceived);
+        connect(_sensor.get(), &Sensor::onStatusResponse, this, &LogPrefetcher::onStatusResponse);
+    }
+}
+
+void LogPrefetcher::setEnabled(bool enabled)
+{
+    _enabled = enabled;
+    if(!_enabled)
+        _queue.clear();
+}
+
+bool LogPrefetcher::isEnabled() const
+{
+    return _enabled;
+}
+
+void LogPrefetcher::prefetch(const QList<LogListPacket::LogItem>& items)
+{
+    if(!_enabled || !_sensor)
+        return;
+
+    QList<LogListPacket::LogItem> newest = items;
+    std::sort(newest.begin(), newest.end(), [](const auto& a, const auto& b) {
+        return a.modified > b.modified;
+    });
+
+    _queue.clear();
+    for(const auto& item : newest)
+    {
+        if(_queue.size() >= MAX_PREFETCH)
+            break;
+        if(!isCached(item) && !isActive(item.id))
+            _queue.push_back(item);
+    }
+
+    startNext();
+}
+
+void LogPrefetcher::pause()
+{
+    _paused = true;
+}
+
+void LogPrefetcher::resume()
+{
+    _paused = false;
+    startNext();
+}
+
+bool LogPrefetcher::isActive() const
+{
+    return _activeRef != Packet::INVALID_REF;
+}
+
+bool LogPrefetcher::isActive(uint32_t logId) const
+{
+    return isActive() && _active.id == logId;
+}
+
+uint8_t LogPrefetcher::takeActive()
+{
+    // The caller receives the rest of the transfer under the same reference
+    uint8_t ref = _activeRef;
+    _activeRef = Packet::INVALID_REF;
+    return ref;
+}
+
+QString LogPrefetcher::cacheDirectory(const QString& deviceId)
+{
+    QString id = deviceId;
+    id.replace(':', '-');
+
+    QString root = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/logs";
+    return deviceId.isEmpty() ? root : root + "/" + id;
+}
+
+QString LogPrefetcher::cachePath(const QString& deviceId, const LogListPacket::LogItem& item)
+{
+    // Modification time and size are part of the name, a rewritten log is a new entry
+    return cacheDirectory(deviceId) + QString::asprintf("/%u-%llu-%u.sbem",
+        item.id, (unsigned long long) item.modified, item.size);
+}
+
+bool LogPrefetcher::isCached(const LogListPacket::LogItem& item) const
+{
+    if(!_sensor)
+        return false;
+
+    const QString path = cachePath(_sensor->deviceId(), item);
+    return _writing.contains(path) || QFile::exists(path);
+}
+
+QByteArray LogPrefetcher::readCached(const LogListPacket::LogItem& item) const
+{
+    if(!_sensor)
+        return QByteArray();
+
+    const QString path = cachePath(_sensor->deviceId(), item);
+    auto writing = _writing.constFind(path);
+    if(writing != _writing.constEnd())
+        return *writing;
+
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    // Eviction goes by modification time, so a read marks the log as recently used
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return file.readAll();
+}
+
+void LogPrefetcher::store(const LogListPacket::LogItem& item, const QByteArray& data)
+{
+    if(!_sensor)
+        return;
+
+    // Written in the background under a temporary name, so a partial file is never taken as cached
+    const QString path = cachePath(_sensor->deviceId(), item);
+    _writing.insert(path, data);
+    _writes.insert(DiskWriter::instance().save(path, data), path);
+}
+
+void LogPrefetcher::prune(const QList<LogListPacket::LogItem>& items)
+{
+    if(!_sensor)
+        return;
+
+    QSet<QString> listed;
+    for(const auto& item : items)
+        listed.insert(QFileInfo(cachePath(_sensor->deviceId(), item)).fileName());
+
+    QDir directory(cacheDirectory(_sensor->deviceId()));
+    for(const QString& name : directory.entryList({ "*.sbem" }, QDir::Files))
+    {
+        if(!listed.contains(name) && !_writing.contains(directory.filePath(name)))
+            directory.remove(name);
+    }
+}
+
+void LogPrefetcher::onWritten(quint64 file, const QString& path)
+{
+    // A failed write leaves the log uncached, it is downloaded again when needed
+    if(!_writes.remove(file))
+        return;
+
+    if(!_writes.values().contains(path))
+        _writing.remove(path);
+    evict();
+}
+
+void LogPrefetcher::evict()
+{
+    QList<QFileInfo> files;
+    qint64 total = 0;
+    QDirIterator it(cacheDirectory(QString()), { "*.sbem" }, QDir::Files, QDirIterator::Subdirectories);
+    while(it.hasNext())
+    {
+        it.next();
+        files.push_back(it.fileInfo());
+        total += files.back().size();
+    }
+
+    if(total <= MAX_CACHE_BYTES)
+        return;
+
+    std::sort(files.begin(), files.end(), [](const QFileInfo& a, const QFileInfo& b) {
+        return a.lastModified() < b.lastModified();
+    });
+
+    for(const QFileInfo& info : files)
+    {
+        if(total <= MAX_CACHE_BYTES)
+            break;
+        if(_writing.contains(info.filePath()))
+            continue;
+        if(QFile::remove(info.filePath()))
+        {
+            qInfo("Evicted %s from the log cache", info.filePath().toStdString().c_str());
+            total -= info.size();
+        }
+    }
+}
+
+void LogPrefetcher::startNext()
+{
+    if(!_enabled || _paused || !_sensor || isActive())
+        return;
+
+    while(!_queue.isEmpty())
+    {
+        LogListPacket::LogItem item = _queue.takeFirst();
+        if(isCached(item))
+            continue;
+
+        CommandPacket::Params params;
+        params.readLog.logIndex = (uint16_t) item.id;
+
+        _active = item;
+        _activeRef = _sensor->sendCommand(CommandPacket::CmdReadLog, params);
+        if(_activeRef != Packet::INVALID_REF)
+            qInfo("Prefetching log %u (ref %u)", item.id, _activeRef);
+        return;
+    }
+}
+
+void LogPrefetcher::onDataReceived(uint8_t ref, const QByteArray& data)
+{
+    if(!isActive() || ref != _activeRef)
+        return;
+
+    store(_active, data);
+    finishActive();
+}
+
+void LogPrefetcher::onStatusResponse(uint8_t ref, uint16_t status)
+{
+    // Successful transfers end in onDataReceived, this catches failures
+    if(!isActive() || ref != _activeRef)
+        return;
+
+    qInfo("Prefetch of log %u failed with status %u", _active.id, status);
+    finishActive();
+}
+
+void LogPrefetcher::finishActive()
+{
+    _activeRef = Packet::INVALID_REF;
+    emit idle();
+    startNext();
+}
@@ -0,0 +1,78 @@
+#ifndef LOGPREFETCHER_H
+#define LOGPREFETCHER_H
+
+#include <QObject>
+#include <QHash>
+#include <QSharedPointer>
+
+#include "sensor.h"
+
+/*
+ * Downloads the newest logs of a sensor into a local cache while the link is
+ * otherwise idle, so an explicit download can be served from the cache.
+ *
+ * The protocol has no way to cancel a transfer, so a prefetch in flight always
+ * runs to completion. Interactive requests get priority by stopping the queue:
+ * pause() prevents further prefetches, and an interactive download of the log
+ * currently being prefetched can adopt the transfer with takeActive().
+ *
+ * Cached logs are written by the DiskWriter. Until a file is in place its
+ * contents are kept in memory, so a log counts as cached as soon as it is
+ * stored. Logs no longer on the sensor are dropped with prune(), and the
+ * least recently used ones once the cache exceeds MAX_CACHE_BYTES.
+ */
+class LogPrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_PREFETCH = 2;
+    static constexpr qint64 MAX_CACHE_BYTES = 256LL * 1024 * 1024; // Of all sensors together
+
+    explicit LogPrefetcher(QObject* parent = nullptr);
+
+    void setSensorDevice(QSharedPointer<Sensor> sensor);
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    // Queues the newest logs of a listing that are not cached yet
+    void prefetch(const QList<LogListPacket::LogItem>& items);
+    void pause();
+    void resume();
+
+    bool isActive() const;
+    bool isActive(uint32_t logId) const;
+    uint8_t takeActive();
+
+    static QString cachePath(const QString& deviceId, const LogListPacket::LogItem& item);
+    bool isCached(const LogListPacket::LogItem& item) const;
+    QByteArray readCached(const LogListPacket::LogItem& item) const;
+    void store(const LogListPacket::LogItem& item, const QByteArray& data);
+    // Drops the cached logs of the sensor that are not in its latest full listing
+    void prune(const QList<LogListPacket::LogItem>& items);
+
+signals:
+    // Emitted when a transfer started by the prefetcher ends, stored or not
+    void idle();
+
+private:
+    void startNext();
+    void onDataReceived(uint8_t ref, const QByteArray& data);
+    void onStatusResponse(uint8_t ref, uint16_t status);
+    void finishActive();
+    void onWritten(quint64 file, const QString& path);
+    void evict();
+
+    static QString cacheDirectory(const QString& deviceId);
+
+    QSharedPointer<Sensor> _sensor;
+    QList<LogListPacket::LogItem> _queue;
+    LogListPacket::LogItem _active = {};
+    uint8_t _activeRef = Packet::INVALID_REF;
+    bool _enabled = false;
+    bool _paused = false;
+    QHash<QString, QByteArray> _writing; // Stored logs by path until the writer has them in place
+    QHash<quint64, QString> _writes; // Writer file id -> path
+};
+
+#endif // LOGPREFETCHER_H
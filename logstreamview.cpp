@@ -1,13 +1,46 @@
 #include "logstreamview.h"
 #include "ui_logstreamview.h"
+#include "loghistorydialog.h"
+#include "stallmonitor.h"
 
 #include <QDateTime>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QScrollBar>
 
 LogStreamView::LogStreamView(QWidget *parent)
     : QDialog(parent)
     , ui(new Ui::LogStreamView)
+    , model(dictionary)
 {
     ui->setupUi(this);
+    ui->messages->setModel(&model);
+    ui->messages->setLayoutMode(QListView::Batched);
+
+    connect(&model, &LogMessageModel::rowsAboutToBeInserted, this, [this]() {
+        auto* scrollBar = ui->messages->verticalScrollBar();
+        followTail = scrollBar->value() == scrollBar->maximum();
+    });
+    connect(&model, &LogMessageModel::flushed, this, &LogStreamView::onMessagesFlushed);
+
+    ui->levelCombo->addItem("Fatal", CommandPacket::Params::DebugLogParams::LogLevelFatal);
+    ui->levelCombo->addItem("Error", CommandPacket::Params::DebugLogParams::LogLevelError);
+    ui->levelCombo->addItem("Warning", CommandPacket::Params::DebugLogParams::LogLevelWarning);
+    ui->levelCombo->addItem("Info", CommandPacket::Params::DebugLogParams::LogLevelInfo);
+    ui->levelCombo->addItem("Verbose", CommandPacket::Params::DebugLogParams::LogLevelVerbose);
+    ui->levelCombo->setCurrentIndex(ui->levelCombo->findData(CommandPacket::Params::DebugLogParams::LogLevelInfo));
+
+    connect(ui->levelCombo, &QComboBox::currentIndexChanged, this, &LogStreamView::onStreamSettingsChanged);
+    connect(ui->userSourceCheck, &QCheckBox::toggled, this, &LogStreamView::onStreamSettingsChanged);
+    connect(ui->systemSourceCheck, &QCheckBox::toggled, this, &LogStreamView::onStreamSettingsChanged);
+
+    restoreTimer.setInterval(1000);
+    connect(&restoreTimer, &QTimer::timeout, this, &LogStreamView::onRestoreTimeout);
+    levelChangeTimer.start();
+    calmTimer.start();
+
+    connect(ui->loadDictionaryButton, &QPushButton::clicked, this, &LogStreamView::onLoadDictionary);
+    connect(ui->historyButton, &QPushButton::clicked, this, &LogStreamView::onShowHistory);
 }
 
 LogStreamView::~LogStreamView()
@@ -17,39 +50,175 @@ LogStreamView::~LogStreamView()
 
 void LogStreamView::setSensorDevice(QSharedPointer<Sensor> sensor)
 {
-    ui->messages->clear();
+    model.clear();
+    followTail = true;
+    streamLevel = selectedLevel();
+    laggingFlushes = 0;
+    restoreTimer.stop();
+    ui->throttleLabel->clear();
 
     if(this->sensor)
     {
         this->sensor->stopStreamingLogMessages();
         disconnect(this->sensor.get(), &Sensor::onReceiveLogStream, this, &LogStreamView::onMessage);
+        disconnect(this->sensor.get(), &Sensor::onReceiveEncodedLogStream, this, &LogStreamView::onEncodedMessage);
+        recorder.close();
     }
 
     this->sensor = sensor;
 
     if(this->sensor)
     {
-        this->sensor->startStreamingLogMessages();
         connect(this->sensor.get(), &Sensor::onReceiveLogStream, this, &LogStreamView::onMessage);
+        connect(this->sensor.get(), &Sensor::onReceiveEncodedLogStream, this, &LogStreamView::onEncodedMessage);
+
+        QString directory = DebugLogRecorder::defaultDirectory(this->sensor->deviceId());
+        if(!recorder.open(directory))
+            qInfo("Failed to open debug log recording directory %s", directory.toStdString().c_str());
+
+        startStreaming();
     }
 }
 
 void LogStreamView::onMessage(const DebugMessagePacket& packet)
 {
-    static const QString levelLabels[] = { "[FATAL]", "[ERROR]", "[WARNING]", "[INFO]", "[VERBOSE]" };
+    StallMonitor::Scope scope("LogStreamView::onMessage");
+
+    LogMessage message = LogMessage::fromPacket(packet);
+    recorder.append(message);
+    model.append(message);
+}
+
+void LogStreamView::onEncodedMessage(const EncodedDebugMessagePacket& packet)
+{
+    StallMonitor::Scope scope("LogStreamView::onEncodedMessage");
+
+    LogMessage message = LogMessage::fromPacket(packet);
+    recorder.append(message);
+    model.append(message);
+}
+
+void LogStreamView::onLoadDictionary()
+{
+    QString filename = QFileDialog::getOpenFileName(this, "Load format dictionary", "", "Dictionary (*.txt *.dict);;All files (*)");
+    if(filename.isEmpty())
+        return;
+
+    QString error;
+    if(!dictionary.load(filename, &error))
+    {
+        QMessageBox::warning(this, "Dictionary error", QString::asprintf("Failed to load dictionary: %s", error.toStdString().c_str()));
+        return;
+    }
+
+    ui->dictionaryLabel->setText(QString::asprintf("%lld format strings", (long long) dictionary.size()));
+    model.refresh();
+
+    // Switch an active stream over to the encoded format
+    if(sensor)
+        startStreaming();
+}
+
+void LogStreamView::onShowHistory()
+{
+    LogHistoryDialog historyDialog(recorder, dictionary, this);
+    historyDialog.exec();
+}
+
+void LogStreamView::startStreaming()
+{
+    sensor->startStreamingLogMessages(streamLevel, selectedSources(), dictionary.isEmpty()
+        ? CommandPacket::Params::DebugLogParams::LogFormatText
+        : CommandPacket::Params::DebugLogParams::LogFormatEncoded);
+}
+
+void LogStreamView::onMessagesFlushed()
+{
+    if(followTail)
+        ui->messages->scrollToBottom();
+
+    checkLag();
+}
+
+void LogStreamView::onStreamSettingsChanged()
+{
+    // An explicit selection replaces any automatic throttling
+    streamLevel = selectedLevel();
+    laggingFlushes = 0;
+    restoreTimer.stop();
+    ui->throttleLabel->clear();
+
+    if(sensor)
+        startStreaming();
+}
+
+void LogStreamView::checkLag()
+{
+    const qint64 lag = model.lagMs();
+    if(lag > LAG_LOW_MS)
+        calmTimer.restart();
+
+    // A single slow flush is no reason to throttle, the view must stay behind
+    laggingFlushes = lag > LAG_HIGH_MS ? laggingFlushes + 1 : 0;
+
+    // Give the sensor time to apply the previous change before stepping again
+    if(laggingFlushes >= LAG_HIGH_FLUSHES
+        && streamLevel > CommandPacket::Params::DebugLogParams::LogLevelFatal
+        && levelChangeTimer.elapsed() >= LEVEL_STEP_INTERVAL_MS)
+    {
+        qInfo("Debug log view lags by %lld ms, lowering stream level to %d", (long long) lag, streamLevel - 1);
+        laggingFlushes = 0;
+        setStreamLevel((CommandPacket::Params::DebugLogParams::LogLevel) (streamLevel - 1));
+    }
+}
+
+void LogStreamView::onRestoreTimeout()
+{
+    if(streamLevel >= selectedLevel())
+    {
+        restoreTimer.stop();
+        return;
+    }
+
+    if(calmTimer.elapsed() >= RESTORE_DELAY_MS)
+    {
+        setStreamLevel((CommandPacket::Params::DebugLogParams::LogLevel) (streamLevel + 1));
+        calmTimer.restart();
+    }
+}
+
+void LogStreamView::setStreamLevel(CommandPacket::Params::DebugLogParams::LogLevel level)
+{
+    streamLevel = level;
+    levelChangeTimer.restart();
 
-    uint32_t ms = packet.timestamp % 1000;
-    uint32_t epoch = packet.timestamp / 1000;
+    if(streamLevel < selectedLevel())
+    {
+        int index = ui->levelCombo->findData(streamLevel);
+        ui->throttleLabel->setText("Throttled to " + ui->levelCombo->itemText(index));
+        restoreTimer.start();
+    }
+    else
+    {
+        ui->throttleLabel->clear();
+        restoreTimer.stop();
+    }
 
-    QString line = QString::asprintf("%d.%03d ", epoch, ms);
-    if(packet.level >= 0 && packet.level <= 4)
-        line += levelLabels[packet.level] + " ";
+    if(sensor)
+        startStreaming();
+}
 
-    size_t len = packet.message.get_read_size();
-    auto data = packet.message.get_read_ptr();
-    QByteArray messageBytes((const char*) data, len);
+CommandPacket::Params::DebugLogParams::LogLevel LogStreamView::selectedLevel() const
+{
+    return (CommandPacket::Params::DebugLogParams::LogLevel) ui->levelCombo->currentData().toUInt();
+}
 
-    line += messageBytes.toStdString();
-    ui->messages->addItem(line);
-    ui->messages->scrollToBottom();
+uint8_t LogStreamView::selectedSources() const
+{
+    uint8_t sources = 0;
+    if(ui->userSourceCheck->isChecked())
+        sources |= CommandPacket::Params::DebugLogParams::User;
+    if(ui->systemSourceCheck->isChecked())
+        sources |= CommandPacket::Params::DebugLogParams::System;
+    return sources;
 }
@@ -2,7 +2,11 @@
 #define LOGSTREAMVIEW_H
 
 #include <QDialog>
+#include <QElapsedTimer>
+#include <QTimer>
 #include "sensor.h"
+#include "logmessagemodel.h"
+#include "debuglogrecorder.h"
 
 namespace Ui {
 class LogStreamView;
@@ -13,16 +17,50 @@ class LogStreamView : public QDialog
     Q_OBJECT
 
 public:
+    // The stream level is lowered one step when messages reach the view more
+    // than LAG_HIGH_MS after arriving for LAG_HIGH_FLUSHES flushes in a row, and
+    // raised back one step at a time once the lag has stayed under LAG_LOW_MS
+    // for RESTORE_DELAY_MS. A view that keeps up lags by about a flush interval.
+    static constexpr int LAG_HIGH_MS = 250;
+    static constexpr int LAG_HIGH_FLUSHES = 3;
+    static constexpr int LAG_LOW_MS = 100;
+    static constexpr int LEVEL_STEP_INTERVAL_MS = 1000;
+    static constexpr int RESTORE_DELAY_MS = 5000;
+
     explicit LogStreamView(QWidget *parent = nullptr);
     ~LogStreamView();
 
     void setSensorDevice(QSharedPointer<Sensor> sensor);
     void onMessage(const DebugMessagePacket& packet);
+    void onEncodedMessage(const EncodedDebugMessagePacket& packet);
 
 private:
+    void onLoadDictionary();
+    void onShowHistory();
+    void startStreaming();
+    void onMessagesFlushed();
+    void onStreamSettingsChanged();
+    void onRestoreTimeout();
+    void checkLag();
+    void setStreamLevel(CommandPacket::Params::DebugLogParams::LogLevel level);
+
+    CommandPacket::Params::DebugLogParams::LogLevel selectedLevel() const;
+    uint8_t selectedSources() const;
+
     Ui::LogStreamView *ui;
 
     QSharedPointer<Sensor> sensor;
+    LogDictionary dictionary;
+    LogMessageModel model;
+    DebugLogRecorder recorder;
+    bool followTail = true;
+
+    CommandPacket::Params::DebugLogParams::LogLevel streamLevel =
+        CommandPacket::Params::DebugLogParams::LogLevelInfo;
+    int laggingFlushes = 0;
+    QElapsedTimer levelChangeTimer;
+    QElapsedTimer calmTimer;
+    QTimer restoreTimer;
 };
 
 #endif // LOGSTREAMVIEW_H
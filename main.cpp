@@ -1,11 +1,30 @@
+#include "diskwriter.h"
 #include "mainwindow.h"
+#include "stallmonitor.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    QApplication::setOrganizationName("Movesense");
+    QApplication::setApplicationName("movesense-offline-configurator");
+
+    // Logs and recordings still queued for the disk writer are completed before exiting
+    QObject::connect(&a, &QCoreApplication::aboutToQuit, []() { DiskWriter::instance().flush(); });
+
+    StallMonitor::instance().start();
+
     MainWindow w;
     w.show();
-    return a.exec();
+    int result = a.exec();
+
+    StallMonitor::instance().stop();
+
+    // Set MOVESENSE_STALL_REPORT to a file path to keep the report of a session
+    QString reportPath = qEnvironmentVariable("MOVESENSE_STALL_REPORT");
+    if(!reportPath.isEmpty())
+        StallMonitor::instance().dump(reportPath);
+
+    return result;
 }
@@ -1,23 +1,32 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
 #include "protocol/ProtocolConstants.hpp"
+#include "stallmonitor.h"
+#include "stallreportdialog.h"
 
 #include <QtLogging>
 #include <QMessageBox>
-#include <QLayout>
-#include <QComboBox>
-#include <QCheckBox>
+#include <QSettings>
+#include <QShortcut>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , scanner(this)
+    , sessions(this)
+    , daemon(&sessions, this)
     , ui(new Ui::MainWindow)
     , config({})
-    , sessionDialog(new SessionLogDialog(this))
-    , logStreamView(new LogStreamView(this))
+    , settingsPanel(new SettingsPanel())
 {
     ui->setupUi(this);
 
+    ui->settingsScrollArea->setWidget(settingsPanel);
+    settingsPanel->hide();
+    connect(settingsPanel, &SettingsPanel::edited, this, [this]() {
+        config = settingsPanel->config();
+        onSettingsEdited();
+    });
+
     // Connect button actions
     connect(ui->startScanButton, &QPushButton::clicked, &scanner, &Scanner::start);
     connect(ui->stopScanButton, &QPushButton::clicked, &scanner, &Scanner::stop);
@@ -25,28 +34,51 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->connectButton, &QPushButton::clicked, this, &MainWindow::onConnect);
     connect(ui->disconnectButton, &QPushButton::clicked, this, &MainWindow::onDisconnect);
     connect(ui->applyButton, &QPushButton::clicked, this, &MainWindow::onApplySettings);
+    connect(ui->applyAllButton, &QPushButton::clicked, this, &MainWindow::onApplySettingsToAll);
     connect(ui->resetButton, &QPushButton::clicked, this, &MainWindow::onResetSettings);
     connect(ui->sessionLogsButton, &QPushButton::clicked, this, &MainWindow::onOpenSessionLogs);
     connect(ui->debugButton, &QPushButton::clicked, this, &MainWindow::onOpenDebugStream);
+    connect(ui->liveButton, &QPushButton::clicked, this, &MainWindow::onOpenLiveStream);
+    connect(ui->faultButton, &QPushButton::clicked, this, &MainWindow::onRequestLastFault);
 
-    connect(sessionDialog, &QDialog::finished, this, &MainWindow::onCloseSessionLogs);
-    connect(logStreamView, &QDialog::finished, this, &MainWindow::onCloseDebugStream);
+    QShortcut* reportShortcut = new QShortcut(QKeySequence("Ctrl+Shift+R"), this);
+    connect(reportShortcut, &QShortcut::activated, this, &MainWindow::onShowStallReport);
 
     // Connect device list actions
-    connect(ui->deviceList, &QListWidget::itemSelectionChanged, this, &MainWindow::onSelectDevice);
+    ui->deviceList->setModel(scanner.model());
+    connect(ui->deviceList->selectionModel(), &QItemSelectionModel::currentChanged, this, &MainWindow::onSelectDevice);
+    connect(scanner.model(), &QAbstractItemModel::modelReset, this, &MainWindow::onSelectDevice);
+
+    // Connect session list actions
+    ui->sessionList->setModel(&sessions);
+    connect(ui->sessionList->selectionModel(), &QItemSelectionModel::currentChanged, this, &MainWindow::onSelectSession);
+    connect(&sessions, &QAbstractItemModel::rowsRemoved, this, &MainWindow::onSelectSession);
+
+    connect(&sessions, &SessionManager::stateChanged, this, &MainWindow::onSessionStateChanged);
+    connect(&sessions, &SessionManager::closed, this, &MainWindow::onSessionClosed);
+    connect(&sessions, &SessionManager::errorOccurred, this, &MainWindow::onSessionError);
+    connect(&sessions, &SessionManager::configChanged, this, &MainWindow::onSessionConfigChanged);
+    connect(&sessions, &SessionManager::statusReceived, this, &MainWindow::onSessionStatus);
+    connect(&sessions, &SessionManager::lastFaultReceived, this, &MainWindow::onSessionLastFault);
 
     // Set widget states
     ui->stopScanButton->hide();
-    ui->disconnectButton->hide();
     ui->connectButton->setEnabled(false);
+    updateSessionControls();
 
-    ui->resetButton->setEnabled(false);
-    ui->applyButton->setEnabled(false);
-    ui->sessionLogsButton->setEnabled(false);
-    ui->debugButton->setEnabled(false);
-
-    connect(&scanner, &Scanner::deviceListUpdated, this, &MainWindow::onUpdateDeviceList);
     connect(&scanner, &Scanner::stateChanged, this, &MainWindow::onScannerStateChanged);
+    connect(&scanner, &Scanner::errorOccurred, this, &MainWindow::onScannerError);
+
+    // Lets scripts use the sensors connected here, unless a daemon already serves them
+    QSettings settings;
+    if(settings.value("daemon/enabled", true).toBool())
+    {
+        QString error;
+        if(daemon.listen(SensorDaemon::defaultServerName(), &error))
+            qInfo("Serving sensors on %s", daemon.fullServerName().toStdString().c_str());
+        else
+            qInfo("Not serving sensors: %s", error.toStdString().c_str());
+    }
 }
 
 MainWindow::~MainWindow()
@@ -56,49 +88,70 @@ MainWindow::~MainWindow()
 
 void MainWindow::onConnect()
 {
-    scanner.stop();
-
-    auto devices = scanner.listDevices();
     auto index = ui->deviceList->currentIndex();
     if(!index.isValid())
         return;
-    auto& device = devices.at(index.row());
+    auto device = scanner.model()->device(index.row());
 
-    ui->deviceList->setEnabled(false);
-    ui->connectButton->hide();
-    ui->disconnectButton->show();
+    QString key = DeviceListModel::deviceKey(device);
+    if(!sessions.contains(key))
+    {
+        if(sessions.isFull())
+        {
+            QString msg = QString::asprintf("Already connected to %d sensors, disconnect one first.", sessions.maxConnections());
+            QMessageBox::warning(this, "Connection limit", msg);
+            return;
+        }
 
-    sensor = QSharedPointer<Sensor>(new Sensor(this, device));
-    connect(sensor.get(), &Sensor::onStateChanged, this, &MainWindow::onSensorStateChanged);
-    connect(sensor.get(), &Sensor::onError, this, &MainWindow::onSensorError);
-    connect(sensor.get(), &Sensor::onConfigUpdated, this, &MainWindow::onSensorConfigChanged);
-    connect(sensor.get(), &Sensor::onStatusResponse, this, &MainWindow::onSensorStatus);
+        // Scanning competes with connection setup for the radio
+        scanner.stop();
+        key = sessions.open(device);
+        if(key.isEmpty())
+            return;
+    }
 
-    sensor->connectDevice();
+    ui->sessionList->setCurrentIndex(sessions.index(sessions.rowOf(key)));
 }
 
 void MainWindow::onDisconnect()
 {
-    sensor->disconnectDevice();
+    sessions.close(currentKey);
 }
 
 void MainWindow::onApplySettings()
 {
-    if(sensor)
+    if(auto sensor = currentSensor())
     {
         sensor->sendConfig(config);
         ui->applyButton->setEnabled(false);
+
+        // Other sensors advertising the same configuration no longer need it applied
+        scanner.model()->setTargetConfig(config);
+    }
+}
+
+void MainWindow::onApplySettingsToAll()
+{
+    for(const auto& key : sessions.keys())
+    {
+        // Sensors are only ready for a configuration once they have reported theirs
+        auto sensor = sessions.sensor(key);
+        if(sensor && sessions.config(key))
+            sensor->sendConfig(config);
     }
+
+    ui->applyButton->setEnabled(false);
+    scanner.model()->setTargetConfig(config);
 }
 
 void MainWindow::onResetSettings()
 {
-    if(sensor)
+    if(currentSensor())
     {
         config = {};
         config.wakeUpBehavior = OfflineConfig::WakeUpConnector;
         config.sleepDelay = 30 * 60;
-        onSensorConfigChanged(config);
+        onSessionConfigChanged(currentKey, config);
         onApplySettings();
     }
 }
@@ -109,6 +162,28 @@ void MainWindow::onSelectDevice()
     ui->connectButton->setEnabled(index.isValid());
 }
 
+void MainWindow::onSelectSession()
+{
+    QString key = sessions.key(ui->sessionList->currentIndex().row());
+    if(key == currentKey)
+        return;
+
+    // Unapplied edits belong to the previously selected sensor
+    const QString previousKey = currentKey;
+    currentKey = key;
+    updateSessionHold(previousKey);
+    updateSessionHold(currentKey);
+    ui->applyButton->setEnabled(false);
+
+    auto sensorConfig = sessions.config(currentKey);
+    if(sensorConfig)
+        onSessionConfigChanged(currentKey, *sensorConfig);
+    else
+        settingsPanel->hide();
+
+    updateSessionControls();
+}
+
 void MainWindow::onSettingsEdited()
 {
     ui->applyButton->setEnabled(true);
@@ -116,421 +191,326 @@ void MainWindow::onSettingsEdited()
 
 void MainWindow::onOpenSessionLogs()
 {
-    sessionDialog->show();
-    sessionDialog->setSensorDevice(sensor);
+    auto sensor = currentSensor();
+    if(!sensor)
+        return;
+
+    SessionViews& v = viewsFor(currentKey);
+    if(!v.sessionDialog)
+    {
+        v.sessionDialog = new SessionLogDialog(this);
+        v.sessionDialog->setWindowTitle(v.sessionDialog->windowTitle() + " - " + sensor->name());
+        connect(v.sessionDialog, &QDialog::finished, v.sessionDialog, [this, dialog = v.sessionDialog, key = currentKey]() {
+            dialog->setSensorDevice(nullptr);
+            dialog->hide();
+            updateSessionHold(key);
+        });
+    }
+
+    if(v.sessionDialog->isVisible())
+    {
+        v.sessionDialog->raise();
+        return;
+    }
+
+    v.sessionDialog->show();
+    v.sessionDialog->setSensorDevice(sensor);
+    updateSessionHold(currentKey);
 }
 
-void MainWindow::onCloseSessionLogs()
+void MainWindow::onOpenDebugStream()
 {
-    sessionDialog->setSensorDevice(nullptr);
-    sessionDialog->hide();
+    auto sensor = currentSensor();
+    if(!sensor)
+        return;
+
+    SessionViews& v = viewsFor(currentKey);
+    if(!v.logStreamView)
+    {
+        v.logStreamView = new LogStreamView(this);
+        v.logStreamView->setWindowTitle(v.logStreamView->windowTitle() + " - " + sensor->name());
+        connect(v.logStreamView, &QDialog::finished, v.logStreamView, [this, view = v.logStreamView, key = currentKey]() {
+            view->setSensorDevice(nullptr);
+            view->hide();
+            updateSessionHold(key);
+        });
+    }
+
+    if(v.logStreamView->isVisible())
+    {
+        v.logStreamView->raise();
+        return;
+    }
+
+    v.logStreamView->show();
+    v.logStreamView->setSensorDevice(sensor);
+    updateSessionHold(currentKey);
 }
 
-void MainWindow::onOpenDebugStream()
+void MainWindow::onOpenLiveStream()
 {
-    logStreamView->show();
-    logStreamView->setSensorDevice(sensor);
+    auto sensor = currentSensor();
+    if(!sensor)
+        return;
+
+    SessionViews& v = viewsFor(currentKey);
+    if(!v.liveStreamView)
+    {
+        v.liveStreamView = new LiveStreamView(this);
+        v.liveStreamView->setWindowTitle(v.liveStreamView->windowTitle() + " - " + sensor->name());
+        connect(v.liveStreamView, &QDialog::finished, v.liveStreamView, [this, view = v.liveStreamView, key = currentKey]() {
+            view->setSensorDevice(nullptr);
+            view->hide();
+            updateSessionHold(key);
+        });
+    }
+
+    if(v.liveStreamView->isVisible())
+    {
+        v.liveStreamView->raise();
+        return;
+    }
+
+    v.liveStreamView->show();
+    v.liveStreamView->setSensorDevice(sensor);
+    updateSessionHold(currentKey);
 }
 
-void MainWindow::onCloseDebugStream()
+void MainWindow::onRequestLastFault()
 {
-    logStreamView->setSensorDevice(nullptr);
-    logStreamView->hide();
+    auto sensor = currentSensor();
+    if(!sensor)
+        return;
+
+    const uint8_t ref = sensor->requestLastFault();
+    if(ref == Packet::INVALID_REF)
+    {
+        QMessageBox::information(this, "Last fault", "The sensor firmware does not support reading the last fault.");
+        return;
+    }
+
+    pendingFaultRequests.insert(currentKey, ref);
+    ui->faultButton->setEnabled(false);
 }
 
-void MainWindow::onSensorStateChanged(Sensor::State state)
+void MainWindow::onSessionStateChanged(const QString& key, Sensor::State state)
 {
     switch(state)
     {
         case Sensor::Disconnected:
         {
-            qInfo("Sensor disconnected!");
-            onCloseSessionLogs();
-            onCloseDebugStream();
-            sensor.reset();
-
-            ui->resetButton->setEnabled(false);
-            ui->applyButton->setEnabled(false);
-            ui->sessionLogsButton->setEnabled(false);
-            ui->debugButton->setEnabled(false);
-
-            ui->disconnectButton->hide();
-            ui->connectButton->show();
-
-            ui->deviceList->setEnabled(true);
-
-            auto* settingsWidget = ui->settingsScrollArea->takeWidget();
-            if(settingsWidget)
-                delete settingsWidget;
-
+            qInfo("Sensor %s disconnected!", sessionName(key).toStdString().c_str());
             break;
         }
         case Sensor::Connecting:
         {
-            qInfo("Sensor connecting...");
+            qInfo("Sensor %s connecting...", sessionName(key).toStdString().c_str());
             break;
         }
         case Sensor::DiscoveringServices:
         {
-            qInfo("Discovering sensor services...");
+            qInfo("Discovering services of sensor %s...", sessionName(key).toStdString().c_str());
             break;
         }
         case Sensor::Connected:
         {
-            qInfo("Sensor connected!");
-            ui->sessionLogsButton->setEnabled(true);
-            ui->debugButton->setEnabled(true);
+            qInfo("Sensor %s connected!", sessionName(key).toStdString().c_str());
             break;
         }
     }
+
+    if(key == currentKey)
+        updateSessionControls();
+}
+
+void MainWindow::onSessionClosed(const QString& key)
+{
+    closeViews(key);
+    pendingFaultRequests.remove(key);
+
+    if(key == currentKey)
+    {
+        currentKey.clear();
+        settingsPanel->hide();
+        onSelectSession();
+    }
 }
 
-void MainWindow::onSensorError(Sensor::Error error, QString msg)
+void MainWindow::onSessionError(const QString& key, Sensor::Error error, QString msg)
 {
+    const QString title = "Sensor error - " + sessionName(key);
     switch(error)
     {
     case Sensor::DeviceFault:
     {
         QString message = QString::asprintf("Sensor has encountered an error. Details:\n%s", msg.toStdString().c_str());
-        QMessageBox::warning(this, "Sensor error", message);
+        QMessageBox::warning(this, title, message);
         break;
     }
     default:
         QString message = QString::asprintf("Sensor reported an error: %u", error);
-        QMessageBox::warning(this, "Sensor error", message);
+        QMessageBox::warning(this, title, message);
         break;
     }
 }
 
-void MainWindow::onSensorConfigChanged(const OfflineConfig& config)
+void MainWindow::onSessionConfigChanged(const QString& key, const OfflineConfig& config)
 {
-    this->config = config;
-
-    ui->resetButton->setEnabled(true);
+    StallMonitor::Scope scope("MainWindow::onSessionConfigChanged");
 
-    QWidget* settings = new QWidget(this);
-    QVBoxLayout* layout = new QVBoxLayout(settings);
-
-    auto labelFormatOnOff = [](uint16_t value) {
-        return value > 0 ? QString("On") : QString("Off");
-    };
-
-    auto labelFormatSampleRate = [](uint16_t value) {
-        if(value == 0)
-            return QString("Off");
-        else
-            return QString::asprintf("%d Hz", value);
-    };
-
-    auto labelFormatInterval = [](uint16_t value) {
-        if (value == 0)
-            return QString("Off");
-        else
-        {
-            int h = value / (60 * 60);
-            int m = (value - h * 3600) / 60;
-            int s = value % 60;
-            QString label = "";
-            if(h > 0) label += QString::asprintf("%d h ", h);
-            if(m > 0) label += QString::asprintf("%d min ", m);
-            if(s > 0) label += QString::asprintf("%d s ", s);
-            return label;
-        }
-    };
-
-    QWidget* ecg = createDropmenu(
-        "Single-lead ECG",
-        QList<uint16_t>::fromReadOnlyData(SENSOR_MEAS_SAMPLERATES_ECG),
-        config.measurementParams.bySensor.ECG,
-        [this](uint16_t val) {
-            this->config.measurementParams.bySensor.ECG = val;
-        }, labelFormatSampleRate);
-    layout->addWidget(ecg);
-
-    QWidget* ecgCompression = createToggle(
-        "Use experimental ECG compression",
-        !!(config.optionsFlags & OfflineConfig::OptionsCompressECG),
-        [this](bool enable) {
-            if(enable)
-                this->config.optionsFlags |= OfflineConfig::OptionsCompressECG;
-            else
-                this->config.optionsFlags &= ~OfflineConfig::OptionsCompressECG;
-        });
-    layout->addWidget(ecgCompression);
-
-    QWidget* hr = createDropmenu(
-        "Heart rate (average bpm)",
-        QList<uint16_t>::fromReadOnlyData(SENSOR_MEAS_TOGGLE),
-        config.measurementParams.bySensor.HeartRate,
-        [this](uint16_t val) {
-            this->config.measurementParams.bySensor.HeartRate = val;
-        }, labelFormatOnOff);
-    layout->addWidget(hr);
-
-    QWidget* rr = createDropmenu(
-        "R-to-R intervals (ms)",
-        QList<uint16_t>::fromReadOnlyData(SENSOR_MEAS_TOGGLE),
-        config.measurementParams.bySensor.RtoR,
-        [this](uint16_t val) {
-            this->config.measurementParams.bySensor.RtoR = val;
-        }, labelFormatOnOff);
-    layout->addWidget(rr);
-
-    QWidget* accel = createDropmenu(
-        "Linear acceleration (m/s^2)",
-        QList<uint16_t>::fromReadOnlyData(SENSOR_MEAS_SAMPLERATES_IMU),
-        config.measurementParams.bySensor.Acc,
-        [this](uint16_t val) {
-            this->config.measurementParams.bySensor.Acc = val;
-        }, labelFormatSampleRate);
-    layout->addWidget(accel);
-
-    QWidget* gyro = createDropmenu(
-        "Gyroscope (dps)",
-        QList<uint16_t>::fromReadOnlyData(SENSOR_MEAS_SAMPLERATES_IMU),
-        config.measurementParams.bySensor.Gyro,
-        [this](uint16_t val) {
-            this->config.measurementParams.bySensor.Gyro = val;
-        }, labelFormatSampleRate);
-    layout->addWidget(gyro);
-
-    QWidget* magn = createDropmenu(
-        "Magnetometer (μT)",
-        QList<uint16_t>::fromReadOnlyData(SENSOR_MEAS_SAMPLERATES_IMU),
-        config.measurementParams.bySensor.Magn,
-        [this](uint16_t val) {
-            this->config.measurementParams.bySensor.Magn = val;
-        }, labelFormatSampleRate);
-    layout->addWidget(magn);
-
-    QWidget* temp = createDropmenu(
-        "Temperature (°C)",
-        QList<uint16_t>::fromReadOnlyData(SENSOR_MEAS_TOGGLE),
-        config.measurementParams.bySensor.Temp,
-        [this](uint16_t val) {
-            this->config.measurementParams.bySensor.Temp = val;
-        }, labelFormatOnOff);
-    layout->addWidget(temp);
-
-    QWidget* activity = createDropmenu(
-        "Activity",
-        QList<uint16_t>::fromReadOnlyData(SENSOR_MEAS_PRESETS_ACTIVITY_INTERVALS),
-        config.measurementParams.bySensor.Activity,
-        [this](uint16_t val) {
-            this->config.measurementParams.bySensor.Activity = val;
-        }, labelFormatInterval);
-    layout->addWidget(activity);
-
-    QWidget* tapDetection = createToggle(
-        "Record tap detection events",
-        !!(config.optionsFlags & OfflineConfig::OptionsLogTapGestures),
-        [this](bool enable) {
-            if(enable)
-                this->config.optionsFlags |= OfflineConfig::OptionsLogTapGestures;
-            else
-                this->config.optionsFlags &= ~OfflineConfig::OptionsLogTapGestures;
-        });
-    layout->addWidget(tapDetection);
-
-    QWidget* shakeDetection = createToggle(
-        "Record shake detection events",
-        !!(config.optionsFlags & OfflineConfig::OptionsLogShakeGestures),
-        [this](bool enable) {
-            if(enable)
-                this->config.optionsFlags |= OfflineConfig::OptionsLogShakeGestures;
-            else
-                this->config.optionsFlags &= ~OfflineConfig::OptionsLogShakeGestures;
-        });
-    layout->addWidget(shakeDetection);
-
-    QWidget* shakeToConnect = createToggle(
-        "Shake to turn on BLE (turn off after 30 seconds)",
-        !!(config.optionsFlags & OfflineConfig::OptionsShakeToConnect),
-        [this](bool enable) {
-            if(enable)
-                this->config.optionsFlags |= OfflineConfig::OptionsShakeToConnect;
-            else
-                this->config.optionsFlags &= ~OfflineConfig::OptionsShakeToConnect;
-        });
-    layout->addWidget(shakeToConnect);
+    // Configurations of the other sessions are kept by the session manager
+    if(key != currentKey)
+        return;
 
-    QWidget* dev = createDeviceSettingsItem();
-    layout->addWidget(dev);
+    this->config = config;
 
-    ui->settingsScrollArea->setWidget(settings);
+    settingsPanel->setConfig(config);
+    settingsPanel->show();
+    updateSessionControls();
 }
 
-void MainWindow::onSensorStatus(uint8_t ref, uint16_t status)
+void MainWindow::onSessionStatus(const QString& key, uint8_t ref, uint16_t status)
 {
+    // The fault data normally arrives before its status, so a pending request here got none
+    if(pendingFaultRequests.contains(key) && pendingFaultRequests.value(key) == ref)
+    {
+        pendingFaultRequests.remove(key);
+        if(key == currentKey)
+            ui->faultButton->setEnabled(true);
+
+        if(status < 300)
+            QMessageBox::information(this, "Last fault - " + sessionName(key), "The sensor did not return any fault data.");
+    }
+
     if(status >= 300)
     {
         QString msg = QString::asprintf("Operation failed: %u", status);
-        QMessageBox::warning(this, "Sensor error", msg);
+        QMessageBox::warning(this, "Sensor error - " + sessionName(key), msg);
     }
 }
 
-void MainWindow::onUpdateDeviceList(const QList<QBluetoothDeviceInfo>& devices)
+void MainWindow::onSessionLastFault(const QString& key, const Sensor::LastFault& fault, bool isNew)
 {
-    ui->deviceList->clear();
-    for(const auto& dev : devices)
+    pendingFaultRequests.remove(key);
+    if(key == currentKey)
+        ui->faultButton->setEnabled(true);
+
+    const QString title = "Last fault - " + sessionName(key);
+    if(fault.lastReset == 0)
     {
-        if(dev.name().isEmpty())
-            ui->deviceList->addItem(dev.deviceUuid().toString());
-        else
-            ui->deviceList->addItem(dev.name());
+        QMessageBox::information(this, title, "The sensor has not recorded any faults.");
+        return;
     }
+
+    QString message = QString::asprintf("%s fault before reset at %llu:\n\n",
+        isNew ? "New" : "Previously seen", fault.lastReset);
+    message += fault.details.join("\n");
+    QMessageBox::information(this, title, message);
 }
 
-void MainWindow::onScannerStateChanged(Scanner::State state)
+MainWindow::SessionViews& MainWindow::viewsFor(const QString& key)
 {
-    switch(state)
+    return views[key];
+}
+
+void MainWindow::closeViews(const QString& key)
+{
+    if(!views.contains(key))
+        return;
+
+    SessionViews v = views.take(key);
+    if(v.sessionDialog)
     {
-        case Scanner::Stopped:
-        {
-            ui->startScanButton->show();
-            ui->stopScanButton->hide();
-            break;
-        }
-        case Scanner::Scanning:
-        {
-            ui->startScanButton->hide();
-            ui->stopScanButton->show();
-            break;
-        }
+        v.sessionDialog->setSensorDevice(nullptr);
+        v.sessionDialog->deleteLater();
+    }
+    if(v.logStreamView)
+    {
+        v.logStreamView->setSensorDevice(nullptr);
+        v.logStreamView->deleteLater();
+    }
+    if(v.liveStreamView)
+    {
+        v.liveStreamView->setSensorDevice(nullptr);
+        v.liveStreamView->deleteLater();
     }
 }
 
-QWidget* MainWindow::createDropmenu(
-    const QString& name,
-    const QList<uint16_t>& sampleRates,
-    uint16_t current,
-    std::function<void(uint16_t)> onValueChanged,
-    std::function<QString(uint16_t)> labelFormatter)
+void MainWindow::updateSessionHold(const QString& key)
 {
-    QWidget* item = new QWidget();
-    QGridLayout* layout = new QGridLayout(item);
+    if(key.isEmpty())
+        return;
+
+    // Keeps a session the daemon opened connected while it is in use here
+    bool held = key == currentKey;
+    if(views.contains(key))
     {
-        QLabel* label = new QLabel(name);
-        layout->addWidget(label, 0, 0);
+        const SessionViews& v = views[key];
+        held = held
+            || (v.sessionDialog && v.sessionDialog->isVisible())
+            || (v.logStreamView && v.logStreamView->isVisible())
+            || (v.liveStreamView && v.liveStreamView->isVisible());
+    }
+    sessions.setHeld(key, held);
+}
 
-        QComboBox* dropdown = new QComboBox();
-        int select = 0;
-        for(auto i = 0; i < sampleRates.length(); i++)
-        {
-            uint16_t value = sampleRates[i];
-            QString valueText = labelFormatter(value);
-            dropdown->addItem(valueText, value);
-            if(value == current)
-                select = i;
-        }
-        dropdown->setCurrentIndex(select);
+void MainWindow::updateSessionControls()
+{
+    auto sensor = currentSensor();
+    const bool selected = !sensor.isNull();
+    const bool connected = selected && sessions.state(currentKey) == Sensor::Connected;
+    const bool configured = connected && sessions.config(currentKey).has_value();
+
+    ui->disconnectButton->setEnabled(selected);
+    ui->sessionLogsButton->setEnabled(connected);
+    ui->debugButton->setEnabled(connected);
+    ui->liveButton->setEnabled(connected);
+    ui->faultButton->setEnabled(connected && !pendingFaultRequests.contains(currentKey));
+    ui->resetButton->setEnabled(configured);
+    ui->applyAllButton->setEnabled(configured && sessions.rowCount() > 1);
+    if(!configured)
+        ui->applyButton->setEnabled(false);
 
-        connect(dropdown, &QComboBox::currentIndexChanged, this, [this, onValueChanged, dropdown](int index) {
-            int value = dropdown->itemData(index).toInt();
-            onValueChanged(value);
-            this->onSettingsEdited();
-        });
+    ui->settingsTitle->setText(selected ? "Settings - " + sensor->name() : "Settings");
+}
 
-        layout->addWidget(dropdown, 0, 1);
-    }
-    return item;
+QSharedPointer<Sensor> MainWindow::currentSensor() const
+{
+    return sessions.sensor(currentKey);
 }
 
-QWidget* MainWindow::createToggle(
-    const QString& name,
-    bool current,
-    std::function<void(bool)> onValueChanged)
+QString MainWindow::sessionName(const QString& key) const
 {
-    QWidget* item = new QWidget();
-    QGridLayout* layout = new QGridLayout(item);
-    {
-        QCheckBox* checkbox = new QCheckBox();
-        checkbox->setChecked(current);
-        checkbox->setText(name);
+    auto sensor = sessions.sensor(key);
+    return sensor ? sensor->name() : key;
+}
 
-        connect(checkbox, &QCheckBox::checkStateChanged, this, [this, onValueChanged, checkbox](Qt::CheckState state) {
-            onValueChanged(state == Qt::Checked);
-            this->onSettingsEdited();
-        });
+void MainWindow::onShowStallReport()
+{
+    StallReportDialog reportDialog(this);
+    reportDialog.exec();
+}
 
-        layout->addWidget(checkbox, 0, 0);
-    }
-    return item;
+void MainWindow::onScannerError(const QString& message)
+{
+    QMessageBox::warning(this, "Warning", message, QMessageBox::Ok);
 }
 
-QWidget* MainWindow::createDeviceSettingsItem()
+void MainWindow::onScannerStateChanged(Scanner::State state)
 {
-    QWidget* item = new QWidget();
-    QGridLayout* layout = new QGridLayout(item);
+    switch(state)
     {
-        QLabel* wakeupLabel = new QLabel("Wake up device when");
-        layout->addWidget(wakeupLabel, 0, 0);
-
-        QList<QPair<QString, OfflineConfig::WakeUpBehavior>> wakeupOptionItems = {
-            { "Always on", OfflineConfig::WakeUpAlwaysOn },
-            { "Connectors", OfflineConfig::WakeUpConnector },
-            { "Movement", OfflineConfig::WakeUpMovement },
-            { "Double tap", OfflineConfig::WakeUpDoubleTap },
-        };
-
-        QList<QPair<QString, uint16_t>> sleepDelayItems = {
-            { "Never (double tap to sleep)", 0 },
-            { "30 seconds", 30 },
-            { "1 minute", 60 },
-            { "5 minutes", 5 * 60 },
-            { "15 minutes", 15 * 60 },
-            { "30 minutes", 30 * 60 },
-            { "1 hour", 60 * 60 },
-            { "2 hours", 2 * 60 * 60 },
-            { "3 hours", 3 * 60 * 60 },
-            { "6 hours", 6 * 60 * 60 },
-            { "12 hours", 12 * 60 * 60 }, // Still fits unsigned 16-bit int
-        };
-
-        QComboBox* wakeupOptions = new QComboBox();
+        case Scanner::Stopped:
         {
-            int i = 0;
-            int select = 0;
-            for(auto& item : wakeupOptionItems)
-            {
-                wakeupOptions->addItem(item.first, item.second);
-                if(item.second == this->config.wakeUpBehavior)
-                    select = i;
-                i++;
-            }
-            wakeupOptions->setCurrentIndex(select);
+            ui->startScanButton->show();
+            ui->stopScanButton->hide();
+            break;
         }
-        layout->addWidget(wakeupOptions, 0, 1);
-
-        QLabel* sleepDelayLabel = new QLabel("Automatic sleep after");
-        layout->addWidget(sleepDelayLabel, 1, 0);
-
-        QComboBox* sleepDelayOptions = new QComboBox();
+        case Scanner::Scanning:
         {
-            int i = 0;
-            int select = 0;
-            for(auto& item : sleepDelayItems)
-            {
-                sleepDelayOptions->addItem(item.first, item.second);
-                if(item.second == this->config.sleepDelay)
-                    select = i;
-                i++;
-            }
-            sleepDelayOptions->setCurrentIndex(select);
+            ui->startScanButton->hide();
+            ui->stopScanButton->show();
+            break;
         }
-        layout->addWidget(sleepDelayOptions, 1, 1);
-
-        connect(wakeupOptions, &QComboBox::currentIndexChanged, this, [this, wakeupOptions](int index) {
-            uint8_t value = wakeupOptions->itemData(index).toInt();
-            this->config.wakeUpBehavior = (OfflineConfig::WakeUpBehavior) value;
-            this->onSettingsEdited();
-        });
-
-        connect(sleepDelayOptions, &QComboBox::currentIndexChanged, this, [this, sleepDelayOptions](int index) {
-            uint16_t value = sleepDelayOptions->itemData(index).toInt();
-            this->config.sleepDelay = value;
-            this->onSettingsEdited();
-        });
     }
-    return item;
 }
@@ -2,12 +2,17 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QHash>
 #include <QtBluetooth/QBluetoothServiceDiscoveryAgent>
 
 #include "scanner.h"
+#include "sensordaemon.h"
 #include "sensor.h"
+#include "sessionmanager.h"
 #include "sessionlogdialog.h"
 #include "logstreamview.h"
+#include "livestreamview.h"
+#include "settingspanel.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -24,48 +29,57 @@ public:
     ~MainWindow();
 
 private:
+    // Dialogs of one session, created when first opened
+    struct SessionViews
+    {
+        SessionLogDialog* sessionDialog = nullptr;
+        LogStreamView* logStreamView = nullptr;
+        LiveStreamView* liveStreamView = nullptr;
+    };
+
     void onConnect();
     void onDisconnect();
     void onApplySettings();
+    void onApplySettingsToAll();
     void onResetSettings();
     void onSelectDevice();
+    void onSelectSession();
     void onSettingsEdited();
 
     void onOpenSessionLogs();
-    void onCloseSessionLogs();
-
     void onOpenDebugStream();
-    void onCloseDebugStream();
+    void onOpenLiveStream();
 
-    void onSensorStateChanged(Sensor::State state);
-    void onSensorError(Sensor::Error error, QString msg);
-    void onSensorConfigChanged(const OfflineConfig& config);
-    void onSensorStatus(uint8_t ref, uint16_t status);
+    void onRequestLastFault();
+    void onShowStallReport();
 
-    void onUpdateDeviceList(const QList<QBluetoothDeviceInfo>& devices);
-    void onScannerStateChanged(Scanner::State state);
+    void onSessionStateChanged(const QString& key, Sensor::State state);
+    void onSessionClosed(const QString& key);
+    void onSessionError(const QString& key, Sensor::Error error, QString msg);
+    void onSessionConfigChanged(const QString& key, const OfflineConfig& config);
+    void onSessionStatus(const QString& key, uint8_t ref, uint16_t status);
+    void onSessionLastFault(const QString& key, const Sensor::LastFault& fault, bool isNew);
 
-private:
-    QWidget* createDropmenu(
-        const QString& name,
-        const QList<uint16_t>& sampleRates,
-        uint16_t current,
-        std::function<void(uint16_t)> onValueChanged,
-        std::function<QString(uint16_t)> labelFormatter);
-
-    QWidget* createToggle(
-        const QString& name,
-        bool current,
-        std::function<void(bool)> onValueChanged);
+    void onScannerStateChanged(Scanner::State state);
+    void onScannerError(const QString& message);
 
-    QWidget* createDeviceSettingsItem();
+    SessionViews& viewsFor(const QString& key);
+    void closeViews(const QString& key);
+    void updateSessionHold(const QString& key);
+    void updateSessionControls();
+    QSharedPointer<Sensor> currentSensor() const;
+    QString sessionName(const QString& key) const;
 
+private:
     Ui::MainWindow *ui;
     Scanner scanner;
-    QSharedPointer<Sensor> sensor;
+    SessionManager sessions;
+    SensorDaemon daemon;
+    QString currentKey;
     OfflineConfig config;
 
-    SessionLogDialog* sessionDialog;
-    LogStreamView* logStreamView;
+    QHash<QString, SessionViews> views;
+    QHash<QString, uint8_t> pendingFaultRequests; // Request ref by session key
+    SettingsPanel* settingsPanel;
 };
 #endif // MAINWINDOW_H
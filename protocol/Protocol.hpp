@@ -1,3 +1,4 @@
 #pragma once
 #include "ProtocolConstants.hpp"
 #include "ProtocolPackets.hpp"
+#include "types/Advertisement.hpp"
@@ -8,3 +8,5 @@
 #include "packets/LogListPacket.hpp"
 #include "packets/TimePacket.hpp"
 #include "packets/DebugMessagePacket.hpp"
+#include "packets/EncodedDebugMessagePacket.hpp"
+#include "packets/LiveDataPacket.hpp"
@@ -11,62 +11,91 @@ CommandPacket::~CommandPacket()
 {
 }
 
+using Params = CommandPacket::Params;
+
+using Layout = PacketLayout<
+    Codec::Field<&CommandPacket::command>>;
+
+using ReadLogLayout = Codec::Layout<
+    Codec::Field<&CommandPacket::params, &Params::readLog, &Params::ReadLogParams::logIndex>>;
+
+using ReadLogFilteredLayout = Codec::Layout<
+    Codec::Field<&CommandPacket::params, &Params::readLogFiltered, &Params::ReadLogFilteredParams::logIndex>,
+    Codec::Field<&CommandPacket::params, &Params::readLogFiltered, &Params::ReadLogFilteredParams::measurements>,
+    Codec::Field<&CommandPacket::params, &Params::readLogFiltered, &Params::ReadLogFilteredParams::flags>,
+    Codec::Field<&CommandPacket::params, &Params::readLogFiltered, &Params::ReadLogFilteredParams::timeOffset>,
+    Codec::Field<&CommandPacket::params, &Params::readLogFiltered, &Params::ReadLogFilteredParams::timeSpan>>;
+
+using DebugLogLayout = Codec::Layout<
+    Codec::Field<&CommandPacket::params, &Params::debugLog, &Params::DebugLogParams::logLevel>,
+    Codec::Field<&CommandPacket::params, &Params::debugLog, &Params::DebugLogParams::sources>>;
+
+using LiveStreamLayout = Codec::Layout<
+    Codec::Field<&CommandPacket::params, &Params::liveStream, &Params::LiveStreamParams::measurement>,
+    Codec::Field<&CommandPacket::params, &Params::liveStream, &Params::LiveStreamParams::sampleRate>>;
+
+using LiveStreamStopLayout = Codec::Layout<
+    Codec::Field<&CommandPacket::params, &Params::liveStream, &Params::LiveStreamParams::measurement>>;
+
+// Format was added in protocol 1.2, older clients omit it
+using DebugLogFormatLayout = Codec::Layout<
+    Codec::Field<&CommandPacket::params, &Params::debugLog, &Params::DebugLogParams::format>>;
+
+static_assert(Layout::SIZE + Codec::MaxSize<
+    ReadLogLayout,
+    ReadLogFilteredLayout,
+    LiveStreamLayout,
+    DebugLogLayout>() + DebugLogFormatLayout::SIZE <= Packet::MAX_PACKET_SIZE);
+
 bool CommandPacket::Read(ReadableBuffer& stream)
 {
-    bool result = Packet::Read(stream);
-    result &= stream.read(&command, sizeof(command));
+    if (!Layout::Read(*this, stream))
+        return false;
 
     switch (command)
     {
     case CmdReadLog:
-    {
-        result &= stream.read(
-            &params.readLog.logIndex,
-            sizeof(params.readLog.logIndex));
-        break;
-    }
+        return ReadLogLayout::Read(*this, stream);
+    case CmdReadLogFiltered:
+        return ReadLogFilteredLayout::Read(*this, stream);
+    case CmdStartLiveStream:
+        return LiveStreamLayout::Read(*this, stream);
+    case CmdStopLiveStream:
+        return LiveStreamStopLayout::Read(*this, stream);
     case CmdStartDebugLogStream:
     {
-        result &= stream.read(
-            &params.debugLog.logLevel, 
-            sizeof(params.debugLog.logLevel));
-        result &= stream.read(
-            &params.debugLog.sources,
-            sizeof(params.debugLog.sources));
-        break;
+        if (!DebugLogLayout::Read(*this, stream))
+            return false;
+
+        params.debugLog.format = Params::DebugLogParams::LogFormatText;
+        if (stream.get_read_pos() < stream.get_read_size())
+            return DebugLogFormatLayout::Read(*this, stream);
+        return true;
     }
-    default: break;
+    default:
+        return true;
     }
-
-    return result;
 };
 
 bool CommandPacket::Write(WritableBuffer& stream)
 {
-    bool result = Packet::Write(stream);
-    result &= stream.write(&command, sizeof(command));
+    if (!Layout::Write(*this, stream))
+        return false;
 
     switch (command)
     {
     case CmdReadLog:
-    {
-        result &= stream.write(
-            &params.readLog.logIndex,
-            sizeof(params.readLog.logIndex));
-        break;
-    }
+        return ReadLogLayout::Write(*this, stream);
+    case CmdReadLogFiltered:
+        return ReadLogFilteredLayout::Write(*this, stream);
+    case CmdStartLiveStream:
+        return LiveStreamLayout::Write(*this, stream);
+    case CmdStopLiveStream:
+        return LiveStreamStopLayout::Write(*this, stream);
     case CmdStartDebugLogStream:
-    {
-        result &= stream.write(
-            &params.debugLog.logLevel, 
-            sizeof(params.debugLog.logLevel));
-        result &= stream.write(
-            &params.debugLog.sources,
-            sizeof(params.debugLog.sources));
-        break;
+        return DebugLogLayout::Write(*this, stream)
+            && DebugLogFormatLayout::Write(*this, stream);
+    default:
+        return true;
     }
-    default: break;
-    }
-
-    return result;
 }
@@ -13,6 +13,10 @@ struct CommandPacket : public Packet
         CmdDebugLastFault,
         CmdStartDebugLogStream,
         CmdStopDebugLogStream,
+        CmdReadLogFiltered,
+        CmdStartLiveStream,
+        CmdStopLiveStream,
+        CmdReadTime, // Answered with a TimePacket holding the sensor clock
         CmdCount
     } command;
 
@@ -23,6 +27,26 @@ struct CommandPacket : public Packet
             uint16_t logIndex;
         } readLog;
 
+        struct ReadLogFilteredParams
+        {
+            enum Flags : uint8_t
+            {
+                TimeFromEnd = (1 << 0), // Count time offset back from the end of the log
+            };
+
+            uint16_t logIndex;
+            uint16_t measurements; // Bit mask of OfflineConfig::Measurement indices
+            uint8_t flags;
+            uint32_t timeOffset; // Seconds from the start of the log, or back from its end with TimeFromEnd
+            uint32_t timeSpan; // Seconds, zero to read until the end of the log
+        } readLogFiltered;
+
+        struct LiveStreamParams
+        {
+            uint8_t measurement; // OfflineConfig::Measurement
+            uint16_t sampleRate; // One of SENSOR_MEAS_SAMPLERATES_* or SENSOR_MEAS_ON
+        } liveStream;
+
         struct DebugLogParams
         {
             enum LogLevel : uint8_t
@@ -37,9 +61,15 @@ struct CommandPacket : public Packet
             enum LogSource : uint8_t
             {
                 User = 0x01,
-                System = 0x01,
+                System = 0x02,
             };
-            uint8_t sources;
+            uint8_t sources; // Bitmask of LogSource
+
+            enum LogFormat : uint8_t
+            {
+                LogFormatText = 0,
+                LogFormatEncoded = 1,
+            } format;
 
         } debugLog;
     } params;
@@ -12,11 +12,14 @@ DataPacket::~DataPacket()
 {
 }
 
+using Layout = PacketLayout<
+    Codec::Field<&DataPacket::offset>,
+    Codec::Field<&DataPacket::totalBytes>>;
+static_assert(Layout::SIZE + DataPacket::MAX_PAYLOAD <= Packet::MAX_PACKET_SIZE);
+
 bool DataPacket::Read(ReadableBuffer& stream)
 {
-    bool result = Packet::Read(stream);
-    result &= stream.read(&offset, sizeof(offset));
-    result &= stream.read(&totalBytes, sizeof(totalBytes));
+    bool result = Layout::Read(*this, stream);
 
     size_t len = stream.get_read_size() - stream.get_read_pos();
     data = ReadableBuffer(stream.get_read_ptr() + stream.get_read_pos(), len);
@@ -26,9 +29,7 @@ bool DataPacket::Read(ReadableBuffer& stream)
 
 bool DataPacket::Write(WritableBuffer& stream)
 {
-    bool result = Packet::Write(stream);
-    result &= stream.write(&offset, sizeof(offset));
-    result &= stream.write(&totalBytes, sizeof(totalBytes));
+    bool result = Layout::Write(*this, stream);
     result &= data.write_to(stream);
     return result;
 }
@@ -12,11 +12,14 @@ DebugMessagePacket::~DebugMessagePacket()
 {
 }
 
+using Layout = PacketLayout<
+    Codec::Field<&DebugMessagePacket::level>,
+    Codec::Field<&DebugMessagePacket::timestamp>>;
+static_assert(Layout::SIZE + DebugMessagePacket::MAX_MESSAGE_LEN <= Packet::MAX_PACKET_SIZE);
+
 bool DebugMessagePacket::Read(ReadableBuffer& stream)
 {
-    bool result = Packet::Read(stream);
-    result &= stream.read(&level, sizeof(level));
-    result &= stream.read(&timestamp, sizeof(timestamp));
+    bool result = Layout::Read(*this, stream);
 
     size_t len = stream.get_read_size() - stream.get_read_pos();
     message = ReadableBuffer(stream.get_read_ptr() + stream.get_read_pos(), len);
@@ -26,9 +29,7 @@ bool DebugMessagePacket::Read(ReadableBuffer& stream)
 
 bool DebugMessagePacket::Write(WritableBuffer& stream)
 {
-    bool result = Packet::Write(stream);
-    result &= stream.write(&level, sizeof(level));
-    result &= stream.write(&timestamp, sizeof(timestamp));
+    bool result = Layout::Write(*this, stream);
     result &= message.write_to(stream);
     return result;
 }
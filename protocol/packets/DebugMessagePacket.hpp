@@ -7,7 +7,7 @@ struct DebugMessagePacket : public Packet
     uint32_t timestamp;
     ReadableBuffer message;
 
-    static constexpr size_t MAX_MESSAGE_LEN = MAX_PACKET_SIZE - 5;
+    static constexpr size_t MAX_MESSAGE_LEN = MAX_PACKET_SIZE - 7;
     
     DebugMessagePacket(uint8_t ref);
     virtual ~DebugMessagePacket();
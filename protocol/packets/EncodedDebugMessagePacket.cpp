@@ -0,0 +1,37 @@
+#include "EncodedDebugMessagePacket.hpp"
+
+EncodedDebugMessagePacket::EncodedDebugMessagePacket(uint8_t ref)
+    : Packet(Packet::TypeEncodedDebugMessage, ref)
+    , level(4)
+    , timestamp(0)
+    , formatId(0)
+    , args(nullptr, 0)
+{
+}
+
+EncodedDebugMessagePacket::~EncodedDebugMessagePacket()
+{
+}
+
+using Layout = PacketLayout<
+    Codec::Field<&EncodedDebugMessagePacket::level>,
+    Codec::Field<&EncodedDebugMessagePacket::timestamp>,
+    Codec::Field<&EncodedDebugMessagePacket::formatId>>;
+static_assert(Layout::SIZE + EncodedDebugMessagePacket::MAX_ARGS_LEN <= Packet::MAX_PACKET_SIZE);
+
+bool EncodedDebugMessagePacket::Read(ReadableBuffer& stream)
+{
+    bool result = Layout::Read(*this, stream);
+
+    size_t len = stream.get_read_size() - stream.get_read_pos();
+    args = ReadableBuffer(stream.get_read_ptr() + stream.get_read_pos(), len);
+
+    return result;
+};
+
+bool EncodedDebugMessagePacket::Write(WritableBuffer& stream)
+{
+    bool result = Layout::Write(*this, stream);
+    result &= args.write_to(stream);
+    return result;
+}
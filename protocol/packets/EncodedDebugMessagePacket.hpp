@@ -0,0 +1,28 @@
+#pragma once
+#include "../types/Packet.hpp"
+
+/*
+ * Debug message that refers to a format string in a dictionary generated
+ * from the firmware build instead of carrying the formatted text.
+ *
+ * Arguments are packed in the order of the conversion specifiers in the
+ * format string, little-endian and without padding:
+ *   %d %i %u %x %X %o %c %p   4 bytes (8 bytes with the ll modifier)
+ *   %f %F %e %E %g %G %a %A   4 byte float
+ *   %s                        null-terminated string
+ * A '*' width or precision consumes a 4 byte integer before the value.
+ */
+struct EncodedDebugMessagePacket : public Packet
+{
+    uint8_t level;
+    uint32_t timestamp;
+    uint16_t formatId;
+    ReadableBuffer args;
+
+    static constexpr size_t MAX_ARGS_LEN = MAX_PACKET_SIZE - 9;
+
+    EncodedDebugMessagePacket(uint8_t ref);
+    virtual ~EncodedDebugMessagePacket();
+    virtual bool Read(ReadableBuffer& stream);
+    virtual bool Write(WritableBuffer& stream);
+};
@@ -12,18 +12,17 @@ HandshakePacket::~HandshakePacket()
 {
 }
 
+using Layout = PacketLayout<
+    Codec::Field<&HandshakePacket::version_major>,
+    Codec::Field<&HandshakePacket::version_minor>>;
+static_assert(Layout::SIZE <= Packet::MAX_PACKET_SIZE);
+
 bool HandshakePacket::Read(ReadableBuffer& stream)
 {
-    bool result = Packet::Read(stream);
-    result &= stream.read(&version_major, sizeof(version_major));
-    result &= stream.read(&version_minor, sizeof(version_minor));
-    return result;
+    return Layout::Read(*this, stream);
 };
 
 bool HandshakePacket::Write(WritableBuffer& stream)
 {
-    bool result = Packet::Write(stream);
-    result &= stream.write(&version_major, sizeof(version_major));
-    result &= stream.write(&version_minor, sizeof(version_minor));
-    return result;
+    return Layout::Write(*this, stream);
 }
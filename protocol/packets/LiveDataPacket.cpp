@@ -0,0 +1,36 @@
+#include "LiveDataPacket.hpp"
+
+LiveDataPacket::LiveDataPacket(uint8_t ref)
+    : Packet(Packet::TypeLiveData, ref)
+    , measurement(0)
+    , timestamp(0)
+    , samples(nullptr, 0)
+{
+}
+
+LiveDataPacket::~LiveDataPacket()
+{
+}
+
+using Layout = PacketLayout<
+    Codec::Field<&LiveDataPacket::measurement>,
+    Codec::Field<&LiveDataPacket::timestamp>>;
+static_assert(Layout::SIZE + LiveDataPacket::MAX_PAYLOAD <= Packet::MAX_PACKET_SIZE);
+
+bool LiveDataPacket::Read(ReadableBuffer& stream)
+{
+    bool result = Layout::Read(*this, stream);
+    result &= measurement < OfflineConfig::MeasCount;
+
+    size_t len = stream.get_read_size() - stream.get_read_pos();
+    samples = ReadableBuffer(stream.get_read_ptr() + stream.get_read_pos(), len);
+
+    return result;
+};
+
+bool LiveDataPacket::Write(WritableBuffer& stream)
+{
+    bool result = Layout::Write(*this, stream);
+    result &= samples.write_to(stream);
+    return result;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "../types/Packet.hpp"
+#include "../types/OfflineConfig.hpp"
+
+/*
+ * Samples of a live measurement subscription started with CmdStartLiveStream.
+ * The payload holds consecutive samples of the measurement, each sample made
+ * of the channels described by LiveDataPacket::FORMATS. The timestamp is the
+ * sensor time of the first sample in milliseconds.
+ */
+struct LiveDataPacket : public Packet
+{
+    enum SampleType : uint8_t
+    {
+        SampleInt32,
+        SampleUInt16,
+        SampleFloat32,
+    };
+
+    struct SampleFormat
+    {
+        uint8_t channels;
+        SampleType type;
+    };
+
+    static constexpr SampleFormat FORMATS[OfflineConfig::MeasCount] = {
+        { 1, SampleInt32 },     // MeasECG, microvolts
+        { 1, SampleFloat32 },   // MeasHR, average bpm
+        { 1, SampleUInt16 },    // MeasRR, milliseconds
+        { 3, SampleFloat32 },   // MeasAcc, m/s^2
+        { 3, SampleFloat32 },   // MeasGyro, dps
+        { 3, SampleFloat32 },   // MeasMagn, uT
+        { 1, SampleFloat32 },   // MeasTemp, Celsius
+        { 1, SampleFloat32 },   // MeasActivity
+    };
+
+    static constexpr size_t SampleSize(SampleType type)
+    {
+        return type == SampleUInt16 ? 2 : 4;
+    }
+
+    static constexpr size_t MAX_PAYLOAD = MAX_PACKET_SIZE - 7;
+
+    uint8_t measurement;
+    uint32_t timestamp;
+    ReadableBuffer samples;
+
+    LiveDataPacket(uint8_t ref);
+    virtual ~LiveDataPacket();
+    virtual bool Read(ReadableBuffer& stream);
+    virtual bool Write(WritableBuffer& stream);
+};
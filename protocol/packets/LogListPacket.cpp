@@ -11,32 +11,43 @@ LogListPacket::~LogListPacket()
 {
 }
 
+using Layout = PacketLayout<
+    Codec::Field<&LogListPacket::count>,
+    Codec::Field<&LogListPacket::complete>>;
+
+using ItemLayout = Codec::Layout<
+    Codec::Field<&LogListPacket::LogItem::id>,
+    Codec::Field<&LogListPacket::LogItem::modified>,
+    Codec::Field<&LogListPacket::LogItem::size>>;
+
+static_assert(Layout::SIZE + LogListPacket::MAX_ITEMS * ItemLayout::SIZE <= Packet::MAX_PACKET_SIZE);
+
 bool LogListPacket::Read(ReadableBuffer& stream)
 {
-    bool result = Packet::Read(stream);
-    result &= stream.read(&count, sizeof(count));
-    result &= stream.read(&complete, sizeof(complete));
+    if (!Layout::Read(*this, stream))
+        return false;
+
+    if (count > MAX_ITEMS)
+    {
+        count = 0;
+        return false;
+    }
 
     for (uint8_t i = 0; i < count; i++)
     {
-        result &= stream.read(&items[i].id, sizeof(items[i].id));
-        result &= stream.read(&items[i].modified, sizeof(items[i].modified));
-        result &= stream.read(&items[i].size, sizeof(items[i].size));
+        if (!ItemLayout::Read(items[i], stream))
+            return false;
     }
-    return result;
+    return true;
 };
 
 bool LogListPacket::Write(WritableBuffer& stream)
 {
-    bool result = Packet::Write(stream);
-    result &= stream.write(&count, sizeof(count));
-    result &= stream.write(&complete, sizeof(complete));
+    if (count > MAX_ITEMS)
+        return false;
 
-    for (uint8_t i = 0; i < count; i++)
-    {
-        result &= stream.write(&items[i].id, sizeof(items[i].id));
-        result &= stream.write(&items[i].modified, sizeof(items[i].modified));
-        result &= stream.write(&items[i].size, sizeof(items[i].size));
-    }
+    bool result = Layout::Write(*this, stream);
+    for (uint8_t i = 0; i < count && result; i++)
+        result &= ItemLayout::Write(items[i], stream);
     return result;
 }
@@ -9,22 +9,20 @@ OfflineConfigPacket::~OfflineConfigPacket()
 {
 }
 
+using Layout = PacketLayout<
+    Codec::Field<&OfflineConfigPacket::config, &OfflineConfig::wakeUpBehavior>,
+    Codec::Field<&OfflineConfigPacket::config, &OfflineConfig::sleepDelay>,
+    Codec::Field<&OfflineConfigPacket::config, &OfflineConfig::optionsFlags>,
+    Codec::Field<&OfflineConfigPacket::config, &OfflineConfig::measurementParams>>;
+static_assert(sizeof(OfflineConfig::measurementParams) == OfflineConfig::MeasCount * 2);
+static_assert(Layout::SIZE <= Packet::MAX_PACKET_SIZE);
+
 bool OfflineConfigPacket::Read(ReadableBuffer& stream)
 {
-    bool result = Packet::Read(stream);
-    result &= stream.read(&config.wakeUpBehavior, 1);
-    result &= stream.read(&config.sleepDelay, 2);
-    result &= stream.read(&config.optionsFlags, 1);
-    result &= stream.read(&config.measurementParams, OfflineConfig::MeasCount * 2);
-    return result;
+    return Layout::Read(*this, stream);
 };
 
 bool OfflineConfigPacket::Write(WritableBuffer& stream)
 {
-    bool result = Packet::Write(stream);
-    result &= stream.write(&config.wakeUpBehavior, 1);
-    result &= stream.write(&config.sleepDelay, 2);
-    result &= stream.write(&config.optionsFlags, 1);
-    result &= stream.write(&config.measurementParams, OfflineConfig::MeasCount * 2);
-    return result;
+    return Layout::Write(*this, stream);
 }
@@ -10,16 +10,16 @@ StatusPacket::~StatusPacket()
 {
 }
 
+using Layout = PacketLayout<
+    Codec::Field<&StatusPacket::status>>;
+static_assert(Layout::SIZE <= Packet::MAX_PACKET_SIZE);
+
 bool StatusPacket::Read(ReadableBuffer& stream)
 {
-    bool result = Packet::Read(stream);
-    result &= stream.read(&status, sizeof(status));
-    return result;
+    return Layout::Read(*this, stream);
 };
 
 bool StatusPacket::Write(WritableBuffer& stream)
 {
-    bool result = Packet::Write(stream);
-    result &= stream.write(&status, sizeof(status));
-    return result;
+    return Layout::Write(*this, stream);
 }
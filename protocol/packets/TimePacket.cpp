@@ -10,16 +10,16 @@ TimePacket::~TimePacket()
 {
 }
 
+using Layout = PacketLayout<
+    Codec::Field<&TimePacket::time>>;
+static_assert(Layout::SIZE <= Packet::MAX_PACKET_SIZE);
+
 bool TimePacket::Read(ReadableBuffer& stream)
 {
-    bool result = Packet::Read(stream);
-    result &= stream.read(&time, sizeof(time));
-    return result;
+    return Layout::Read(*this, stream);
 };
 
 bool TimePacket::Write(WritableBuffer& stream)
 {
-    bool result = Packet::Write(stream);
-    result &= stream.write(&time, sizeof(time));
-    return result;
+    return Layout::Write(*this, stream);
 }
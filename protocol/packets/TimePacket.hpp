@@ -1,9 +1,11 @@
 #pragma once
 #include "../types/Packet.hpp"
 
+// Sets the sensor clock. Since protocol 1.5 the sensor also sends one in
+// response to CmdReadTime, with its clock when it handled the command.
 struct TimePacket : public Packet
 {
-    int64_t time;
+    int64_t time; // Microseconds since the Unix epoch
 
     TimePacket(uint8_t ref, int64_t t = 0);
     virtual ~TimePacket();
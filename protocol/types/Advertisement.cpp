@@ -0,0 +1,55 @@
+#include "Advertisement.hpp"
+#include "../utils/Codec.hpp"
+
+using Layout = Codec::Layout<
+    Codec::Field<&Advertisement::magic>,
+    Codec::Field<&Advertisement::format>,
+    Codec::Field<&Advertisement::versionMajor>,
+    Codec::Field<&Advertisement::versionMinor>,
+    Codec::Field<&Advertisement::battery>,
+    Codec::Field<&Advertisement::status>,
+    Codec::Field<&Advertisement::logCount>,
+    Codec::Field<&Advertisement::configHash>>;
+
+// Of the 31 bytes of a legacy advertisement, the flags take 3, the AD header 2
+// and the company identifier 2, which leaves 24
+static_assert(Layout::SIZE <= 24);
+
+using ConfigLayout = Codec::Layout<
+    Codec::Field<&OfflineConfig::wakeUpBehavior>,
+    Codec::Field<&OfflineConfig::sleepDelay>,
+    Codec::Field<&OfflineConfig::optionsFlags>,
+    Codec::Field<&OfflineConfig::measurementParams>>;
+
+uint32_t Advertisement::ConfigHash(const OfflineConfig& config)
+{
+    uint8_t bytes[ConfigLayout::SIZE];
+    WritableBuffer stream(bytes, sizeof(bytes));
+    ConfigLayout::Write(config, stream);
+
+    uint32_t hash = 2166136261u;
+    for (uint8_t byte : bytes)
+    {
+        hash ^= byte;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool Advertisement::IsUpToDate(const OfflineConfig& config) const
+{
+    return configHash == ConfigHash(config);
+}
+
+bool Advertisement::Read(ReadableBuffer& stream)
+{
+    // Newer formats may only append fields, anything shorter isn't ours
+    if (stream.get_read_size() < Layout::SIZE)
+        return false;
+    return Layout::Read(*this, stream) && magic == MAGIC && format >= FORMAT_VERSION;
+}
+
+bool Advertisement::Write(WritableBuffer& stream) const
+{
+    return Layout::Write(*this, stream);
+}
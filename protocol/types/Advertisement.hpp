@@ -0,0 +1,42 @@
+#pragma once
+#include "../utils/Buffers.hpp"
+#include "OfflineConfig.hpp"
+
+/*
+ * Sensor status carried in the manufacturer specific data of the BLE
+ * advertisement, so clients can check a sensor without connecting to it.
+ * The configuration is summarized by ConfigHash(), a 32-bit FNV-1a hash of
+ * the configuration in the same field order as OfflineConfigPacket.
+ *
+ * Stock Movesense firmware advertises its own data under the same company
+ * identifier, so the status starts with MAGIC and has a fixed minimum size.
+ */
+struct Advertisement
+{
+    static constexpr uint16_t COMPANY_ID = 0x009F; // Suunto Oy, used by Movesense sensors
+    static constexpr uint16_t MAGIC = 0x464F; // "OF" on the air
+    static constexpr uint8_t FORMAT_VERSION = 1;
+    static constexpr uint8_t BATTERY_UNKNOWN = 0xFF;
+
+    enum StatusFlags : uint8_t
+    {
+        StatusLogging = (1 << 0),
+        StatusFault = (1 << 1),
+    };
+
+    uint16_t magic = MAGIC;
+    uint8_t format = FORMAT_VERSION;
+    uint8_t versionMajor = 0;
+    uint8_t versionMinor = 0;
+    uint8_t battery = BATTERY_UNKNOWN; // Percent
+    uint8_t status = 0;
+    uint16_t logCount = 0;
+    uint32_t configHash = 0;
+
+    static uint32_t ConfigHash(const OfflineConfig& config);
+
+    bool IsUpToDate(const OfflineConfig& config) const;
+
+    bool Read(ReadableBuffer& stream);
+    bool Write(WritableBuffer& stream) const;
+};
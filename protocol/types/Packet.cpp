@@ -10,18 +10,15 @@ Packet::~Packet()
 {
 }
 
+using Layout = PacketLayout<>;
+static_assert(Layout::SIZE == 2);
+
 bool Packet::Read(ReadableBuffer& stream)
 {
-    bool result = true;
-    result &= stream.read(&type, 1);
-    result &= stream.read(&reference, 1);
-    return result;
+    return Layout::Read(*this, stream);
 };
 
 bool Packet::Write(WritableBuffer& stream)
 {
-    bool result = true;
-    result &= stream.write(&type, 1);
-    result &= stream.write(&reference, 1);
-    return result;
+    return Layout::Write(*this, stream);
 }
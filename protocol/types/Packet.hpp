@@ -1,5 +1,6 @@
 #pragma once
 #include "../utils/Buffers.hpp"
+#include "../utils/Codec.hpp"
 
 #ifndef OFFLINE_BLE_MTU
 #define OFFLINE_BLE_MTU 161
@@ -20,6 +21,8 @@ struct Packet
         TypeLogList = 0x05,
         TypeTime = 0x06,
         TypeDebugMessage = 0x07,
+        TypeEncodedDebugMessage = 0x08,
+        TypeLiveData = 0x09,
     } type;
     uint8_t reference;
 
@@ -28,3 +31,10 @@ struct Packet
     virtual bool Read(ReadableBuffer& stream);
     virtual bool Write(WritableBuffer& stream);
 };
+
+// Wire layout of a packet: the common header followed by the given fields
+template<typename... Fields>
+using PacketLayout = Codec::Layout<
+    Codec::Field<&Packet::type>,
+    Codec::Field<&Packet::reference>,
+    Fields...>;
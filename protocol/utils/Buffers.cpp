@@ -35,6 +35,15 @@ bool WritableBuffer::seek_write(size_t pos)
     return true;
 }
 
+uint8_t* WritableBuffer::reserve_write(size_t len)
+{
+    if (len > m_write_size - m_write_pos)
+        return nullptr;
+    uint8_t* ptr = m_write_ptr + m_write_pos;
+    m_write_pos += len;
+    return ptr;
+}
+
 uint8_t* WritableBuffer::get_write_ptr() const
 {
     return m_write_ptr;
@@ -93,6 +102,15 @@ bool ReadableBuffer::seek_read(size_t pos)
     return true;
 }
 
+const uint8_t* ReadableBuffer::reserve_read(size_t len)
+{
+    if (len > m_read_size - m_read_pos)
+        return nullptr;
+    const uint8_t* ptr = m_read_ptr + m_read_pos;
+    m_read_pos += len;
+    return ptr;
+}
+
 const uint8_t* ReadableBuffer::get_read_ptr() const
 {
     return m_read_ptr;
@@ -16,6 +16,7 @@ public:
     bool write(const void* src, size_t len);
     bool pad(char c, size_t len);
     bool seek_write(size_t pos);
+    uint8_t* reserve_write(size_t len);
     uint8_t* get_write_ptr() const;
     size_t get_write_pos() const;
     size_t get_write_size() const;
@@ -36,6 +37,7 @@ public:
     bool read(void* dst, size_t len);
     bool write_to(WritableBuffer& stream, size_t len = 0);
     bool seek_read(size_t pos);
+    const uint8_t* reserve_read(size_t len);
     const uint8_t* get_read_ptr() const;
     size_t get_read_pos() const;
     size_t get_read_size() const;
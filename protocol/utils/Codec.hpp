@@ -0,0 +1,101 @@
+#pragma once
+#include "Buffers.hpp"
+#include <cstring>
+#include <tuple>
+#include <utility>
+
+/*
+ * Compile-time description of a packet's wire layout.
+ *
+ * A Field names a value by the chain of member pointers that leads to it,
+ * e.g. Field<&CommandPacket::params, &Params::readLog, &ReadLogParams::logIndex>.
+ * A Layout is a list of fields in wire order. Its size is known at compile
+ * time, so reading or writing it needs only one bounds check followed by
+ * straight-line copies at constant offsets.
+ */
+namespace Codec
+{
+    template<typename T>
+    struct MemberType;
+
+    template<typename Class, typename Member>
+    struct MemberType<Member Class::*>
+    {
+        using Type = Member;
+    };
+
+    template<auto... Path>
+    struct Field
+    {
+        static_assert(sizeof...(Path) > 0, "Field needs at least one member pointer");
+
+        using Type = typename MemberType<
+            std::tuple_element_t<sizeof...(Path) - 1, std::tuple<decltype(Path)...>>>::Type;
+
+        static constexpr size_t SIZE = sizeof(Type);
+
+        template<typename T>
+        static auto& get(T& obj)
+        {
+            return (obj .* ... .* Path);
+        }
+    };
+
+    template<typename... Fields>
+    struct Layout
+    {
+        static constexpr size_t SIZE = (Fields::SIZE + ... + 0);
+
+        template<typename T>
+        static bool Read(T& obj, ReadableBuffer& stream)
+        {
+            const uint8_t* src = stream.reserve_read(SIZE);
+            if (!src)
+                return false;
+            Decode(obj, src, std::index_sequence_for<Fields...>{});
+            return true;
+        }
+
+        template<typename T>
+        static bool Write(const T& obj, WritableBuffer& stream)
+        {
+            uint8_t* dst = stream.reserve_write(SIZE);
+            if (!dst)
+                return false;
+            Encode(obj, dst, std::index_sequence_for<Fields...>{});
+            return true;
+        }
+
+    private:
+        static constexpr size_t SIZES[] = { Fields::SIZE..., 0 };
+
+        template<size_t Index>
+        static constexpr size_t Offset()
+        {
+            size_t offset = 0;
+            for (size_t i = 0; i < Index; i++)
+                offset += SIZES[i];
+            return offset;
+        }
+
+        template<typename T, size_t... Index>
+        static void Decode(T& obj, const uint8_t* src, std::index_sequence<Index...>)
+        {
+            (memcpy(&Fields::get(obj), src + Offset<Index>(), Fields::SIZE), ...);
+        }
+
+        template<typename T, size_t... Index>
+        static void Encode(const T& obj, uint8_t* dst, std::index_sequence<Index...>)
+        {
+            (memcpy(dst + Offset<Index>(), &Fields::get(obj), Fields::SIZE), ...);
+        }
+    };
+
+    template<typename... Layouts>
+    constexpr size_t MaxSize()
+    {
+        size_t size = 0;
+        ((size = Layouts::SIZE > size ? Layouts::SIZE : size), ...);
+        return size;
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+
+/*
+ * Lock-free single-producer single-consumer ring buffer.
+ *
+ * push() may only be called from one thread and pop() from one (possibly
+ * different) thread. Samples that do not fit are dropped and counted,
+ * the producer never blocks.
+ */
+template<typename T, size_t Capacity>
+class RingBuffer
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool push(const T& value)
+    {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        const size_t tail = _tail.load(std::memory_order_acquire);
+        if(head - tail == Capacity)
+        {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        _items[head & (Capacity - 1)] = value;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t pop(T* out, size_t maxCount)
+    {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        const size_t head = _head.load(std::memory_order_acquire);
+
+        size_t count = head - tail;
+        if(count > maxCount)
+            count = maxCount;
+
+        for(size_t i = 0; i < count; i++)
+            out[i] = _items[(tail + i) & (Capacity - 1)];
+
+        _tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Empties the buffer and the drop count, neither side may be in use meanwhile
+    void clear()
+    {
+        _head.store(0, std::memory_order_relaxed);
+        _tail.store(0, std::memory_order_relaxed);
+        _dropped.store(0, std::memory_order_relaxed);
+    }
+
+    size_t size() const
+    {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    size_t dropped() const
+    {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+    static constexpr size_t capacity()
+    {
+        return Capacity;
+    }
+
+private:
+    T _items[Capacity];
+    alignas(64) std::atomic<size_t> _head { 0 };
+    alignas(64) std::atomic<size_t> _tail { 0 };
+    std::atomic<size_t> _dropped { 0 };
+};
+
+#endif // RINGBUFFER_H
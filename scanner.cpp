@@ -1,73 +1,160 @@
 #include "scanner.h"
-#include <QMessageBox>
+#include "adapterpool.h"
+#include "sensor.h"
+
+#include <algorithm>
 
 Scanner::Scanner(QObject *parent)
     : QObject { parent }
+    , _model(this)
 {
-    _agent = new QBluetoothDeviceDiscoveryAgent(this);
-    connect(_agent, &QBluetoothDeviceDiscoveryAgent::deviceDiscovered, this, &Scanner::onDeviceFound);
-    connect(_agent, &QBluetoothDeviceDiscoveryAgent::errorOccurred, this, &Scanner::onDiscoveryError);
-    connect(_agent, &QBluetoothDeviceDiscoveryAgent::canceled, this, &Scanner::onDiscoveryStopped);
-    connect(_agent, &QBluetoothDeviceDiscoveryAgent::finished, this, &Scanner::onDiscoveryStopped);
+    _updateTimer.setSingleShot(true);
+    _updateTimer.setInterval(UPDATE_INTERVAL_MS);
+    connect(&_updateTimer, &QTimer::timeout, this, &Scanner::flushPending);
 }
 
 void Scanner::start()
 {
-    if(!_agent->isActive())
+    if(!isActive())
     {
-        _devices.clear();
-        emit deviceListUpdated(_devices);
+        _pending.clear();
+        _updateTimer.stop();
+        _model.clear();
 
-        _agent->start(QBluetoothDeviceDiscoveryAgent::LowEnergyMethod);
+        // Adapters may have been plugged in or out since the last scan
+        createAgents();
+        for(auto agent : _agents)
+            agent->start(QBluetoothDeviceDiscoveryAgent::LowEnergyMethod);
         emit stateChanged(State::Scanning);
     }
 }
 
 void Scanner::stop()
 {
-    if(_agent->isActive())
+    for(auto agent : _agents)
     {
-        _agent->stop();
+        if(agent->isActive())
+            agent->stop();
     }
 }
 
-QList<QBluetoothDeviceInfo> Scanner::listDevices()
+DeviceListModel* Scanner::model()
 {
-    std::lock_guard lck(_mtx);
-    return _devices;
+    return &_model;
 }
 
-void Scanner::onDeviceFound(const QBluetoothDeviceInfo& info)
+void Scanner::onDeviceFound(const QBluetoothDeviceInfo& info, const QBluetoothAddress& adapter)
 {
-    if (!info.name().contains("Movesense"))
+    if(!isSensor(info))
         return;
 
-    std::lock_guard lck(_mtx);
+    const QString key = DeviceListModel::deviceKey(info);
+    AdapterPool::instance().addSighting(key, adapter);
+
+    // Only the latest advertisement of each device is kept until the next update
+    _pending.insert(key, { info, decodeAdvertisement(info) });
+    if(!_updateTimer.isActive())
+        _updateTimer.start();
+}
 
-    bool exists = false;
-    for(auto& dev : _devices)
+void Scanner::onDiscoveryError(QBluetoothDeviceDiscoveryAgent* agent, QBluetoothDeviceDiscoveryAgent::Error err)
+{
+    QString msg = QString::asprintf("Device discovery agent reported an error: %u", err);
+
+    // One failing adapter doesn't end the scan while others are still scanning
+    if(isActive())
     {
-        if (dev.deviceUuid() == info.deviceUuid())
-        {
-            dev = info;
-            exists = true;
-            break;
-        }
+        qInfo("%s (%s)", msg.toStdString().c_str(), agent->objectName().toStdString().c_str());
+        return;
     }
+    emit errorOccurred(msg);
+}
 
-    if(!exists)
-        _devices.push_back(info);
+void Scanner::onDiscoveryStopped()
+{
+    if(isActive())
+        return;
 
-    emit deviceListUpdated(_devices);
+    flushPending();
+    emit stateChanged(State::Stopped);
 }
 
-void Scanner::onDiscoveryError(QBluetoothDeviceDiscoveryAgent::Error err)
+void Scanner::createAgents()
 {
-    QString msg = QString::asprintf("Device discovery agent reported an error: %u", err);
-    QMessageBox::warning(nullptr, "Warning", msg, QMessageBox::Ok);
+    // Deleted later, as this may run from a handler of the previous scan's signals
+    for(auto agent : _agents)
+    {
+        disconnect(agent, nullptr, this, nullptr);
+        agent->deleteLater();
+    }
+    _agents.clear();
+
+    AdapterPool& pool = AdapterPool::instance();
+    pool.refresh();
+
+    QList<QBluetoothAddress> addresses;
+    for(const auto& adapter : pool.adapters())
+        addresses.push_back(adapter.address);
+    if(addresses.size() < 2)
+        addresses = { QBluetoothAddress() };
+
+    for(const auto& address : addresses)
+    {
+        auto agent = address.isNull()
+            ? new QBluetoothDeviceDiscoveryAgent(this)
+            : new QBluetoothDeviceDiscoveryAgent(address, this);
+        agent->setObjectName(address.isNull() ? "default adapter" : address.toString());
+        connect(agent, &QBluetoothDeviceDiscoveryAgent::deviceDiscovered, this, [this, address](const QBluetoothDeviceInfo& info) {
+            onDeviceFound(info, address);
+        });
+        connect(agent, &QBluetoothDeviceDiscoveryAgent::deviceUpdated, this, [this, address](const QBluetoothDeviceInfo& info) {
+            onDeviceFound(info, address);
+        });
+        connect(agent, &QBluetoothDeviceDiscoveryAgent::errorOccurred, this, [this, agent](QBluetoothDeviceDiscoveryAgent::Error err) {
+            onDiscoveryError(agent, err);
+        });
+        connect(agent, &QBluetoothDeviceDiscoveryAgent::canceled, this, &Scanner::onDiscoveryStopped);
+        connect(agent, &QBluetoothDeviceDiscoveryAgent::finished, this, &Scanner::onDiscoveryStopped);
+        _agents.push_back(agent);
+    }
 }
 
-void Scanner::onDiscoveryStopped()
+bool Scanner::isActive() const
 {
-    emit stateChanged(State::Stopped);
+    return std::any_of(_agents.begin(), _agents.end(), [](const QBluetoothDeviceDiscoveryAgent* a) { return a->isActive(); });
+}
+
+void Scanner::flushPending()
+{
+    _updateTimer.stop();
+    if(_pending.isEmpty())
+        return;
+
+    _model.update(_pending.values());
+    _pending.clear();
+}
+
+bool Scanner::isSensor(const QBluetoothDeviceInfo& info)
+{
+    if(!(info.coreConfigurations() & QBluetoothDeviceInfo::LowEnergyCoreConfiguration))
+        return false;
+
+    // The service UUID identifies renamed sensors too. Advertisements that don't
+    // list it, e.g. from older firmware, are matched by the device name instead.
+    if(info.serviceUuids().contains(Sensor::serviceUuid))
+        return true;
+    return info.name().contains("Movesense");
+}
+
+std::optional<Advertisement> Scanner::decodeAdvertisement(const QBluetoothDeviceInfo& info)
+{
+    QByteArray data = info.manufacturerData(Advertisement::COMPANY_ID);
+    if(data.isEmpty())
+        return std::nullopt;
+
+    Advertisement adv;
+    ReadableBuffer stream((const uint8_t*) data.constData(), data.size());
+    if(!adv.Read(stream))
+        return std::nullopt;
+    return adv;
 }
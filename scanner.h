@@ -3,18 +3,29 @@
 
 #include <QObject>
 #include <QBluetoothDeviceDiscoveryAgent>
-#include <mutex>
+#include <QHash>
+#include <QTimer>
 
+#include "devicelistmodel.h"
+
+/*
+ * Scans for sensors with one discovery agent per local adapter, so sensors in
+ * range of any of them are found, and merges the results into one model. The
+ * adapters that found each sensor are reported to the AdapterPool.
+ */
 class Scanner : public QObject
 {
     Q_OBJECT
 public:
+    // Advertisements are collected and applied to the model at most this often
+    static constexpr int UPDATE_INTERVAL_MS = 250;
+
     explicit Scanner(QObject *parent = nullptr);
 
     void start();
     void stop();
 
-    QList<QBluetoothDeviceInfo> listDevices();
+    DeviceListModel* model();
 
     enum State
     {
@@ -23,18 +34,25 @@ public:
     };
 
 signals:
-    void deviceListUpdated(const QList<QBluetoothDeviceInfo>& devices);
     void stateChanged(State state);
+    void errorOccurred(const QString& message);
 
 private:
 
-    void onDeviceFound(const QBluetoothDeviceInfo& info);
-    void onDiscoveryError(QBluetoothDeviceDiscoveryAgent::Error err);
+    void onDeviceFound(const QBluetoothDeviceInfo& info, const QBluetoothAddress& adapter);
+    void onDiscoveryError(QBluetoothDeviceDiscoveryAgent* agent, QBluetoothDeviceDiscoveryAgent::Error err);
     void onDiscoveryStopped();
+    void createAgents();
+    bool isActive() const;
+    void flushPending();
+
+    static bool isSensor(const QBluetoothDeviceInfo& info);
+    static std::optional<Advertisement> decodeAdvertisement(const QBluetoothDeviceInfo& info);
 
-    QBluetoothDeviceDiscoveryAgent* _agent;
-    QList<QBluetoothDeviceInfo> _devices;
-    std::mutex _mtx;
+    QList<QBluetoothDeviceDiscoveryAgent*> _agents;
+    DeviceListModel _model;
+    QHash<QString, DeviceListModel::Device> _pending;
+    QTimer _updateTimer;
 };
 
 #endif // SCANNER_H
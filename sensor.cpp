@@ -1,5 +1,10 @@
 #include "sensor.h"
+#include "bletransport.h"
+#include "stallmonitor.h"
+#include "timesync.h"
 #include <QtLogging>
+#include <QSettings>
+#include <cstring>
 
 const QBluetoothUuid Sensor::serviceUuid = QUuid::fromBytes(SENSOR_GATT_SERVICE_UUID, QSysInfo::LittleEndian);
 
@@ -7,36 +12,44 @@ const QBluetoothUuid Sensor::serviceUuid = QUuid::fromBytes(SENSOR_GATT_SERVICE_
 const QBluetoothUuid Sensor::txUuid = QUuid::fromBytes(SENSOR_GATT_CHAR_RX_UUID, QSysInfo::LittleEndian);
 const QBluetoothUuid Sensor::rxUuid = QUuid::fromBytes(SENSOR_GATT_CHAR_TX_UUID, QSysInfo::LittleEndian);
 
-constexpr uint8_t DEBUG_LOG_STREAM_REF = 10;
-
 Sensor::Sensor(QObject* parent, const QBluetoothDeviceInfo& info)
+    : Sensor(parent, info, new BleTransport(info))
+{
+}
+
+Sensor::Sensor(QObject* parent, const QBluetoothDeviceInfo& info, SensorTransport* transport)
     : QObject { parent }
     , _timeSynced(false)
     , _handshake(Packet::INVALID_REF)
     , _debugRequest(Packet::INVALID_REF)
+    , _lastFaultRead(false)
+    , _versionMajor(0)
+    , _versionMinor(0)
+    , _nextRef(REF_BEGIN)
     , _info(info)
-    , _svc(nullptr)
+    , _transport(transport)
+    , _timeSync(new TimeSync(this))
 {
-    _pController = QLowEnergyController::createCentral(info, this);
-    connect(_pController, &QLowEnergyController::connected, this, &Sensor::onDeviceConnected);
-    connect(_pController, &QLowEnergyController::disconnected, this, &Sensor::onDeviceDisconnected);
-    connect(_pController, &QLowEnergyController::discoveryFinished, this, &Sensor::onFinishServiceDiscovery);
-    connect(_pController, &QLowEnergyController::serviceDiscovered, this, &Sensor::onServiceDiscovered);
-    connect(_pController, &QLowEnergyController::errorOccurred, this, &Sensor::onControllerError);
-    _pController->setRemoteAddressType(QLowEnergyController::PublicAddress);
+    _transport->setParent(this);
+    connect(_transport, &SensorTransport::connected, this, [this]() { emit onStateChanged(State::Connected); });
+    connect(_transport, &SensorTransport::discovering, this, [this]() { emit onStateChanged(State::DiscoveringServices); });
+    connect(_transport, &SensorTransport::ready, this, &Sensor::onTransportReady);
+    connect(_transport, &SensorTransport::disconnected, this, [this]() { emit onStateChanged(State::Disconnected); });
+    connect(_transport, &SensorTransport::received, this, &Sensor::onPacket);
+    connect(_transport, &SensorTransport::errorOccurred, this, &Sensor::onTransportError);
 }
 
 void Sensor::connectDevice()
 {
     qInfo("Connecting to device %s", _info.name().toStdString().c_str());
     emit onStateChanged(State::Connecting);
-    _pController->connectToDevice();
+    _transport->connectToDevice();
 }
 
 void Sensor::disconnectDevice()
 {
     qInfo("Disconnecting from device %s", _info.name().toStdString().c_str());
-    _pController->disconnectFromDevice();
+    _transport->disconnectFromDevice();
 }
 
 uint8_t Sensor::sendConfig(const OfflineConfig& config)
@@ -54,26 +67,52 @@ uint8_t Sensor::sendCommand(CommandPacket::Command cmd, CommandPacket::Params pa
 
 uint8_t Sensor::sendPacket(Packet& packet)
 {
-    if(!_chars.count(txUuid))
-        return packet.INVALID_REF;
-
-    const auto& c = _chars.value(txUuid);
-    if(!c.isValid())
-        return packet.INVALID_REF;
-
     QByteArray data(Packet::MAX_PACKET_SIZE, 0);
     WritableBuffer stream((uint8_t*) data.data(), data.size());
     packet.Write(stream);
     data.resize(stream.get_write_pos());
-    _svc->writeCharacteristic(c, data);
 
+    if(!_transport->write(data))
+        return packet.INVALID_REF;
     return packet.reference;
 }
 
-uint8_t Sensor::syncTime()
+uint8_t Sensor::relayPacket(const QByteArray& packet)
 {
-    uint64_t timestamp_in_microseconds = time(0) * 1000000UL;
-    TimePacket packet(nextRef(), timestamp_in_microseconds);
+    if(packet.size() < 2 || packet.size() > Packet::MAX_PACKET_SIZE)
+        return Packet::INVALID_REF;
+
+    // Streams have fixed references that every listener knows
+    QByteArray data = packet;
+    uint8_t ref = (uint8_t) data[1];
+    if(ref != DEBUG_LOG_STREAM_REF && ref != LIVE_STREAM_REF)
+    {
+        ref = nextRef();
+        data[1] = (char) ref;
+        _relayed.insert(ref);
+    }
+
+    if(!_transport->write(data))
+        return Packet::INVALID_REF;
+    return ref;
+}
+
+void Sensor::syncTime()
+{
+    _timeSync->start();
+}
+
+uint8_t Sensor::readTime()
+{
+    if(!isProtocolVersionAtLeast(1, 5))
+        return Packet::INVALID_REF;
+
+    return sendCommand(CommandPacket::CmdReadTime, {});
+}
+
+uint8_t Sensor::setTime(int64_t timeUs)
+{
+    TimePacket packet(nextRef(), timeUs);
     return sendPacket(packet);
 }
 
@@ -83,17 +122,45 @@ uint8_t Sensor::handshake()
     return sendPacket(packet);
 }
 
-void Sensor::startStreamingLogMessages()
+uint8_t Sensor::requestLastFault()
 {
+    if(!isProtocolVersionAtLeast(1, 1))
+        return Packet::INVALID_REF;
+
+    // Answered from the cache without a transfer, never from within the call
+    if(_lastFaultRead)
+    {
+        const uint8_t ref = nextRef();
+        QMetaObject::invokeMethod(this, [this]() {
+            emit onLastFaultReceived(cachedLastFault(), false);
+        }, Qt::QueuedConnection);
+        return ref;
+    }
+
+    _buffers.remove(_debugRequest);
+    _debugRequest = sendCommand(CommandPacket::CmdDebugLastFault, {});
+    return _debugRequest;
+}
+
+void Sensor::startStreamingLogMessages(
+    CommandPacket::Params::DebugLogParams::LogLevel level,
+    uint8_t sources,
+    CommandPacket::Params::DebugLogParams::LogFormat format)
+{
+    // Encoded messages are only understood by protocol 1.2 and newer
+    if(!isProtocolVersionAtLeast(1, 2))
+        format = CommandPacket::Params::DebugLogParams::LogFormatText;
+
     CommandPacket::Params params = {
         .debugLog = {
-            .logLevel = CommandPacket::Params::DebugLogParams::LogLevelInfo,
-            .sources = CommandPacket::Params::DebugLogParams::System |
-                       CommandPacket::Params::DebugLogParams::User
+            .logLevel = level,
+            .sources = sources,
+            .format = format
         }
     };
 
-    // Use fixed packet reference to avoid conflicts with other packets
+    // Use fixed packet reference to avoid conflicts with other packets.
+    // Sending the command again to an active stream updates its parameters.
     CommandPacket packet(DEBUG_LOG_STREAM_REF, CommandPacket::CmdStartDebugLogStream, params);
     sendPacket(packet);
 }
@@ -103,75 +170,79 @@ void Sensor::stopStreamingLogMessages()
     sendCommand(CommandPacket::CmdStopDebugLogStream, {});
 }
 
-void Sensor::onDeviceConnected()
+uint8_t Sensor::startLiveStream(OfflineConfig::Measurement meas, uint16_t sampleRate)
+{
+    if(!isProtocolVersionAtLeast(1, 4))
+        return Packet::INVALID_REF;
+
+    CommandPacket::Params params;
+    params.liveStream.measurement = meas;
+    params.liveStream.sampleRate = sampleRate;
+
+    // Use fixed packet reference for all live data, like the debug log stream
+    CommandPacket packet(LIVE_STREAM_REF, CommandPacket::CmdStartLiveStream, params);
+    return sendPacket(packet);
+}
+
+void Sensor::stopLiveStream(OfflineConfig::Measurement meas)
 {
-    _pController->discoverServices();
+    CommandPacket::Params params;
+    params.liveStream.measurement = meas;
+    params.liveStream.sampleRate = SENSOR_MEAS_OFF;
+    sendCommand(CommandPacket::CmdStopLiveStream, params);
 }
 
-void Sensor::onDeviceDisconnected()
+bool Sensor::isProtocolVersionAtLeast(uint8_t major, uint8_t minor) const
 {
-    emit onStateChanged(State::Disconnected);
+    return _versionMajor > major || (_versionMajor == major && _versionMinor >= minor);
 }
 
-void Sensor::onServiceDiscovered(const QBluetoothUuid& uuid)
+QString Sensor::deviceId() const
 {
-    qInfo("Found service: %s", uuid.toString().toStdString().c_str());
+    // Addresses are not available on macOS, it uses UUIDs instead
+    if(_info.address().isNull())
+        return _info.deviceUuid().toString(QUuid::WithoutBraces);
+    return _info.address().toString();
+}
 
-    if (uuid == serviceUuid)
-    {
-        qInfo("Offline mode GATT service found!");
-        _svc = _pController->createServiceObject(uuid, this);
-        connect(_svc, &QLowEnergyService::stateChanged, this, &Sensor::onServiceStateChanged);
-        connect(_svc, &QLowEnergyService::characteristicChanged, this, &Sensor::onCharacteristicChanged);
-        _svc->discoverDetails();
-    }
+QString Sensor::name() const
+{
+    return _info.name().isEmpty() ? deviceId() : _info.name();
 }
 
-void Sensor::onServiceStateChanged(QLowEnergyService::ServiceState state)
+QBluetoothAddress Sensor::localAdapter() const
 {
-    switch(state)
-    {
-    case QLowEnergyService::RemoteServiceDiscovering:
-    {
-        emit onStateChanged(State::DiscoveringServices);
-        break;
-    }
-    case QLowEnergyService::RemoteServiceDiscovered:
-    {
-        qInfo("Service discovered.");
-        for(auto& c : _svc->characteristics())
-        {
-            qInfo("Found characteristic %s", c.uuid().toString().toStdString().c_str());
-            _chars[c.uuid()] = c;
+    return _transport->localAdapter();
+}
 
-            if(c.uuid() == rxUuid)
-            {
-                auto desc = c.descriptor(QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration);
-                if (desc.isValid())
-                {
-                    // Enable notifications
-                    _svc->writeDescriptor(desc, QByteArray::fromHex("0100"));
-                }
-                else
-                {
-                    qInfo("Client characteristic configuration descriptor is not valid");
-                }
-            }
-        }
-        _handshake = handshake();
-        break;
-    }
-    default:
-    {
-        qInfo("Service state change: %d", state);
-        break;
-    }
-    }
+TimeSync* Sensor::timeSync() const
+{
+    return _timeSync;
+}
+
+Sensor::LastFault Sensor::cachedLastFault() const
+{
+    QSettings settings;
+    settings.beginGroup("lastFault/" + deviceId());
+
+    LastFault fault;
+    fault.lastReset = settings.value("lastReset", 0).toULongLong();
+    fault.details = settings.value("details").toStringList();
+    return fault;
+}
+
+void Sensor::onTransportReady()
+{
+    _lastFaultRead = false;
+    _handshake = handshake();
 }
 
-void Sensor::onCharacteristicChanged(const QLowEnergyCharacteristic& c, const QByteArray &value)
+void Sensor::onPacket(const QByteArray& value)
 {
-    qInfo("Characteristic changed: %s", c.uuid().toString().toStdString().c_str());
+    StallMonitor::Scope scope("Sensor::onPacket");
+    // Taken first, time sync measures round trips from it
+    const qint64 receivedUs = TimeSync::hostTimeUs();
+
     Packet::Type type;
     uint8_t ref;
     ReadableBuffer buffer((const uint8_t*) value.data(), value.size());
@@ -186,6 +257,12 @@ void Sensor::onCharacteristicChanged(const QLowEnergyCharacteristic& c, const QB
 
     qInfo("RECV packet (ref %u) (type %u) (%lld bytes)", ref, type, value.size());
 
+    // Responses to relayed requests belong to whoever relayed them
+    const bool relayed = _relayed.contains(ref);
+    emit onPacketReceived(value, relayed);
+    if(relayed)
+        return;
+
     switch(type)
     {
     case Packet::TypeHandshake:
@@ -198,11 +275,10 @@ void Sensor::onCharacteristicChanged(const QLowEnergyCharacteristic& c, const QB
         }
 
         qInfo("Handshake - Protocol version %u.%u", packet.version_major, packet.version_minor);
+        _versionMajor = packet.version_major;
+        _versionMinor = packet.version_minor;
 
-        if(packet.version_major == 1 && packet.version_minor >= 1)
-            _debugRequest = sendCommand(CommandPacket::CmdDebugLastFault, {});
-        else
-            sendCommand(CommandPacket::CmdReadConfig, {});
+        sendCommand(CommandPacket::CmdReadConfig, {});
 
         break;
     }
@@ -217,15 +293,35 @@ void Sensor::onCharacteristicChanged(const QLowEnergyCharacteristic& c, const QB
 
         qInfo("Received status %u for request %u", packet.status, ref);
 
+        // A fault request answered with an error or without its data
+        if(ref == _debugRequest)
+        {
+            _buffers.remove(ref);
+            _debugRequest = Packet::INVALID_REF;
+        }
+
         if(_buffers.contains(ref))
         {
             if(packet.status == 200)
             {
+                if(_transfers.contains(ref))
+                {
+                    auto& tracker = _transfers[ref];
+                    tracker.finish();
+
+                    const auto& progress = tracker.progress();
+                    qInfo("Transfer %u completed: %u bytes in %u packets, %lld ms, %.0f B/s",
+                        ref, progress.receivedBytes, progress.packets, progress.elapsedMs,
+                        progress.elapsedMs > 0 ? 1000.0 * progress.receivedBytes / progress.elapsedMs : 0.0);
+                    emit onDataTransmissionProgressUpdate(ref, progress);
+                }
+
                 emit onDataTransmissionCompleted(ref, _buffers[ref]);
             }
 
             _buffers.remove(ref);
         }
+        _transfers.remove(ref);
 
         emit onStatusResponse(packet.reference, packet.status);
         break;
@@ -248,6 +344,17 @@ void Sensor::onCharacteristicChanged(const QLowEnergyCharacteristic& c, const QB
         emit onConfigUpdated(packet.config);
         break;
     }
+    case Packet::TypeTime:
+    {
+        TimePacket packet(ref);
+        if(!packet.Read(buffer))
+        {
+            emit onError(Error::ReadFailure);
+            return;
+        }
+        emit onTimeReceived(ref, packet.time, receivedUs);
+        break;
+    }
     case Packet::TypeLogList:
     {
         LogListPacket packet(ref);
@@ -277,41 +384,31 @@ void Sensor::onCharacteristicChanged(const QLowEnergyCharacteristic& c, const QB
         auto data = packet.data.get_read_ptr();
         QByteArray payload((const char*) data, len);
 
+        if(!_buffers.contains(ref))
+        {
+            _buffers[ref] = QByteArray();
+        }
+
+        auto& buf = _buffers[ref];
+        buf.append(payload);
+
         if(ref == _debugRequest)
         {
-            if(payload.size() >= sizeof(uint64_t))
+            if(buf.size() >= packet.totalBytes)
             {
-                uint64_t lastReset = *reinterpret_cast<const uint64_t*>(payload.data());
-
-                if(lastReset > 0)
-                {
-                    qInfo("Debug info:");
-                    payload.erase(payload.constBegin(), payload.constBegin() + sizeof(lastReset));
-                    for(size_t i = 0; i < payload.size(); i++)
-                    {
-                        if(payload[i] != '\0')
-                        {
-                            size_t len = strnlen(payload.data() + i, payload.size() - i);
-                            std::string line = std::string(payload.data() + i, len);
-                            if(!line.empty())
-                                qInfo("\t%s", line.c_str());
-                            i += len;
-                        }
-                    }
-                }
+                onLastFaultData(buf);
+                _buffers.remove(ref);
+                _debugRequest = Packet::INVALID_REF;
             }
-            sendCommand(CommandPacket::CmdReadConfig, {});
             return;
         }
 
-        if(!_buffers.contains(ref))
-        {
-            _buffers[ref] = QByteArray();
-        }
+        emit onDataReceived(ref, payload);
 
-        auto& buf = _buffers[ref];
-        buf.append(payload);
-        emit onDataTransmissionProgressUpdate(ref, buf.size(), packet.totalBytes);
+        // Progress is coalesced so a fast transfer doesn't flood the receivers
+        auto& tracker = _transfers[ref];
+        if(tracker.update(buf.size(), packet.totalBytes))
+            emit onDataTransmissionProgressUpdate(ref, tracker.progress());
         break;
     }
     case Packet::TypeDebugMessage:
@@ -325,6 +422,28 @@ void Sensor::onCharacteristicChanged(const QLowEnergyCharacteristic& c, const QB
         emit onReceiveLogStream(packet);
         break;
     }
+    case Packet::TypeEncodedDebugMessage:
+    {
+        EncodedDebugMessagePacket packet(ref);
+        if(!packet.Read(buffer))
+        {
+            emit onError(Error::ReadFailure);
+            return;
+        }
+        emit onReceiveEncodedLogStream(packet);
+        break;
+    }
+    case Packet::TypeLiveData:
+    {
+        LiveDataPacket packet(ref);
+        if(!packet.Read(buffer))
+        {
+            emit onError(Error::ReadFailure);
+            return;
+        }
+        emit onReceiveLiveData(packet);
+        break;
+    }
     default:
     {
         qInfo("Ignored packet %u of type %u", ref, type);
@@ -333,35 +452,62 @@ void Sensor::onCharacteristicChanged(const QLowEnergyCharacteristic& c, const QB
     }
 }
 
-void Sensor::onControllerError(QLowEnergyController::Error error)
+void Sensor::onTransportError(SensorTransport::Error error)
 {
-    qInfo("Controller error: %d", error);
-    emit onError(ControllerError);
+    switch(error)
+    {
+    case SensorTransport::UnsupportedDevice:
+        emit onError(UnsupportedDevice);
+        break;
+    case SensorTransport::LinkError:
+        emit onError(ControllerError);
+        break;
+    }
 }
 
-void Sensor::onFinishServiceDiscovery()
+void Sensor::onLastFaultData(const QByteArray& payload)
 {
-    qInfo("Ending service discovery");
-
-    if (!_svc)
+    LastFault fault;
+    if(payload.size() >= (qsizetype) sizeof(fault.lastReset))
     {
-        emit onError(UnsupportedDevice);
-        disconnectDevice();
+        memcpy(&fault.lastReset, payload.data(), sizeof(fault.lastReset));
+
+        // Details are a sequence of null-terminated strings
+        const auto lines = payload.mid(sizeof(fault.lastReset)).split('\0');
+        for(const auto& line : lines)
+        {
+            if(!line.isEmpty())
+                fault.details.push_back(QString::fromUtf8(line));
+        }
     }
-    else
+
+    // Cache per device so an unchanged fault is recognized without reading it again
+    LastFault cached = cachedLastFault();
+    bool isNew = fault.lastReset != cached.lastReset;
+    if(isNew)
     {
-        emit onStateChanged(State::Connected);
+        QSettings settings;
+        settings.beginGroup("lastFault/" + deviceId());
+        settings.setValue("lastReset", (qulonglong) fault.lastReset);
+        settings.setValue("details", fault.details);
     }
+
+    _lastFaultRead = true;
+
+    qInfo("Last fault (reset %llu, %s):", fault.lastReset, isNew ? "new" : "seen before");
+    for(const auto& line : fault.details)
+        qInfo("\t%s", line.toStdString().c_str());
+
+    emit onLastFaultReceived(fault, isNew);
 }
 
-uint8_t Sensor::nextRef() const
+uint8_t Sensor::nextRef()
 {
-    const uint8_t begin = 100;
-    const uint8_t end = 200;
-    static uint8_t ref = begin;
-    if(ref + 1 == end)
-        ref = begin;
+    if(_nextRef + 1 == REF_END)
+        _nextRef = REF_BEGIN;
     else
-        ref += 1;
-    return ref;
+        _nextRef += 1;
+
+    _relayed.remove(_nextRef);
+    return _nextRef;
 }
@@ -2,11 +2,16 @@
 #define SENSOR_H
 
 #include "protocol/Protocol.hpp"
+#include "sensortransport.h"
+#include "transferprogress.h"
 
 #include <QObject>
 #include <QBluetoothDeviceInfo>
-#include <QLowEnergyService>
-#include <QLowEnergyController>
+#include <QBluetoothUuid>
+#include <QMap>
+#include <QSet>
+
+class TimeSync;
 
 class Sensor : public QObject
 {
@@ -17,7 +22,17 @@ public:
     static const QBluetoothUuid rxUuid;
     static const QBluetoothUuid txUuid;
 
+    static constexpr uint8_t DEBUG_LOG_STREAM_REF = 10;
+    static constexpr uint8_t LIVE_STREAM_REF = 11;
+
+    // Range of references for requests, each connection keeps its own sequence
+    static constexpr uint8_t REF_BEGIN = 100;
+    static constexpr uint8_t REF_END = 200;
+
+    // Connects over Bluetooth
     explicit Sensor(QObject* parent, const QBluetoothDeviceInfo& info);
+    // Connects over the given transport and takes ownership of it
+    Sensor(QObject* parent, const QBluetoothDeviceInfo& info, SensorTransport* transport);
 
     void connectDevice();
     void disconnectDevice();
@@ -25,14 +40,48 @@ public:
     uint8_t sendConfig(const OfflineConfig& conf);
     uint8_t sendCommand(CommandPacket::Command cmd, CommandPacket::Params params);
     uint8_t sendPacket(Packet& packet);
-    uint8_t syncTime();
+    // Sends an encoded packet on behalf of another client under a reference of this
+    // connection. Responses to it are only passed on through onPacketReceived,
+    // flagged as relayed.
+    uint8_t relayPacket(const QByteArray& packet);
+    // Runs the round-trip compensated sync of timeSync(), which also happens on connecting
+    void syncTime();
+    // Requires protocol 1.5, the sensor answers through onTimeReceived
+    uint8_t readTime();
+    uint8_t setTime(int64_t timeUs);
     uint8_t handshake();
-
-    void startStreamingLogMessages();
+    uint8_t requestLastFault();
+
+    void startStreamingLogMessages(
+        CommandPacket::Params::DebugLogParams::LogLevel level =
+            CommandPacket::Params::DebugLogParams::LogLevelInfo,
+        uint8_t sources =
+            CommandPacket::Params::DebugLogParams::User |
+            CommandPacket::Params::DebugLogParams::System,
+        CommandPacket::Params::DebugLogParams::LogFormat format =
+            CommandPacket::Params::DebugLogParams::LogFormatText);
     void stopStreamingLogMessages();
 
+    uint8_t startLiveStream(OfflineConfig::Measurement meas, uint16_t sampleRate);
+    void stopLiveStream(OfflineConfig::Measurement meas);
+
     std::vector<uint8_t> downloadData();
 
+    bool isProtocolVersionAtLeast(uint8_t major, uint8_t minor) const;
+    QString deviceId() const;
+    QString name() const;
+    // Null when connecting through the default adapter
+    QBluetoothAddress localAdapter() const;
+    TimeSync* timeSync() const;
+
+    struct LastFault
+    {
+        uint64_t lastReset = 0;
+        QStringList details;
+    };
+
+    LastFault cachedLastFault() const;
+
     enum State
     {
         Disconnected,
@@ -51,37 +100,48 @@ public:
     };
 
 private:
-    void discoverServices();
-    void onDeviceConnected();
-    void onDeviceDisconnected();
-    void onServiceDiscovered(const QBluetoothUuid& uuid);
-    void onServiceStateChanged(QLowEnergyService::ServiceState state);
-    void onCharacteristicChanged(const QLowEnergyCharacteristic& c, const QByteArray &value);
-    void onControllerError(QLowEnergyController::Error error);
-    void onFinishServiceDiscovery();
+    void onTransportReady();
+    void onTransportError(SensorTransport::Error error);
+    void onPacket(const QByteArray& value);
 
-    uint8_t nextRef() const;
+    uint8_t nextRef();
+    void onLastFaultData(const QByteArray& payload);
 
 signals:
     void onStateChanged(State state);
     void onConfigUpdated(const OfflineConfig& config);
     void onLogListReceived(uint8_t ref, const QList<LogListPacket::LogItem>& logs, bool complete);
+    // Each piece of a transfer as it arrives, then all of it once complete
+    void onDataReceived(uint8_t ref, const QByteArray& chunk);
     void onDataTransmissionCompleted(uint8_t cmdRef, const QByteArray& data);
-    void onDataTransmissionProgressUpdate(uint8_t ref, uint32_t received_bytes, uint32_t total_bytes);
+    void onDataTransmissionProgressUpdate(uint8_t ref, const TransferProgress& progress);
     void onStatusResponse(uint8_t ref, uint16_t status);
     void onError(Error err, QString msg = "");
     void onReceiveLogStream(const DebugMessagePacket& msg);
+    void onReceiveEncodedLogStream(const EncodedDebugMessagePacket& msg);
+    void onReceiveLiveData(const LiveDataPacket& packet);
+    void onLastFaultReceived(const Sensor::LastFault& fault, bool isNew);
+    void onPacketReceived(const QByteArray& packet, bool relayed);
+    // Sensor clock in response to readTime(), with the host time it was received at
+    void onTimeReceived(uint8_t ref, qint64 sensorTimeUs, qint64 receivedUs);
 
 private:
     bool _timeSynced;
     uint8_t _handshake;
     uint8_t _debugRequest;
+    // The cached fault was read on this connection. Resetting the sensor drops
+    // the connection, so it can't have changed since.
+    bool _lastFaultRead;
+    uint8_t _versionMajor;
+    uint8_t _versionMinor;
+    uint8_t _nextRef;
 
     QBluetoothDeviceInfo _info;
-    QLowEnergyController* _pController;
-    QLowEnergyService* _svc;
-    QMap<QUuid, QLowEnergyCharacteristic> _chars;
+    SensorTransport* _transport;
+    TimeSync* _timeSync;
     QMap<uint8_t, QByteArray> _buffers;
+    QMap<uint8_t, TransferProgressTracker> _transfers;
+    QSet<uint8_t> _relayed;
 };
 
 #endif // SENSOR_H
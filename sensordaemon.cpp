@@ -0,0 +1,487 @@
+#include "sensordaemon.h"
+
+#include <QtEndian>
+#include <QtLogging>
+
+using namespace DaemonProtocol;
+
+SensorDaemon::SensorDaemon(SessionManager* sessions, QObject* parent)
+    : QObject(parent)
+    , _scanner(this)
+    , _sessions(sessions)
+    , _server(this)
+{
+    // Only processes of the same user may connect
+    _server.setSocketOptions(QLocalServer::UserAccessOption);
+    connect(&_server, &QLocalServer::newConnection, this, &SensorDaemon::onNewConnection);
+
+    _scanTimer.setSingleShot(true);
+    connect(&_scanTimer, &QTimer::timeout, &_scanner, &Scanner::stop);
+    connect(&_scanner, &Scanner::stateChanged, this, &SensorDaemon::onScannerStateChanged);
+    connect(&_scanner, &Scanner::errorOccurred, this, [this](const QString& message) {
+        for(Client* client : _clients)
+        {
+            if(client->scanning)
+                sendError(client, NO_CHANNEL, message);
+        }
+        onScannerStateChanged(Scanner::Stopped);
+    });
+    connect(_scanner.model(), &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex&, int first, int last) {
+        onDevicesChanged(first, last);
+    });
+    connect(_scanner.model(), &QAbstractItemModel::dataChanged, this, [this](const QModelIndex& topLeft, const QModelIndex& bottomRight) {
+        onDevicesChanged(topLeft.row(), bottomRight.row());
+    });
+
+    connect(_sessions, &SessionManager::configChanged, this, &SensorDaemon::onSessionReady);
+    connect(_sessions, &SessionManager::closed, this, &SensorDaemon::onSessionClosed);
+    connect(_sessions, &SessionManager::heldChanged, this, &SensorDaemon::onSessionHeldChanged);
+}
+
+SensorDaemon::~SensorDaemon()
+{
+    close();
+}
+
+QString SensorDaemon::defaultServerName()
+{
+    return "movesense-sensors";
+}
+
+bool SensorDaemon::listen(const QString& name, QString* error)
+{
+    if(_server.listen(name))
+        return true;
+
+    // A server that crashed leaves its socket file behind on Unix. It is only
+    // removed when nothing answers on it, so a running daemon isn't taken over.
+    if(_server.serverError() == QAbstractSocket::AddressInUseError)
+    {
+        QLocalSocket probe;
+        probe.connectToServer(name);
+        if(!probe.waitForConnected(1000))
+        {
+            QLocalServer::removeServer(name);
+            if(_server.listen(name))
+                return true;
+        }
+    }
+
+    if(error)
+        *error = _server.errorString();
+    return false;
+}
+
+void SensorDaemon::close()
+{
+    for(Client* client : QList<Client*>(_clients))
+        client->socket->abort();
+    _server.close();
+}
+
+bool SensorDaemon::isListening() const
+{
+    return _server.isListening();
+}
+
+QString SensorDaemon::fullServerName() const
+{
+    return _server.fullServerName();
+}
+
+int SensorDaemon::clientCount() const
+{
+    return _clients.size();
+}
+
+void SensorDaemon::onNewConnection()
+{
+    while(QLocalSocket* socket = _server.nextPendingConnection())
+    {
+        Client* client = new Client();
+        client->socket = socket;
+        _clients.push_back(client);
+
+        connect(socket, &QLocalSocket::readyRead, this, [this, client]() { onClientData(client); });
+        connect(socket, &QLocalSocket::disconnected, this, [this, client]() { onClientDisconnected(client); });
+        qInfo("Daemon client connected (%lld clients)", _clients.size());
+    }
+}
+
+void SensorDaemon::onClientData(Client* client)
+{
+    client->buffer.append(client->socket->readAll());
+    while(auto frame = take(client->buffer))
+    {
+        onFrame(client, *frame);
+
+        // The frame may have been a reason to drop the client
+        if(!_clients.contains(client))
+            return;
+    }
+}
+
+void SensorDaemon::onClientDisconnected(Client* client)
+{
+    if(!_clients.removeOne(client))
+        return;
+
+    for(const auto& key : client->channels)
+        detach(key, client);
+
+    client->socket->deleteLater();
+    delete client;
+    qInfo("Daemon client disconnected (%lld clients)", _clients.size());
+}
+
+void SensorDaemon::onFrame(Client* client, const Frame& frame)
+{
+    switch(frame.type)
+    {
+    case FrameScan:
+    {
+        if(frame.payload.size() < 4)
+            break;
+        scan(client, (int) qFromLittleEndian<quint32>(frame.payload.constData()));
+        return;
+    }
+    case FrameOpen:
+        open(client, QString::fromUtf8(frame.payload));
+        return;
+    case FrameClose:
+    {
+        if(frame.payload.isEmpty())
+            break;
+        closeChannel(client, (uint8_t) frame.payload[0]);
+        return;
+    }
+    case FramePacket:
+    {
+        // Channel, then at least the packet type and reference
+        if(frame.payload.size() < 3)
+            break;
+        relay(client, (uint8_t) frame.payload[0], frame.payload.mid(1));
+        return;
+    }
+    default:
+        break;
+    }
+
+    // The stream can't be trusted to be in sync after a malformed frame
+    sendError(client, NO_CHANNEL, QString::asprintf("Invalid frame of type %u", frame.type));
+    client->socket->disconnectFromServer();
+    onClientDisconnected(client);
+}
+
+void SensorDaemon::scan(Client* client, int durationMs)
+{
+    client->scanning = true;
+
+    if(_scanning)
+    {
+        // Joins the scan in progress, with what it has found so far
+        onDevicesChanged(0, _scanner.model()->rowCount() - 1);
+        return;
+    }
+
+    _scanTimer.start(qBound(0, durationMs, MAX_SCAN_MS));
+    _scanner.start();
+}
+
+void SensorDaemon::open(Client* client, const QString& key)
+{
+    for(auto it = client->channels.begin(); it != client->channels.end(); it++)
+    {
+        if(it.value() == key)
+        {
+            sendError(client, it.key(), "The device is already open on this channel");
+            return;
+        }
+    }
+
+    uint8_t channel = 0;
+    while(channel < MAX_CHANNELS && client->channels.contains(channel))
+        channel++;
+    if(channel == MAX_CHANNELS)
+    {
+        sendError(client, NO_CHANNEL, "Too many open devices");
+        return;
+    }
+
+    bool owned = false;
+    if(!_sessions->contains(key))
+    {
+        const int row = _scanner.model()->rowOf(key);
+        if(row < 0)
+        {
+            sendError(client, NO_CHANNEL, "Device not found, scan for it first: " + key);
+            return;
+        }
+        if(_sessions->isFull())
+        {
+            sendError(client, NO_CHANNEL, QString::asprintf("Already connected to %d sensors", _sessions->maxConnections()));
+            return;
+        }
+        if(_sessions->open(_scanner.model()->device(row)).isEmpty())
+        {
+            sendError(client, NO_CHANNEL, "Failed to connect to " + key);
+            return;
+        }
+        owned = true;
+    }
+
+    Link& link = attach(key);
+    link.owned = link.owned || owned;
+    link.clients.push_back({ client, channel });
+    client->channels.insert(channel, key);
+    if(link.linger)
+        link.linger->stop();
+
+    if(link.ready)
+        send(client, FrameOpened, channelPayload(channel, key.toUtf8()));
+}
+
+void SensorDaemon::closeChannel(Client* client, uint8_t channel)
+{
+    const QString key = client->channels.take(channel);
+    if(key.isEmpty())
+        return;
+
+    detach(key, client);
+    send(client, FrameClosed, channelPayload(channel, QByteArray()));
+}
+
+void SensorDaemon::relay(Client* client, uint8_t channel, const QByteArray& packet)
+{
+    const QString key = client->channels.value(channel);
+    if(key.isEmpty() || !_links.contains(key))
+    {
+        sendError(client, channel, "No device open on this channel");
+        return;
+    }
+
+    Link& link = _links[key];
+    auto sensor = _sessions->sensor(key);
+    if(!link.ready || !sensor)
+    {
+        sendError(client, channel, "The device is not connected yet");
+        return;
+    }
+
+    const uint8_t clientRef = (uint8_t) packet[1];
+    const uint8_t ref = sensor->relayPacket(packet);
+    if(ref == Packet::INVALID_REF)
+    {
+        sendError(client, channel, "Failed to send the packet");
+        return;
+    }
+
+    // Stream commands keep their fixed reference and their responses go to everyone
+    if(clientRef != Sensor::DEBUG_LOG_STREAM_REF && clientRef != Sensor::LIVE_STREAM_REF)
+        link.requests.insert(ref, { client, clientRef });
+}
+
+void SensorDaemon::onScannerStateChanged(Scanner::State state)
+{
+    _scanning = state == Scanner::Scanning;
+    if(_scanning)
+        return;
+
+    _scanTimer.stop();
+    for(Client* client : _clients)
+    {
+        if(client->scanning)
+        {
+            client->scanning = false;
+            send(client, FrameScanDone);
+        }
+    }
+}
+
+void SensorDaemon::onDevicesChanged(int first, int last)
+{
+    DeviceListModel* model = _scanner.model();
+    for(int row = first; row <= last; row++)
+    {
+        const QBluetoothDeviceInfo info = model->device(row);
+        const QByteArray address = DeviceListModel::deviceKey(info).toUtf8();
+        const QByteArray name = info.name().toUtf8().left(0xFF);
+
+        QByteArray payload(2, 0);
+        qToLittleEndian<qint16>(info.rssi(), payload.data());
+        payload.append((char) address.size());
+        payload.append(address);
+        payload.append((char) name.size());
+        payload.append(name);
+        payload.append(info.manufacturerData(Advertisement::COMPANY_ID));
+
+        for(Client* client : _clients)
+        {
+            if(client->scanning)
+                send(client, FrameDevice, payload);
+        }
+    }
+}
+
+void SensorDaemon::onSessionReady(const QString& key)
+{
+    auto it = _links.find(key);
+    if(it == _links.end() || it->ready)
+        return;
+
+    it->ready = true;
+    for(const auto& [client, channel] : it->clients)
+        send(client, FrameOpened, channelPayload(channel, key.toUtf8()));
+}
+
+void SensorDaemon::onSessionClosed(const QString& key)
+{
+    auto it = _links.find(key);
+    if(it == _links.end())
+        return;
+
+    for(const auto& [client, channel] : it->clients)
+    {
+        client->channels.remove(channel);
+        send(client, FrameClosed, channelPayload(channel, QByteArray()));
+    }
+
+    disconnect(it->packets);
+    delete it->linger;
+    _links.erase(it);
+}
+
+void SensorDaemon::onSessionHeldChanged(const QString& key, bool held)
+{
+    if(!held)
+        linger(key);
+}
+
+void SensorDaemon::onSensorPacket(const QString& key, const QByteArray& packet, bool relayed)
+{
+    auto it = _links.find(key);
+    if(it == _links.end())
+        return;
+
+    const uint8_t ref = (uint8_t) packet[1];
+    if(relayed)
+    {
+        auto request = it->requests.find(ref);
+        if(request == it->requests.end())
+            return;
+
+        auto [client, clientRef] = *request;
+        for(const auto& [attached, channel] : it->clients)
+        {
+            if(attached != client)
+                continue;
+
+            QByteArray data = packet;
+            data[1] = (char) clientRef;
+            send(client, FrameReceived, channelPayload(channel, data));
+        }
+        return;
+    }
+
+    // Streams started by anyone are shared, responses to the host's own requests are not
+    if(ref == Sensor::DEBUG_LOG_STREAM_REF || ref == Sensor::LIVE_STREAM_REF)
+    {
+        for(const auto& [client, channel] : it->clients)
+            sendStream(client, channel, packet);
+    }
+}
+
+SensorDaemon::Link& SensorDaemon::attach(const QString& key)
+{
+    auto it = _links.find(key);
+    if(it != _links.end())
+        return *it;
+
+    Link& link = _links[key];
+    link.ready = _sessions->config(key).has_value();
+    link.packets = connect(_sessions->sensor(key).get(), &Sensor::onPacketReceived, this,
+        [this, key](const QByteArray& packet, bool relayed) { onSensorPacket(key, packet, relayed); });
+    return link;
+}
+
+void SensorDaemon::detach(const QString& key, Client* client)
+{
+    auto it = _links.find(key);
+    if(it == _links.end())
+        return;
+
+    it->clients.removeIf([client](const auto& attached) { return attached.first == client; });
+    it->requests.removeIf([client](const auto& request) { return request.value().first == client; });
+    if(!it->clients.isEmpty())
+        return;
+
+    if(!it->owned)
+    {
+        // The host application keeps its own sessions
+        disconnect(it->packets);
+        delete it->linger;
+        _links.erase(it);
+        return;
+    }
+
+    linger(key);
+}
+
+void SensorDaemon::linger(const QString& key)
+{
+    auto it = _links.find(key);
+    if(it == _links.end() || !it->owned || !it->clients.isEmpty())
+        return;
+
+    if(!it->linger)
+    {
+        it->linger = new QTimer(this);
+        it->linger->setSingleShot(true);
+        connect(it->linger, &QTimer::timeout, this, [this, key]() {
+            // Lingers again when the host lets go of it
+            if(_sessions->isHeld(key))
+                return;
+
+            qInfo("Closing idle daemon session %s", key.toStdString().c_str());
+            _sessions->close(key);
+        });
+    }
+    it->linger->start(LINGER_MS);
+}
+
+void SensorDaemon::send(Client* client, FrameType type, const QByteArray& payload)
+{
+    if(client->closing)
+        return;
+
+    // A client that stops reading would otherwise grow its write buffer without bound.
+    // Its link may be being iterated, so it is dropped once the current handler returns.
+    if(client->socket->bytesToWrite() >= MAX_PENDING_BYTES)
+    {
+        qInfo("Daemon client has %lld bytes unread, disconnecting it", client->socket->bytesToWrite());
+        client->closing = true;
+        QTimer::singleShot(0, client->socket, [socket = client->socket]() { socket->abort(); });
+        return;
+    }
+
+    client->socket->write(encode(type, payload));
+}
+
+void SensorDaemon::sendStream(Client* client, uint8_t channel, const QByteArray& packet)
+{
+    // Streams go first, so a slow client still gets the responses to its requests
+    if(client->socket->bytesToWrite() >= MAX_STREAM_PENDING_BYTES)
+    {
+        if(client->droppedStream++ == 0)
+            qInfo("Daemon client is falling behind, dropping stream packets");
+        return;
+    }
+
+    send(client, FrameReceived, channelPayload(channel, packet));
+}
+
+void SensorDaemon::sendError(Client* client, uint8_t channel, const QString& message)
+{
+    qInfo("Daemon client error: %s", message.toStdString().c_str());
+    send(client, FrameError, errorPayload(channel, message));
+}
@@ -0,0 +1,110 @@
+#ifndef SENSORDAEMON_H
+#define SENSORDAEMON_H
+
+#include <QObject>
+#include <QHash>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTimer>
+
+#include "daemonprotocol.h"
+#include "scanner.h"
+#include "sessionmanager.h"
+
+/*
+ * Serves the sensor sessions of this process to other local processes over a
+ * local socket (a Unix domain socket, or a named pipe on Windows). Any number
+ * of clients can open the same sensor and share its connection, whether the
+ * daemon or the host application connected it.
+ *
+ * Requests are relayed to the sensor under references of its connection and
+ * the responses are returned to the client that sent them with the client's
+ * own reference, so clients can't mix up each other's responses. Debug log
+ * and live data streams go to every client that has the sensor open. Stream
+ * packets are dropped for a client that lets MAX_STREAM_PENDING_BYTES pile up
+ * unread, and one that reaches MAX_PENDING_BYTES is disconnected.
+ *
+ * A sensor the daemon connected stays connected for LINGER_MS after its last
+ * client closes it, so tools run one after another don't reconnect each time.
+ * It is left connected while the host application holds the session.
+ *
+ * Clients scan with a scanner of the daemon's own, so they don't disturb the
+ * device list of the host application.
+ */
+class SensorDaemon : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int LINGER_MS = 30000;
+    static constexpr int MAX_SCAN_MS = 60000;
+    static constexpr int MAX_CHANNELS = 32;
+    static constexpr qint64 MAX_STREAM_PENDING_BYTES = 256 * 1024;
+    static constexpr qint64 MAX_PENDING_BYTES = 4 * 1024 * 1024;
+
+    explicit SensorDaemon(SessionManager* sessions, QObject* parent = nullptr);
+    ~SensorDaemon();
+
+    static QString defaultServerName();
+
+    bool listen(const QString& name = defaultServerName(), QString* error = nullptr);
+    void close();
+    bool isListening() const;
+    QString fullServerName() const;
+    int clientCount() const;
+
+private:
+    struct Client
+    {
+        QLocalSocket* socket = nullptr;
+        QByteArray buffer;
+        QHash<uint8_t, QString> channels; // Channel -> device
+        bool scanning = false;
+        bool closing = false; // Fell too far behind, disconnected once the current handler returns
+        quint64 droppedStream = 0;
+    };
+
+    struct Link
+    {
+        QList<QPair<Client*, uint8_t>> clients; // With their channels for this device
+        QHash<uint8_t, QPair<Client*, uint8_t>> requests; // Relayed reference -> client and its reference
+        QMetaObject::Connection packets;
+        QTimer* linger = nullptr;
+        bool owned = false; // Connected by the daemon, closed by it too
+        bool ready = false;
+    };
+
+    void onNewConnection();
+    void onClientData(Client* client);
+    void onClientDisconnected(Client* client);
+    void onFrame(Client* client, const DaemonProtocol::Frame& frame);
+
+    void scan(Client* client, int durationMs);
+    void open(Client* client, const QString& key);
+    void closeChannel(Client* client, uint8_t channel);
+    void relay(Client* client, uint8_t channel, const QByteArray& packet);
+
+    void onScannerStateChanged(Scanner::State state);
+    void onDevicesChanged(int first, int last);
+    void onSessionReady(const QString& key);
+    void onSessionClosed(const QString& key);
+    void onSessionHeldChanged(const QString& key, bool held);
+    void onSensorPacket(const QString& key, const QByteArray& packet, bool relayed);
+
+    Link& attach(const QString& key);
+    void detach(const QString& key, Client* client);
+    void linger(const QString& key);
+    void send(Client* client, DaemonProtocol::FrameType type, const QByteArray& payload = QByteArray());
+    void sendError(Client* client, uint8_t channel, const QString& message);
+    void sendStream(Client* client, uint8_t channel, const QByteArray& packet);
+
+    Scanner _scanner;
+    SessionManager* _sessions;
+    QLocalServer _server;
+    QTimer _scanTimer;
+    QList<Client*> _clients;
+    QHash<QString, Link> _links;
+    bool _scanning = false;
+};
+
+#endif // SENSORDAEMON_H
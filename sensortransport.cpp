@@ -0,0 +1,11 @@
+#include "sensortransport.h"
+
+SensorTransport::SensorTransport(QObject* parent)
+    : QObject(parent)
+{
+}
+
+QBluetoothAddress SensorTransport::localAdapter() const
+{
+    return QBluetoothAddress();
+}
@@ -0,0 +1,45 @@
+#ifndef SENSORTRANSPORT_H
+#define SENSORTRANSPORT_H
+
+#include <QObject>
+#include <QBluetoothAddress>
+#include <QByteArray>
+
+/*
+ * Link that carries encoded protocol packets between a Sensor and the device.
+ * Sensor owns the protocol, a transport only connects and moves whole packets.
+ * BleTransport talks to real sensors, other transports can stand in for them.
+ */
+class SensorTransport : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Error
+    {
+        UnsupportedDevice,
+        LinkError,
+    };
+
+    explicit SensorTransport(QObject* parent = nullptr);
+
+    virtual void connectToDevice() = 0;
+    virtual void disconnectFromDevice() = 0;
+    // False if the link can't take packets yet
+    virtual bool write(const QByteArray& packet) = 0;
+
+    // Null for the default adapter, or when the link isn't Bluetooth
+    virtual QBluetoothAddress localAdapter() const;
+
+signals:
+    // Connected to a device that provides the offline service
+    void connected();
+    void discovering();
+    // Packets can be exchanged from now on
+    void ready();
+    void disconnected();
+    void received(const QByteArray& packet);
+    void errorOccurred(SensorTransport::Error error);
+};
+
+#endif // SENSORTRANSPORT_H
@@ -1,9 +1,14 @@
 #include "sessionlogdialog.h"
 #include "ui_sessionlogdialog.h"
+#include "diskwriter.h"
+#include "logfilterdialog.h"
+#include "stallmonitor.h"
 
 #include <QFileDialog>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QSettings>
 #include <QStandardPaths>
-#include <fstream>
 
 SessionLogDialog::SessionLogDialog(QWidget *parent)
     : QDialog(parent)
@@ -15,9 +20,25 @@ SessionLogDialog::SessionLogDialog(QWidget *parent)
     connect(ui->eraseLogsButton, &QPushButton::clicked, this, &SessionLogDialog::onEraseLogs);
     connect(ui->refreshListButton, &QPushButton::clicked, this, &SessionLogDialog::onFetchSessions);
     connect(ui->downloadSelectedButton, &QPushButton::clicked, this, &SessionLogDialog::onDownloadSelected);
-    connect(ui->listWidget, &QListWidget::itemSelectionChanged, this, &SessionLogDialog::onLogSelected);
+    connect(ui->downloadFilteredButton, &QPushButton::clicked, this, &SessionLogDialog::onDownloadFiltered);
+
+    sortedLogList.setSourceModel(&logList);
+    sortedLogList.setSortRole(LogListModel::SortRole);
+    ui->logTable->setModel(&sortedLogList);
+    ui->logTable->sortByColumn(LogListModel::ColumnModified, Qt::DescendingOrder);
+    ui->logTable->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    connect(ui->logTable->selectionModel(), &QItemSelectionModel::selectionChanged, this, &SessionLogDialog::onLogSelected);
+
+    QSettings settings;
+    bool prefetch = settings.value("sessionLogs/prefetch", false).toBool();
+    prefetcher.setEnabled(prefetch);
+    ui->prefetchCheck->setChecked(prefetch);
+    connect(ui->prefetchCheck, &QCheckBox::toggled, this, &SessionLogDialog::onPrefetchToggled);
+    connect(&prefetcher, &LogPrefetcher::idle, this, &SessionLogDialog::onPrefetchIdle);
+    connect(&DiskWriter::instance(), &DiskWriter::finished, this, &SessionLogDialog::onLogSaved);
 
     ui->downloadSelectedButton->setEnabled(false);
+    ui->downloadFilteredButton->setEnabled(false);
     ui->refreshListButton->setEnabled(false);
     ui->eraseLogsButton->setEnabled(false);
 }
@@ -29,7 +50,6 @@ SessionLogDialog::~SessionLogDialog()
 
 void SessionLogDialog::setSensorDevice(QSharedPointer<Sensor> sensor)
 {
-    ui->listWidget->clear();
     ui->progressBar->setValue(0);
 
     if(this->sensor)
@@ -40,11 +60,17 @@ void SessionLogDialog::setSensorDevice(QSharedPointer<Sensor> sensor)
         disconnect(this->sensor.get(), &Sensor::onDataTransmissionProgressUpdate, this, &SessionLogDialog::onReceiveDataProgress);
 
         ui->downloadSelectedButton->setEnabled(false);
+        ui->downloadFilteredButton->setEnabled(false);
         ui->refreshListButton->setEnabled(false);
         ui->eraseLogsButton->setEnabled(false);
     }
 
     this->sensor = sensor;
+    prefetcher.setSensorDevice(sensor);
+    queuedRequest = nullptr;
+    pendingDownload.reset();
+    pendingRequestRef = Packet::INVALID_REF;
+    erasing = false;
 
     if(this->sensor)
     {
@@ -55,6 +81,15 @@ void SessionLogDialog::setSensorDevice(QSharedPointer<Sensor> sensor)
 
         ui->refreshListButton->setEnabled(true);
         ui->eraseLogsButton->setEnabled(true);
+
+        // Show the last known listing right away, the fresh one is reconciled into it
+        logList.setItems(LogListModel::loadCached(this->sensor->deviceId()));
+        ui->listStatus->setText(QString::asprintf("%lld logs (cached)", (long long) logList.rowCount()));
+    }
+    else
+    {
+        logList.clear();
+        ui->listStatus->clear();
     }
 
     onFetchSessions();
@@ -64,108 +99,202 @@ void SessionLogDialog::setSensorDevice(QSharedPointer<Sensor> sensor)
 void SessionLogDialog::onEraseLogs()
 {
     onClearList();
-    if(this->sensor)
-    {
-        uint8_t ref = this->sensor->sendCommand(CommandPacket::CmdClearLogs, {});
-        startRequest(ref);
-    }
+    runInteractive([this]() {
+        if(this->sensor)
+        {
+            uint8_t ref = this->sensor->sendCommand(CommandPacket::CmdClearLogs, {});
+            startRequest(ref);
+            erasing = true;
+        }
+    });
 }
 
 void SessionLogDialog::onFetchSessions()
 {
-    onClearList();
-    if(this->sensor)
-    {
-        uint8_t ref = this->sensor->sendCommand(CommandPacket::CmdListLogs, {});
-        startRequest(ref);
-    }
+    receivedItems.clear();
+    runInteractive([this]() {
+        if(this->sensor)
+        {
+            ui->listStatus->setText(QString::asprintf("%lld logs, refreshing...", (long long) logList.rowCount()));
+            uint8_t ref = this->sensor->sendCommand(CommandPacket::CmdListLogs, {});
+            startRequest(ref);
+        }
+    });
 }
 
 void SessionLogDialog::onDownloadSelected()
 {
-    auto item = ui->listWidget->currentItem();
-    if(this->sensor)
+    int row = selectedRow();
+    if(!this->sensor || row < 0)
+        return;
+
+    const LogListPacket::LogItem item = logList.item(row);
+    if(prefetcher.isCached(item))
     {
-        auto itemData = item->data(Qt::UserRole);
+        saveLog(prefetcher.readCached(item));
+        return;
+    }
 
+    // Continue a background download of the same log instead of starting over
+    if(prefetcher.isActive(item.id))
+    {
+        prefetcher.pause();
+        pendingDownload = item;
+        startRequest(prefetcher.takeActive());
+        return;
+    }
+
+    runInteractive([this, item]() {
         CommandPacket::Params params;
-        params.readLog.logIndex = (uint16_t) (itemData.toUInt());
+        params.readLog.logIndex = (uint16_t) item.id;
 
+        pendingDownload = item;
         uint8_t ref = this->sensor->sendCommand(CommandPacket::CmdReadLog, params);
         startRequest(ref);
+    });
+}
+
+void SessionLogDialog::onDownloadFiltered()
+{
+    int row = selectedRow();
+    if(this->sensor && row >= 0)
+    {
+        LogFilterDialog filterDialog(this);
+        if(filterDialog.exec() != QDialog::Accepted)
+            return;
+
+        CommandPacket::Params params;
+        params.readLogFiltered = filterDialog.params((uint16_t) logList.item(row).id);
+
+        runInteractive([this, params]() {
+            uint8_t ref = this->sensor->sendCommand(CommandPacket::CmdReadLogFiltered, params);
+            startRequest(ref);
+        });
     }
 }
 
 void SessionLogDialog::onLogSelected()
 {
-    auto index = ui->listWidget->currentIndex();
-    ui->downloadSelectedButton->setEnabled(index.isValid());
+    bool selected = selectedRow() >= 0;
+    ui->downloadSelectedButton->setEnabled(selected);
+    ui->downloadFilteredButton->setEnabled(selected && sensor && sensor->isProtocolVersionAtLeast(1, 3));
 }
 
 void SessionLogDialog::onClearList()
 {
     ui->downloadSelectedButton->setEnabled(false);
-    ui->listWidget->clear();
+    ui->downloadFilteredButton->setEnabled(false);
+    logList.clear();
+    ui->listStatus->clear();
 }
 
 void SessionLogDialog::onReceiveLogList(uint8_t ref, const QList<LogListPacket::LogItem>& items, bool complete)
 {
-    for(const auto& item : items)
-    {
-        qInfo("REF %u - Item: %u Size: %u Modified: %llu", ref, item.id, item.size, item.modified);
+    StallMonitor::Scope scope("SessionLogDialog::onReceiveLogList");
 
-        QString label = QString::asprintf("LOG# %u - Modified: %llu - Size: %u", item.id, item.modified, item.size);
+    if(pendingRequestRef != ref)
+        return;
 
-        QListWidgetItem* listItem = new QListWidgetItem(label);
-        listItem->setData(Qt::UserRole, item.id);
-        ui->listWidget->addItem(listItem);
-    }
+    receivedItems.append(items);
+    if(!complete)
+        return;
+
+    qInfo("REF %u - Received a listing of %lld logs", ref, (long long) receivedItems.size());
+    logList.reconcile(receivedItems);
+    if(sensor)
+        LogListModel::saveCached(sensor->deviceId(), logList.items());
 
-    if(complete)
-        completeRequest(ref);
+    ui->listStatus->setText(QString::asprintf("%lld logs", (long long) logList.rowCount()));
+    receivedItems.clear();
+    completeRequest(ref);
+
+    prefetcher.prune(logList.items());
+    prefetcher.prefetch(logList.items());
 }
 
 void SessionLogDialog::onReceiveData(uint8_t ref, const QByteArray& data)
 {
+    if(pendingRequestRef != ref)
+        return;
+
     qInfo("Receiving data (ref: %u)", ref);
     ui->progressBar->setValue(100);
 
-    auto path = QStandardPaths::writableLocation(QStandardPaths::DownloadLocation);
-    QString filename = QFileDialog::getSaveFileName(this, "Save log", path, "SBEM File (*.sbem)");
-    if(!filename.isEmpty())
+    if(pendingDownload)
     {
-        std::fstream file(filename.toStdString(), std::ios::trunc | std::ios::binary | std::ios::out);
-        if(file.is_open())
-        {
-            file.write(data.data(), data.size());
-            file.close();
-        }
+        prefetcher.store(*pendingDownload, data);
+        pendingDownload.reset();
     }
 
+    saveLog(data);
     completeRequest(ref);
 }
 
-void SessionLogDialog::onReceiveDataProgress(uint8_t ref, uint32_t recvBytes, uint32_t totalBytes)
+void SessionLogDialog::saveLog(const QByteArray& data)
+{
+    auto path = QStandardPaths::writableLocation(QStandardPaths::DownloadLocation);
+    QString filename = QFileDialog::getSaveFileName(this, "Save log", path, "SBEM File (*.sbem)");
+
+    // Not around the dialog, its nested event loop runs handlers of their own
+    StallMonitor::Scope scope("SessionLogDialog::saveLog");
+    if(!filename.isEmpty())
+        savingFiles.insert(DiskWriter::instance().save(filename, data));
+}
+
+void SessionLogDialog::onLogSaved(quint64 file, const QString& path, bool success, const QString& error)
+{
+    if(!savingFiles.remove(file) || success)
+        return;
+
+    QMessageBox::warning(this, "Save failed", QString::asprintf("Failed to save %s: %s",
+        path.toStdString().c_str(), error.toStdString().c_str()));
+}
+
+void SessionLogDialog::onReceiveDataProgress(uint8_t ref, const TransferProgress& progress)
 {
     if(pendingRequestRef == ref)
     {
-        int progress = (int)(100.0 * ((float) recvBytes / totalBytes));
-        ui->progressBar->setValue(progress);
-        qInfo("Data download progress: %d%%", progress);
+        ui->progressBar->setValue(progress.percent());
+        ui->progressBar->setFormat(progress.toString());
     }
 }
 
 void SessionLogDialog::onReceiveStatusResponse(uint8_t ref, uint16_t status)
 {
     qInfo("Status response (ref %u): %u", ref, status);
+
+    // The cached listing stays valid until the sensor confirms the erase
+    if(erasing && pendingRequestRef == ref && sensor)
+    {
+        if(status == 200)
+        {
+            LogListModel::saveCached(sensor->deviceId(), {});
+            prefetcher.prune({});
+        }
+        else
+        {
+            logList.setItems(LogListModel::loadCached(sensor->deviceId()));
+            ui->listStatus->setText(QString::asprintf("%lld logs (cached), erase failed", (long long) logList.rowCount()));
+        }
+    }
     completeRequest(ref);
 }
 
+int SessionLogDialog::selectedRow() const
+{
+    const auto rows = ui->logTable->selectionModel()->selectedRows();
+    if(rows.isEmpty())
+        return -1;
+    return sortedLogList.mapToSource(rows.front()).row();
+}
+
 void SessionLogDialog::startRequest(uint8_t ref)
 {
     pendingRequestRef = ref;
     ui->progressBar->setValue(0);
+    ui->progressBar->setFormat("%p%");
     ui->downloadSelectedButton->setEnabled(false);
+    ui->downloadFilteredButton->setEnabled(false);
     ui->refreshListButton->setEnabled(false);
     ui->eraseLogsButton->setEnabled(false);
 }
@@ -176,8 +305,48 @@ void SessionLogDialog::completeRequest(uint8_t ref)
         return;
 
     pendingRequestRef = Packet::INVALID_REF;
+    pendingDownload.reset();
+    erasing = false;
 
     onLogSelected();
     ui->refreshListButton->setEnabled(true);
     ui->eraseLogsButton->setEnabled(true);
+
+    prefetcher.resume();
+}
+
+void SessionLogDialog::onPrefetchToggled(bool enabled)
+{
+    QSettings settings;
+    settings.setValue("sessionLogs/prefetch", enabled);
+
+    prefetcher.setEnabled(enabled);
+    if(enabled && pendingRequestRef == Packet::INVALID_REF && !queuedRequest)
+        prefetcher.prefetch(logList.items());
+}
+
+void SessionLogDialog::onPrefetchIdle()
+{
+    if(!queuedRequest)
+        return;
+
+    auto request = std::move(queuedRequest);
+    queuedRequest = nullptr;
+    request();
+}
+
+void SessionLogDialog::runInteractive(std::function<void()> request)
+{
+    prefetcher.pause();
+
+    // Transfers can't be cancelled, wait for the background download to finish
+    if(prefetcher.isActive())
+    {
+        queuedRequest = std::move(request);
+        startRequest(Packet::INVALID_REF);
+        ui->listStatus->setText("Waiting for the background download to finish...");
+        return;
+    }
+
+    request();
 }
@@ -2,7 +2,14 @@
 #define SESSIONLOGDIALOG_H
 
 #include <QDialog>
+#include <QSet>
+#include <QSortFilterProxyModel>
 #include "sensor.h"
+#include "loglistmodel.h"
+#include "logprefetcher.h"
+
+#include <functional>
+#include <optional>
 
 namespace Ui {
 class SessionLogDialog;
@@ -23,21 +30,39 @@ private:
     void onFetchSessions();
     void onDownloadAll();
     void onDownloadSelected();
+    void onDownloadFiltered();
 
     void onLogSelected();
     void onClearList();
 
     void onReceiveLogList(uint8_t ref, const QList<LogListPacket::LogItem>& items, bool complete);
     void onReceiveData(uint8_t ref, const QByteArray& data);
-    void onReceiveDataProgress(uint8_t ref, uint32_t recvBytes, uint32_t totalBytes);
+    void onReceiveDataProgress(uint8_t ref, const TransferProgress& progress);
     void onReceiveStatusResponse(uint8_t ref, uint16_t status);
 
+    void onPrefetchToggled(bool enabled);
+    void onPrefetchIdle();
+
+    void runInteractive(std::function<void()> request);
+    void saveLog(const QByteArray& data);
+    void onLogSaved(quint64 file, const QString& path, bool success, const QString& error);
+    int selectedRow() const;
     void startRequest(uint8_t ref);
     void completeRequest(uint8_t ref);
 
     Ui::SessionLogDialog *ui;
     QSharedPointer<Sensor> sensor;
     uint8_t pendingRequestRef = Packet::INVALID_REF;
+    bool erasing = false; // The pending request is CmdClearLogs
+
+    LogListModel logList;
+    QSortFilterProxyModel sortedLogList;
+    QList<LogListPacket::LogItem> receivedItems;
+
+    LogPrefetcher prefetcher;
+    std::function<void()> queuedRequest;
+    std::optional<LogListPacket::LogItem> pendingDownload;
+    QSet<quint64> savingFiles;
 };
 
 #endif // SESSIONLOGDIALOG_H
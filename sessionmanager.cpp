@@ -0,0 +1,282 @@
+#include "sessionmanager.h"
+
+#include <QSettings>
+
+SessionManager::SessionManager(QObject* parent)
+    : QAbstractListModel(parent)
+{
+    // The limit depends on the adapter and its driver, so it can be tuned per machine
+    QSettings settings;
+    _maxConnections = qMax(1, settings.value("sessions/maxConnections", DEFAULT_MAX_CONNECTIONS).toInt());
+}
+
+SessionManager::~SessionManager()
+{
+    for(auto& session : _sessions)
+        disconnect(session.sensor.get(), nullptr, this, nullptr);
+}
+
+int SessionManager::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : _sessions.size();
+}
+
+QVariant SessionManager::data(const QModelIndex& index, int role) const
+{
+    if(!index.isValid() || index.row() >= _sessions.size())
+        return QVariant();
+
+    const Session& session = _sessions.at(index.row());
+    switch(role)
+    {
+    case Qt::DisplayRole:
+    {
+        QString text = session.sensor->name();
+        switch(session.state)
+        {
+        case Sensor::Disconnected:
+            text += "\nDisconnected";
+            break;
+        case Sensor::Connecting:
+            text += "\nConnecting...";
+            break;
+        case Sensor::DiscoveringServices:
+            text += "\nDiscovering services...";
+            break;
+        case Sensor::Connected:
+            text += session.config ? "\nConnected" : "\nReading configuration...";
+            break;
+        }
+
+        if(session.transfer)
+            text += ", downloading " + session.transfer->toString();
+        return text;
+    }
+    case Qt::ToolTipRole:
+    case DeviceKeyRole:
+        return session.key;
+    case StateRole:
+        return session.state;
+    case ProgressRole:
+        return session.transfer ? QVariant(session.transfer->percent()) : QVariant();
+    default:
+        return QVariant();
+    }
+}
+
+QString SessionManager::open(const QBluetoothDeviceInfo& info)
+{
+    if(isFull())
+        return QString();
+
+    // Deleted later so a sensor can't be destroyed while it is emitting a signal
+    QSharedPointer<Sensor> sensor(new Sensor(nullptr, info), &QObject::deleteLater);
+    const QString key = sensor->deviceId();
+    if(contains(key))
+        return QString();
+
+    connect(sensor.get(), &Sensor::onStateChanged, this, [this, key](Sensor::State state) {
+        onSensorStateChanged(key, state);
+    });
+    connect(sensor.get(), &Sensor::onConfigUpdated, this, [this, key](const OfflineConfig& config) {
+        if(Session* session = find(key))
+        {
+            session->config = config;
+            updateRow(key);
+        }
+        emit configChanged(key, config);
+    });
+    connect(sensor.get(), &Sensor::onStatusResponse, this, [this, key](uint8_t ref, uint16_t status) {
+        emit statusReceived(key, ref, status);
+    });
+    connect(sensor.get(), &Sensor::onLastFaultReceived, this, [this, key](const Sensor::LastFault& fault, bool isNew) {
+        emit lastFaultReceived(key, fault, isNew);
+    });
+    connect(sensor.get(), &Sensor::onError, this, [this, key](Sensor::Error error, QString msg) {
+        emit errorOccurred(key, error, msg);
+    });
+    connect(sensor.get(), &Sensor::onDataTransmissionProgressUpdate, this, [this, key](uint8_t, const TransferProgress& progress) {
+        onSensorProgress(key, progress);
+    });
+    connect(sensor.get(), &Sensor::onDataTransmissionCompleted, this, [this, key]() {
+        onSensorTransferDone(key);
+    });
+
+    beginInsertRows(QModelIndex(), _sessions.size(), _sessions.size());
+    _sessions.push_back({ key, sensor });
+    endInsertRows();
+
+    sensor->connectDevice();
+    return key;
+}
+
+void SessionManager::close(const QString& key)
+{
+    Session* session = find(key);
+    if(!session)
+        return;
+
+    if(session->state == Sensor::Connected)
+    {
+        session->sensor->disconnectDevice();
+        return;
+    }
+
+    // An attempt that is still connecting may never report a disconnect
+    QSharedPointer<Sensor> sensor = session->sensor;
+    remove(key);
+    sensor->disconnectDevice();
+}
+
+void SessionManager::closeAll()
+{
+    for(const auto& key : keys())
+        close(key);
+}
+
+bool SessionManager::contains(const QString& key) const
+{
+    return rowOf(key) >= 0;
+}
+
+bool SessionManager::isFull() const
+{
+    return _sessions.size() >= _maxConnections;
+}
+
+int SessionManager::maxConnections() const
+{
+    return _maxConnections;
+}
+
+void SessionManager::setMaxConnections(int count)
+{
+    _maxConnections = qMax(1, count);
+
+    QSettings settings;
+    settings.setValue("sessions/maxConnections", _maxConnections);
+}
+
+QString SessionManager::key(int row) const
+{
+    if(row < 0 || row >= _sessions.size())
+        return QString();
+    return _sessions.at(row).key;
+}
+
+int SessionManager::rowOf(const QString& key) const
+{
+    for(int row = 0; row < _sessions.size(); row++)
+    {
+        if(_sessions.at(row).key == key)
+            return row;
+    }
+    return -1;
+}
+
+QStringList SessionManager::keys() const
+{
+    QStringList result;
+    for(const auto& session : _sessions)
+        result.push_back(session.key);
+    return result;
+}
+
+QSharedPointer<Sensor> SessionManager::sensor(const QString& key) const
+{
+    int row = rowOf(key);
+    return row >= 0 ? _sessions.at(row).sensor : nullptr;
+}
+
+Sensor::State SessionManager::state(const QString& key) const
+{
+    int row = rowOf(key);
+    return row >= 0 ? _sessions.at(row).state : Sensor::Disconnected;
+}
+
+std::optional<OfflineConfig> SessionManager::config(const QString& key) const
+{
+    int row = rowOf(key);
+    return row >= 0 ? _sessions.at(row).config : std::nullopt;
+}
+
+void SessionManager::setHeld(const QString& key, bool held)
+{
+    Session* session = find(key);
+    if(!session || session->held == held)
+        return;
+
+    session->held = held;
+    emit heldChanged(key, held);
+}
+
+bool SessionManager::isHeld(const QString& key) const
+{
+    int row = rowOf(key);
+    return row >= 0 && _sessions.at(row).held;
+}
+
+void SessionManager::onSensorStateChanged(const QString& key, Sensor::State state)
+{
+    Session* session = find(key);
+    if(!session)
+        return;
+
+    session->state = state;
+    if(state != Sensor::Connected)
+        session->transfer.reset();
+    updateRow(key);
+
+    emit stateChanged(key, state);
+
+    if(state == Sensor::Disconnected)
+        remove(key);
+}
+
+void SessionManager::onSensorProgress(const QString& key, const TransferProgress& progress)
+{
+    Session* session = find(key);
+    if(!session)
+        return;
+
+    session->transfer = progress;
+    updateRow(key);
+}
+
+void SessionManager::onSensorTransferDone(const QString& key)
+{
+    Session* session = find(key);
+    if(!session || !session->transfer)
+        return;
+
+    session->transfer.reset();
+    updateRow(key);
+}
+
+void SessionManager::remove(const QString& key)
+{
+    int row = rowOf(key);
+    if(row < 0)
+        return;
+
+    disconnect(_sessions.at(row).sensor.get(), nullptr, this, nullptr);
+
+    beginRemoveRows(QModelIndex(), row, row);
+    _sessions.removeAt(row);
+    endRemoveRows();
+
+    emit closed(key);
+}
+
+void SessionManager::updateRow(const QString& key)
+{
+    int row = rowOf(key);
+    if(row >= 0)
+        emit dataChanged(index(row), index(row));
+}
+
+SessionManager::Session* SessionManager::find(const QString& key)
+{
+    int row = rowOf(key);
+    return row >= 0 ? &_sessions[row] : nullptr;
+}
@@ -0,0 +1,90 @@
+#ifndef SESSIONMANAGER_H
+#define SESSIONMANAGER_H
+
+#include <QAbstractListModel>
+#include <QSharedPointer>
+#include <optional>
+
+#include "sensor.h"
+
+/*
+ * Connections to any number of sensors, up to the adapter's connection limit.
+ * Each session owns its Sensor, so request references, reassembly buffers and
+ * transfers are tracked per device. The model lists the sessions in the order
+ * they were opened together with their connection and transfer status.
+ */
+class SessionManager : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    // Most adapters handle at least this many simultaneous LE connections
+    static constexpr int DEFAULT_MAX_CONNECTIONS = 5;
+
+    enum Roles
+    {
+        DeviceKeyRole = Qt::UserRole,
+        StateRole,
+        ProgressRole,
+    };
+
+    explicit SessionManager(QObject* parent = nullptr);
+    ~SessionManager();
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    // Returns the new session's key, or an empty string if it can't be opened
+    QString open(const QBluetoothDeviceInfo& info);
+    void close(const QString& key);
+    void closeAll();
+
+    bool contains(const QString& key) const;
+    bool isFull() const;
+    int maxConnections() const;
+    void setMaxConnections(int count);
+
+    QString key(int row) const;
+    int rowOf(const QString& key) const;
+    QStringList keys() const;
+    QSharedPointer<Sensor> sensor(const QString& key) const;
+    Sensor::State state(const QString& key) const;
+    std::optional<OfflineConfig> config(const QString& key) const;
+
+    // Sessions the host application is using, e.g. with views open on them.
+    // The daemon doesn't close idle sessions of its own while they are held.
+    void setHeld(const QString& key, bool held);
+    bool isHeld(const QString& key) const;
+
+signals:
+    void stateChanged(const QString& key, Sensor::State state);
+    void configChanged(const QString& key, const OfflineConfig& config);
+    void statusReceived(const QString& key, uint8_t ref, uint16_t status);
+    void lastFaultReceived(const QString& key, const Sensor::LastFault& fault, bool isNew);
+    void errorOccurred(const QString& key, Sensor::Error error, QString msg);
+    void closed(const QString& key);
+    void heldChanged(const QString& key, bool held);
+
+private:
+    struct Session
+    {
+        QString key;
+        QSharedPointer<Sensor> sensor;
+        Sensor::State state = Sensor::Disconnected;
+        std::optional<OfflineConfig> config;
+        std::optional<TransferProgress> transfer;
+        bool held = false;
+    };
+
+    void onSensorStateChanged(const QString& key, Sensor::State state);
+    void onSensorProgress(const QString& key, const TransferProgress& progress);
+    void onSensorTransferDone(const QString& key);
+    void remove(const QString& key);
+    void updateRow(const QString& key);
+    Session* find(const QString& key);
+
+    QList<Session> _sessions;
+    int _maxConnections;
+};
+
+#endif // SESSIONMANAGER_H
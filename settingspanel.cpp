@@ -0,0 +1,206 @@
+#include "settingspanel.h"
+#include "protocol/ProtocolConstants.hpp"
+
+#include <QGridLayout>
+#include <QLabel>
+#include <QSignalBlocker>
+#include <QVBoxLayout>
+
+typedef QString (*LabelFormatter)(uint16_t value);
+
+static QString labelFormatOnOff(uint16_t value)
+{
+    return value > 0 ? QString("On") : QString("Off");
+}
+
+static QString labelFormatSampleRate(uint16_t value)
+{
+    if(value == 0)
+        return QString("Off");
+    return QString::asprintf("%d Hz", value);
+}
+
+static QString labelFormatInterval(uint16_t value)
+{
+    if(value == 0)
+        return QString("Off");
+
+    int h = value / (60 * 60);
+    int m = (value - h * 3600) / 60;
+    int s = value % 60;
+    QString label = "";
+    if(h > 0) label += QString::asprintf("%d h ", h);
+    if(m > 0) label += QString::asprintf("%d min ", m);
+    if(s > 0) label += QString::asprintf("%d s ", s);
+    return label;
+}
+
+struct ValueList
+{
+    template<size_t N>
+    constexpr ValueList(const uint16_t (&values)[N]) : values(values), count(N) {}
+
+    const uint16_t* values;
+    size_t count;
+};
+
+// One row of the panel: a measurement selector, or an option toggle when label is set
+struct SettingDescriptor
+{
+    enum Kind
+    {
+        Measurement,
+        Option,
+    } kind;
+
+    int id; // OfflineConfig::Measurement or OfflineConfig::OptionsFlags
+    const char* label;
+    ValueList values;
+    LabelFormatter formatter;
+};
+
+static const SettingDescriptor SETTINGS[] = {
+    { SettingDescriptor::Measurement, OfflineConfig::MeasECG, "Single-lead ECG", SENSOR_MEAS_SAMPLERATES_ECG, labelFormatSampleRate },
+    { SettingDescriptor::Option, OfflineConfig::OptionsCompressECG, "Use experimental ECG compression", SENSOR_MEAS_TOGGLE, nullptr },
+    { SettingDescriptor::Measurement, OfflineConfig::MeasHR, "Heart rate (average bpm)", SENSOR_MEAS_TOGGLE, labelFormatOnOff },
+    { SettingDescriptor::Measurement, OfflineConfig::MeasRR, "R-to-R intervals (ms)", SENSOR_MEAS_TOGGLE, labelFormatOnOff },
+    { SettingDescriptor::Measurement, OfflineConfig::MeasAcc, "Linear acceleration (m/s^2)", SENSOR_MEAS_SAMPLERATES_IMU, labelFormatSampleRate },
+    { SettingDescriptor::Measurement, OfflineConfig::MeasGyro, "Gyroscope (dps)", SENSOR_MEAS_SAMPLERATES_IMU, labelFormatSampleRate },
+    { SettingDescriptor::Measurement, OfflineConfig::MeasMagn, "Magnetometer (μT)", SENSOR_MEAS_SAMPLERATES_IMU, labelFormatSampleRate },
+    { SettingDescriptor::Measurement, OfflineConfig::MeasTemp, "Temperature (°C)", SENSOR_MEAS_TOGGLE, labelFormatOnOff },
+    { SettingDescriptor::Measurement, OfflineConfig::MeasActivity, "Activity", SENSOR_MEAS_PRESETS_ACTIVITY_INTERVALS, labelFormatInterval },
+    { SettingDescriptor::Option, OfflineConfig::OptionsLogTapGestures, "Record tap detection events", SENSOR_MEAS_TOGGLE, nullptr },
+    { SettingDescriptor::Option, OfflineConfig::OptionsLogShakeGestures, "Record shake detection events", SENSOR_MEAS_TOGGLE, nullptr },
+    { SettingDescriptor::Option, OfflineConfig::OptionsShakeToConnect, "Shake to turn on BLE (turn off after 30 seconds)", SENSOR_MEAS_TOGGLE, nullptr },
+};
+
+static const QPair<const char*, OfflineConfig::WakeUpBehavior> WAKE_UP_OPTIONS[] = {
+    { "Always on", OfflineConfig::WakeUpAlwaysOn },
+    { "Connectors", OfflineConfig::WakeUpConnector },
+    { "Movement", OfflineConfig::WakeUpMovement },
+    { "Double tap", OfflineConfig::WakeUpDoubleTap },
+};
+
+static const QPair<const char*, uint16_t> SLEEP_DELAY_OPTIONS[] = {
+    { "Never (double tap to sleep)", 0 },
+    { "30 seconds", 30 },
+    { "1 minute", 60 },
+    { "5 minutes", 5 * 60 },
+    { "15 minutes", 15 * 60 },
+    { "30 minutes", 30 * 60 },
+    { "1 hour", 60 * 60 },
+    { "2 hours", 2 * 60 * 60 },
+    { "3 hours", 3 * 60 * 60 },
+    { "6 hours", 6 * 60 * 60 },
+    { "12 hours", 12 * 60 * 60 }, // Still fits unsigned 16-bit int
+};
+
+SettingsPanel::SettingsPanel(QWidget *parent)
+    : QWidget(parent)
+{
+    QVBoxLayout* layout = new QVBoxLayout(this);
+
+    for(const auto& setting : SETTINGS)
+    {
+        QWidget* item = new QWidget();
+        QGridLayout* itemLayout = new QGridLayout(item);
+
+        if(setting.kind == SettingDescriptor::Measurement)
+        {
+            itemLayout->addWidget(new QLabel(setting.label), 0, 0);
+
+            QComboBox* dropdown = new QComboBox();
+            for(size_t i = 0; i < setting.values.count; i++)
+                dropdown->addItem(setting.formatter(setting.values.values[i]), (uint) setting.values.values[i]);
+            itemLayout->addWidget(dropdown, 0, 1);
+
+            const int meas = setting.id;
+            _measurements[meas] = dropdown;
+            connect(dropdown, &QComboBox::currentIndexChanged, this, [this, meas, dropdown](int index) {
+                _config.measurementParams.array[meas] = (uint16_t) dropdown->itemData(index).toUInt();
+                emit edited();
+            });
+        }
+        else
+        {
+            QCheckBox* checkbox = new QCheckBox(setting.label);
+            itemLayout->addWidget(checkbox, 0, 0);
+
+            const auto flag = (OfflineConfig::OptionsFlags) setting.id;
+            _options.push_back({ flag, checkbox });
+            connect(checkbox, &QCheckBox::toggled, this, [this, flag](bool enable) {
+                if(enable)
+                    _config.optionsFlags |= flag;
+                else
+                    _config.optionsFlags &= ~flag;
+                emit edited();
+            });
+        }
+
+        layout->addWidget(item);
+    }
+
+    QWidget* device = new QWidget();
+    QGridLayout* deviceLayout = new QGridLayout(device);
+    {
+        deviceLayout->addWidget(new QLabel("Wake up device when"), 0, 0);
+
+        _wakeUp = new QComboBox();
+        for(const auto& option : WAKE_UP_OPTIONS)
+            _wakeUp->addItem(option.first, (uint) option.second);
+        deviceLayout->addWidget(_wakeUp, 0, 1);
+
+        deviceLayout->addWidget(new QLabel("Automatic sleep after"), 1, 0);
+
+        _sleepDelay = new QComboBox();
+        for(const auto& option : SLEEP_DELAY_OPTIONS)
+            _sleepDelay->addItem(option.first, (uint) option.second);
+        deviceLayout->addWidget(_sleepDelay, 1, 1);
+
+        connect(_wakeUp, &QComboBox::currentIndexChanged, this, [this](int index) {
+            _config.wakeUpBehavior = (OfflineConfig::WakeUpBehavior) _wakeUp->itemData(index).toUInt();
+            emit edited();
+        });
+
+        connect(_sleepDelay, &QComboBox::currentIndexChanged, this, [this](int index) {
+            _config.sleepDelay = (uint16_t) _sleepDelay->itemData(index).toUInt();
+            emit edited();
+        });
+    }
+    layout->addWidget(device);
+
+    setConfig(_config);
+}
+
+void SettingsPanel::setConfig(const OfflineConfig& config)
+{
+    _config = config;
+
+    // Programmatic changes are not user edits
+    for(int i = 0; i < OfflineConfig::MeasCount; i++)
+    {
+        if(_measurements[i])
+            select(_measurements[i], config.measurementParams.array[i]);
+    }
+
+    for(const auto& option : _options)
+    {
+        QSignalBlocker blocker(option.second);
+        option.second->setChecked(!!(config.optionsFlags & option.first));
+    }
+
+    select(_wakeUp, config.wakeUpBehavior);
+    select(_sleepDelay, config.sleepDelay);
+}
+
+const OfflineConfig& SettingsPanel::config() const
+{
+    return _config;
+}
+
+void SettingsPanel::select(QComboBox* comboBox, uint16_t value)
+{
+    QSignalBlocker blocker(comboBox);
+    int index = comboBox->findData((uint) value);
+    comboBox->setCurrentIndex(index >= 0 ? index : 0);
+}
@@ -0,0 +1,39 @@
+#ifndef SETTINGSPANEL_H
+#define SETTINGSPANEL_H
+
+#include <QWidget>
+#include <QCheckBox>
+#include <QComboBox>
+
+#include "protocol/Protocol.hpp"
+
+/*
+ * Editor for OfflineConfig. The widgets are created once from the descriptor
+ * tables in settingspanel.cpp; setConfig() only changes their selections, so
+ * reading the configuration again doesn't rebuild anything.
+ */
+class SettingsPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit SettingsPanel(QWidget *parent = nullptr);
+
+    void setConfig(const OfflineConfig& config);
+    const OfflineConfig& config() const;
+
+signals:
+    void edited();
+
+private:
+    static void select(QComboBox* comboBox, uint16_t value);
+
+    OfflineConfig _config;
+
+    QComboBox* _measurements[OfflineConfig::MeasCount] = {};
+    QList<QPair<OfflineConfig::OptionsFlags, QCheckBox*>> _options;
+    QComboBox* _wakeUp;
+    QComboBox* _sleepDelay;
+};
+
+#endif // SETTINGSPANEL_H
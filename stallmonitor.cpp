@@ -0,0 +1,193 @@
+#include "stallmonitor.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+
+std::atomic<const char*> StallMonitor::_currentScope = nullptr;
+
+StallMonitor::Scope::Scope(const char* name)
+    : _previous(_currentScope.exchange(name, std::memory_order_relaxed))
+{
+}
+
+StallMonitor::Scope::~Scope()
+{
+    _currentScope.store(_previous, std::memory_order_relaxed);
+}
+
+StallMonitor& StallMonitor::instance()
+{
+    static StallMonitor monitor;
+    return monitor;
+}
+
+StallMonitor::StallMonitor(QObject* parent)
+    : QObject(parent)
+{
+    _heartbeat.setInterval(HEARTBEAT_MS);
+    _heartbeat.setTimerType(Qt::PreciseTimer);
+    connect(&_heartbeat, &QTimer::timeout, this, &StallMonitor::onHeartbeat);
+}
+
+StallMonitor::~StallMonitor()
+{
+    stop();
+}
+
+void StallMonitor::start()
+{
+    if(_running)
+        return;
+
+    _clock.start();
+    _lastBeatMs = -1;
+    _beatMs = 0;
+    _running = true;
+    _watchdog = std::thread(&StallMonitor::watchdog, this);
+    _heartbeat.start();
+}
+
+void StallMonitor::stop()
+{
+    if(!_running)
+        return;
+
+    _heartbeat.stop();
+    _running = false;
+    if(_watchdog.joinable())
+        _watchdog.join();
+}
+
+void StallMonitor::reset()
+{
+    std::lock_guard lck(_mtx);
+    std::fill(std::begin(_latency), std::end(_latency), 0);
+    std::fill(std::begin(_stalls), std::end(_stalls), 0);
+    _beats = 0;
+    _worstMs = 0;
+    _scopes.clear();
+}
+
+void StallMonitor::onHeartbeat()
+{
+    const qint64 now = _clock.elapsed();
+    _beatMs.store(now, std::memory_order_relaxed);
+
+    if(_lastBeatMs < 0)
+    {
+        _lastBeatMs = now;
+        return;
+    }
+
+    const qint64 latency = qMax<qint64>(0, now - _lastBeatMs - HEARTBEAT_MS);
+    _lastBeatMs = now;
+
+    const char* scope = _stallScope.exchange(nullptr, std::memory_order_relaxed);
+
+    std::lock_guard lck(_mtx);
+    _beats++;
+    _latency[bucketOf(latency)]++;
+
+    if(latency < STALL_THRESHOLD_MS)
+        return;
+
+    _stalls[bucketOf(latency)]++;
+    _worstMs = qMax(_worstMs, latency);
+
+    auto& stats = _scopes[scope ? QString::fromUtf8(scope) : QString("(unmarked)")];
+    stats.count++;
+    stats.totalMs += latency;
+    stats.maxMs = qMax(stats.maxMs, latency);
+}
+
+void StallMonitor::watchdog()
+{
+    while(_running)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(WATCHDOG_INTERVAL_MS));
+
+        // Sample what is running while the loop is blocked, the first sample wins
+        const qint64 overdue = _clock.elapsed() - _beatMs.load(std::memory_order_relaxed) - HEARTBEAT_MS;
+        if(overdue < STALL_THRESHOLD_MS / 2)
+            continue;
+
+        const char* scope = _currentScope.load(std::memory_order_relaxed);
+        const char* expected = nullptr;
+        if(scope)
+            _stallScope.compare_exchange_strong(expected, scope, std::memory_order_relaxed);
+    }
+}
+
+int StallMonitor::bucketOf(qint64 ms)
+{
+    int bucket = 0;
+    while(ms >= 1 && bucket < BUCKET_COUNT - 1)
+    {
+        ms >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+QString StallMonitor::bucketLabel(int bucket)
+{
+    if(bucket == 0)
+        return "< 1 ms";
+    if(bucket == BUCKET_COUNT - 1)
+        return QString::asprintf(">= %d ms", 1 << (bucket - 1));
+    return QString::asprintf("%d - %d ms", 1 << (bucket - 1), (1 << bucket) - 1);
+}
+
+QString StallMonitor::report() const
+{
+    std::lock_guard lck(_mtx);
+
+    QString text;
+    QTextStream out(&text);
+    out << "Event loop responsiveness, " << QDateTime::currentDateTime().toString(Qt::ISODate) << "\n";
+    out << "Heartbeat " << HEARTBEAT_MS << " ms, stall threshold " << STALL_THRESHOLD_MS << " ms\n";
+    out << "Beats: " << _beats << ", worst stall: " << _worstMs << " ms\n\n";
+
+    out << "Latency            Beats    Stalls\n";
+    for(int i = 0; i < BUCKET_COUNT; i++)
+    {
+        if(_latency[i] == 0)
+            continue;
+        out << bucketLabel(i).leftJustified(16) << QString::number(_latency[i]).rightJustified(8)
+            << QString::number(_stalls[i]).rightJustified(10) << "\n";
+    }
+
+    QList<QPair<QString, ScopeStats>> scopes;
+    for(auto it = _scopes.cbegin(); it != _scopes.cend(); ++it)
+        scopes.push_back({ it.key(), it.value() });
+    std::sort(scopes.begin(), scopes.end(), [](const auto& a, const auto& b) {
+        return a.second.totalMs > b.second.totalMs;
+    });
+
+    out << "\n" << QString("Stalls by handler").leftJustified(40) << "  Count   Total ms     Max ms\n";
+    for(const auto& scope : scopes)
+    {
+        out << scope.first.leftJustified(40) << QString::number(scope.second.count).rightJustified(7)
+            << QString::number(scope.second.totalMs).rightJustified(11)
+            << QString::number(scope.second.maxMs).rightJustified(11) << "\n";
+    }
+
+    out.flush();
+    return text;
+}
+
+bool StallMonitor::dump(const QString& path, QString* error) const
+{
+    QFile file(path);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        if(error)
+            *error = file.errorString();
+        return false;
+    }
+
+    file.write(report().toUtf8());
+    return true;
+}
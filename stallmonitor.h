@@ -0,0 +1,87 @@
+#ifndef STALLMONITOR_H
+#define STALLMONITOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QTimer>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+/*
+ * Measures how long the GUI event loop is blocked.
+ *
+ * A heartbeat timer on the GUI thread records how late each beat fires into a
+ * latency histogram. A watchdog thread notices beats that are overdue while
+ * the loop is still blocked and samples the innermost Scope marker, so each
+ * stall is attributed to the handler that was running when it happened.
+ */
+class StallMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int HEARTBEAT_MS = 20;
+    static constexpr int STALL_THRESHOLD_MS = 100;
+    static constexpr int WATCHDOG_INTERVAL_MS = 10;
+    static constexpr int BUCKET_COUNT = 14; // Powers of two from 1 ms, the last one is open ended
+
+    // Marks the handler running on the GUI thread for stall attribution.
+    // The name must be a string literal or otherwise outlive the scope.
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name);
+        ~Scope();
+
+    private:
+        const char* _previous;
+    };
+
+    static StallMonitor& instance();
+
+    void start();
+    void stop();
+    void reset();
+
+    QString report() const;
+    bool dump(const QString& path, QString* error = nullptr) const;
+
+private:
+    explicit StallMonitor(QObject* parent = nullptr);
+    ~StallMonitor();
+
+    struct ScopeStats
+    {
+        quint64 count = 0;
+        qint64 totalMs = 0;
+        qint64 maxMs = 0;
+    };
+
+    static int bucketOf(qint64 ms);
+    static QString bucketLabel(int bucket);
+
+    void onHeartbeat();
+    void watchdog();
+
+    QTimer _heartbeat;
+    QElapsedTimer _clock;
+    qint64 _lastBeatMs = -1;
+
+    std::thread _watchdog;
+    std::atomic<bool> _running = false;
+    std::atomic<qint64> _beatMs = 0;
+    std::atomic<const char*> _stallScope = nullptr;
+    static std::atomic<const char*> _currentScope;
+
+    mutable std::mutex _mtx;
+    quint64 _latency[BUCKET_COUNT] = {};
+    quint64 _stalls[BUCKET_COUNT] = {};
+    quint64 _beats = 0;
+    qint64 _worstMs = 0;
+    QMap<QString, ScopeStats> _scopes;
+};
+
+#endif // STALLMONITOR_H
@@ -0,0 +1,64 @@
+#include "stallreportdialog.h"
+#include "diskwriter.h"
+#include "stallmonitor.h"
+
+#include <QDialogButtonBox>
+#include <QFile>
+#include <QFileDialog>
+#include <QFontDatabase>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QStandardPaths>
+#include <QVBoxLayout>
+
+StallReportDialog::StallReportDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("Responsiveness Report");
+    resize(640, 480);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+
+    reportText = new QPlainTextEdit();
+    reportText->setReadOnly(true);
+    reportText->setLineWrapMode(QPlainTextEdit::NoWrap);
+    reportText->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    layout->addWidget(reportText);
+
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Close);
+    QPushButton* refreshButton = buttons->addButton("Refresh", QDialogButtonBox::ActionRole);
+    QPushButton* resetButton = buttons->addButton("Reset", QDialogButtonBox::ResetRole);
+    QPushButton* saveButton = buttons->addButton("Save...", QDialogButtonBox::ActionRole);
+    connect(refreshButton, &QPushButton::clicked, this, &StallReportDialog::onRefresh);
+    connect(resetButton, &QPushButton::clicked, this, &StallReportDialog::onReset);
+    connect(saveButton, &QPushButton::clicked, this, &StallReportDialog::onSave);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout->addWidget(buttons);
+
+    onRefresh();
+}
+
+void StallReportDialog::onRefresh()
+{
+    reportText->setPlainText(StallMonitor::instance().report() + "\n" + DiskWriter::instance().report());
+}
+
+void StallReportDialog::onReset()
+{
+    StallMonitor::instance().reset();
+    DiskWriter::instance().resetMetrics();
+    onRefresh();
+}
+
+void StallReportDialog::onSave()
+{
+    auto path = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/stall-report.txt";
+    QString filename = QFileDialog::getSaveFileName(this, "Save report", path, "Text File (*.txt)");
+    if(filename.isEmpty())
+        return;
+
+    // Saves what is shown, which includes the disk writer's part
+    QFile file(filename);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text) || file.write(reportText->toPlainText().toUtf8()) < 0)
+        QMessageBox::warning(this, "Save failed", QString::asprintf("Failed to save the report: %s", file.errorString().toStdString().c_str()));
+}
@@ -0,0 +1,22 @@
+#ifndef STALLREPORTDIALOG_H
+#define STALLREPORTDIALOG_H
+
+#include <QDialog>
+#include <QPlainTextEdit>
+
+class StallReportDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit StallReportDialog(QWidget *parent = nullptr);
+
+private:
+    void onRefresh();
+    void onReset();
+    void onSave();
+
+    QPlainTextEdit* reportText;
+};
+
+#endif // STALLREPORTDIALOG_H
@@ -0,0 +1,272 @@
+#include "syncengine.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <optional>
+
+SyncEngine::SyncEngine(HeadlessClient* client, QObject* parent)
+    : QObject(parent)
+    , _client(client)
+{
+}
+
+void SyncEngine::start(const QString& archiveDirectory, bool erase)
+{
+    if(_state != Idle)
+        return;
+
+    QString error;
+    if(!_manifest.load(archiveDirectory, &error))
+    {
+        // Reported like the client reports errors, never from within the call
+        QMetaObject::invokeMethod(this, [this, error]() { emit finished(false, error); }, Qt::QueuedConnection);
+        return;
+    }
+
+    // Connected for the duration of the sync only, after whoever started it, so
+    // their handlers see the client finishing while the sync is still running
+    connect(_client, &HeadlessClient::event, this, &SyncEngine::onClientEvent);
+    connect(_client, &HeadlessClient::finished, this, &SyncEngine::onClientFinished);
+
+    _erase = erase;
+    _queue.clear();
+    _downloaded = 0;
+    _bytes = 0;
+    _state = Listing;
+    _client->listLogs();
+}
+
+bool SyncEngine::isRunning() const
+{
+    return _state != Idle;
+}
+
+void SyncEngine::onClientEvent(const QJsonObject& e)
+{
+    if(e["event"].toString() == "downloaded")
+    {
+        // Archived logs are reported by the engine instead
+        _stagedPath = e["path"].toString();
+        return;
+    }
+    emit event(e);
+}
+
+void SyncEngine::onClientFinished(bool success, const QString& error)
+{
+    if(!success)
+    {
+        finish(false, error);
+        return;
+    }
+
+    switch(_state)
+    {
+    case Listing:
+        onListed();
+        break;
+    case Downloading:
+    {
+        const auto item = _queue.takeFirst();
+        QString archiveError;
+        if(!archive(item, &archiveError))
+        {
+            finish(false, archiveError);
+            return;
+        }
+        downloadNext();
+        break;
+    }
+    case Relisting:
+    {
+        QString eraseError;
+        if(!checkErasable(&eraseError))
+        {
+            finish(false, "Not erasing: " + eraseError);
+            return;
+        }
+        _state = Erasing;
+        _client->eraseLogs();
+        break;
+    }
+    case Erasing:
+        finish(true);
+        break;
+    case Idle:
+        break;
+    }
+}
+
+void SyncEngine::onListed()
+{
+    const QString deviceId = _client->deviceId();
+    int archived = 0;
+    int grown = 0;
+    qint64 bytes = 0;
+    for(const auto& item : _client->logs())
+    {
+        switch(_manifest.status(deviceId, item))
+        {
+        case ArchiveManifest::Archived:
+            archived++;
+            continue;
+        case ArchiveManifest::Grown:
+            grown++;
+            break;
+        case ArchiveManifest::Missing:
+            break;
+        }
+        _queue.push_back(item);
+        bytes += item.size;
+    }
+
+    emit event({
+        { "event", "syncPlan" },
+        { "device", deviceId },
+        { "logs", (int) _client->logs().size() },
+        { "archived", archived },
+        { "new", (int) _queue.size() - grown },
+        { "grown", grown },
+        { "bytes", bytes },
+    });
+
+    _state = Downloading;
+    downloadNext();
+}
+
+void SyncEngine::downloadNext()
+{
+    if(!_queue.isEmpty())
+    {
+        _stagedPath.clear();
+        const QList<LogListPacket::LogItem> next = { _queue.front() };
+        _client->downloadLogs(next, QDir(_manifest.directory()).filePath(STAGING_DIRECTORY));
+        return;
+    }
+
+    if(_erase)
+    {
+        // Logs may have been recorded while downloading, and those aren't archived yet
+        _state = Relisting;
+        _client->listLogs();
+        return;
+    }
+    finish(true);
+}
+
+bool SyncEngine::archive(const LogListPacket::LogItem& item, QString* error)
+{
+    QFile staged(_stagedPath);
+    if(_stagedPath.isEmpty() || !staged.open(QIODevice::ReadOnly))
+    {
+        *error = QString::asprintf("Log %u was not saved", item.id);
+        return false;
+    }
+
+    // A log being recorded may have grown since it was listed, but never shrinks
+    const QByteArray data = staged.readAll();
+    staged.close();
+    if(data.size() < (qsizetype) item.size)
+    {
+        *error = QString::asprintf("Log %u is incomplete: %lld of %u bytes", item.id, data.size(), item.size);
+        return false;
+    }
+
+    const QString deviceId = _client->deviceId();
+    std::optional<ArchiveManifest::Entry> previous;
+    if(const ArchiveManifest::Entry* found = _manifest.find(deviceId, item))
+        previous = *found;
+
+    ArchiveManifest::Entry entry;
+    entry.id = item.id;
+    entry.size = (uint32_t) data.size();
+    entry.modified = item.modified;
+    entry.path = _manifest.relativePath(deviceId, item);
+    entry.sha256 = ArchiveManifest::hash(data);
+    entry.archivedAt = QDateTime::currentMSecsSinceEpoch();
+
+    // A grown log replaces its earlier copy, which is a prefix of it
+    const QString target = _manifest.absolutePath(entry);
+    QDir().mkpath(QFileInfo(target).absolutePath());
+    QFile::remove(target);
+    if(!QFile::rename(_stagedPath, target))
+    {
+        *error = "Failed to move " + _stagedPath + " to " + target;
+        return false;
+    }
+
+    if(!_manifest.verify(entry, error))
+        return false;
+
+    // A copy under another modification time is replaced too when the log grew
+    // from it. Otherwise the id was reused after an erase and both are kept.
+    if(previous && previous->modified != entry.modified)
+    {
+        QFile earlier(_manifest.absolutePath(*previous));
+        if(earlier.open(QIODevice::ReadOnly) && data.startsWith(earlier.readAll()))
+            _manifest.remove(deviceId, *previous);
+        else
+            previous.reset();
+    }
+
+    _manifest.record(deviceId, entry);
+    if(!_manifest.save(error))
+        return false;
+
+    // Only removed once the manifest no longer refers to it
+    if(previous && previous->path != entry.path)
+        QFile::remove(_manifest.absolutePath(*previous));
+
+    _downloaded++;
+    _bytes += entry.size;
+    emit event({
+        { "event", "archived" },
+        { "device", deviceId },
+        { "id", (qint64) entry.id },
+        { "size", (qint64) entry.size },
+        { "modified", (qint64) entry.modified },
+        { "path", target },
+        { "sha256", entry.sha256 },
+    });
+    return true;
+}
+
+bool SyncEngine::checkErasable(QString* error)
+{
+    const QString deviceId = _client->deviceId();
+    for(const auto& item : _client->logs())
+    {
+        const ArchiveManifest::Entry* entry = _manifest.find(deviceId, item);
+        if(_manifest.status(deviceId, item) != ArchiveManifest::Archived)
+        {
+            *error = QString::asprintf("log %u has no complete copy in the archive", item.id);
+            return false;
+        }
+        if(!_manifest.verify(*entry, error))
+            return false;
+    }
+    return true;
+}
+
+void SyncEngine::finish(bool success, const QString& error)
+{
+    const bool erased = _state == Erasing && success;
+    _state = Idle;
+    disconnect(_client, nullptr, this, nullptr);
+    QDir(QDir(_manifest.directory()).filePath(STAGING_DIRECTORY)).removeRecursively();
+
+    if(success)
+    {
+        emit event({
+            { "event", "synced" },
+            { "device", _client->deviceId() },
+            { "downloaded", _downloaded },
+            { "bytes", _bytes },
+            { "erased", erased },
+        });
+    }
+    emit finished(success, error);
+}
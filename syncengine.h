@@ -0,0 +1,66 @@
+#ifndef SYNCENGINE_H
+#define SYNCENGINE_H
+
+#include <QObject>
+#include <QJsonObject>
+
+#include "archivemanifest.h"
+#include "headlessclient.h"
+
+/*
+ * Brings a local archive up to date with the logs of a connected sensor. The
+ * sensor's listing is compared with the archive manifest and only logs that
+ * are new or have grown are downloaded. Each one is checked against the size
+ * listed for it, moved into the archive and recorded with its hash before the
+ * next one starts, so an interrupted sync keeps what it has done.
+ *
+ * With erasing enabled, the logs are listed once more after downloading and
+ * only erased when every log still on the sensor has a verified copy.
+ */
+class SyncEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr const char* STAGING_DIRECTORY = ".staging";
+
+    explicit SyncEngine(HeadlessClient* client, QObject* parent = nullptr);
+
+    void start(const QString& archiveDirectory, bool erase);
+    bool isRunning() const;
+
+signals:
+    // Forwards the client's events besides its own
+    void event(const QJsonObject& event);
+    void finished(bool success, const QString& error);
+
+private:
+    enum State
+    {
+        Idle,
+        Listing,
+        Downloading,
+        Relisting,
+        Erasing,
+    };
+
+    void onClientEvent(const QJsonObject& e);
+    void onClientFinished(bool success, const QString& error);
+    void onListed();
+    void downloadNext();
+    bool archive(const LogListPacket::LogItem& item, QString* error);
+    bool checkErasable(QString* error);
+    void finish(bool success, const QString& error = QString());
+
+    HeadlessClient* _client;
+    ArchiveManifest _manifest;
+    State _state = Idle;
+    bool _erase = false;
+
+    QList<LogListPacket::LogItem> _queue;
+    QString _stagedPath;
+    int _downloaded = 0;
+    qint64 _bytes = 0;
+};
+
+#endif // SYNCENGINE_H
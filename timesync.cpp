@@ -0,0 +1,225 @@
+#include "timesync.h"
+
+#include <QSettings>
+#include <QtLogging>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+TimeSync::TimeSync(Sensor* sensor)
+    : QObject(sensor)
+    , _sensor(sensor)
+{
+    _timeout.setSingleShot(true);
+    connect(&_timeout, &QTimer::timeout, this, &TimeSync::onTimeout);
+    connect(_sensor, &Sensor::onTimeReceived, this, &TimeSync::onTime);
+    connect(_sensor, &Sensor::onStatusResponse, this, &TimeSync::onStatus);
+}
+
+void TimeSync::start()
+{
+    if(_state != Idle)
+        return;
+
+    _result = Result();
+    _result.measured = _sensor->isProtocolVersionAtLeast(1, 5);
+    _state = _result.measured ? MeasuringBefore : Setting;
+    _samples = 0;
+    _sets = 0;
+    _bestRoundTripUs = -1;
+    _bestOffsetUs = 0;
+
+    // Callers may wait for finished() right after starting, so never emit from within the call
+    QMetaObject::invokeMethod(this, [this]() {
+        if(_state == MeasuringBefore)
+            sample();
+        else if(_state == Setting)
+            setClock();
+    }, Qt::QueuedConnection);
+}
+
+bool TimeSync::isRunning() const
+{
+    return _state != Idle;
+}
+
+const TimeSync::Result& TimeSync::result() const
+{
+    return _result;
+}
+
+qint64 TimeSync::hostTimeUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+void TimeSync::sample()
+{
+    _sentUs = hostTimeUs();
+    _ref = _sensor->readTime();
+    if(_ref == Packet::INVALID_REF)
+    {
+        finish(false, "Failed to request the sensor time");
+        return;
+    }
+    _timeout.start(RESPONSE_TIMEOUT_MS);
+}
+
+void TimeSync::setClock()
+{
+    // The sensor takes the time when it receives it, about half a round trip from now
+    const qint64 delayUs = std::max<qint64>(0, _bestRoundTripUs / 2);
+    _sentUs = hostTimeUs();
+    _ref = _sensor->setTime(_sentUs + delayUs);
+    if(_ref == Packet::INVALID_REF)
+    {
+        finish(false, "Failed to set the sensor time");
+        return;
+    }
+    _timeout.start(RESPONSE_TIMEOUT_MS);
+}
+
+void TimeSync::onTime(uint8_t ref, qint64 sensorUs, qint64 receivedUs)
+{
+    if(ref != _ref || (_state != MeasuringBefore && _state != MeasuringAfter))
+        return;
+
+    _ref = Packet::INVALID_REF;
+    const qint64 roundTripUs = receivedUs - _sentUs;
+    if(_bestRoundTripUs < 0 || roundTripUs < _bestRoundTripUs)
+    {
+        // The sensor read its clock halfway through the round trip
+        _bestRoundTripUs = roundTripUs;
+        _bestOffsetUs = sensorUs - (_sentUs + roundTripUs / 2);
+    }
+
+    if(++_samples < SAMPLE_COUNT)
+    {
+        sample();
+        return;
+    }
+
+    if(_state == MeasuringBefore)
+    {
+        _result.offsetBeforeUs = _bestOffsetUs;
+        _state = Setting;
+        setClock();
+        return;
+    }
+
+    _result.offsetAfterUs = _bestOffsetUs;
+    _result.roundTripUs = _bestRoundTripUs;
+    updateDrift();
+    finish(true);
+}
+
+void TimeSync::onStatus(uint8_t ref, uint16_t status)
+{
+    if(ref != _ref || _state == Idle)
+        return;
+
+    // A read of the sensor clock is answered with the time, a status means it was rejected
+    if(_state != Setting)
+    {
+        if(status >= 300)
+            finish(false, QString::asprintf("Reading the sensor time failed with status %u", status));
+        return;
+    }
+
+    const qint64 roundTripUs = hostTimeUs() - _sentUs;
+    _ref = Packet::INVALID_REF;
+    if(status >= 300)
+    {
+        finish(false, QString::asprintf("Setting the time failed with status %u", status));
+        return;
+    }
+
+    if(_result.measured)
+    {
+        _state = MeasuringAfter;
+        _samples = 0;
+        _bestRoundTripUs = -1;
+        sample();
+        return;
+    }
+
+    // Without readings of the sensor clock the round trips of setting it are all there is
+    if(_bestRoundTripUs < 0 || roundTripUs < _bestRoundTripUs)
+        _bestRoundTripUs = roundTripUs;
+
+    if(++_sets < LEGACY_SET_COUNT)
+    {
+        setClock();
+        return;
+    }
+
+    _result.roundTripUs = _bestRoundTripUs;
+    finish(true);
+}
+
+void TimeSync::onTimeout()
+{
+    finish(false, "Timed out waiting for the sensor time");
+}
+
+void TimeSync::updateDrift()
+{
+    // Relative to what was left after the previous sync of this sensor
+    QSettings settings;
+    settings.beginGroup("timeSync/" + _sensor->deviceId());
+
+    const qint64 now = hostTimeUs();
+    if(settings.contains("hostUs"))
+    {
+        const qint64 intervalUs = now - settings.value("hostUs").toLongLong();
+        const qint64 driftUs = _result.offsetBeforeUs - settings.value("offsetUs").toLongLong();
+        const qint64 uncertaintyUs = _result.uncertaintyUs() + settings.value("uncertaintyUs").toLongLong();
+
+        if(intervalUs >= MIN_DRIFT_INTERVAL_S * 1000000)
+        {
+            const double ppm = 1e6 * driftUs / intervalUs;
+            if(std::abs(ppm) <= MAX_DRIFT_PPM)
+            {
+                _result.hasDrift = true;
+                _result.driftPpm = ppm;
+                _result.driftUncertaintyPpm = 1e6 * uncertaintyUs / intervalUs;
+                _result.driftIntervalS = intervalUs / 1000000;
+            }
+        }
+    }
+
+    settings.setValue("hostUs", now);
+    settings.setValue("offsetUs", _result.offsetAfterUs);
+    settings.setValue("uncertaintyUs", _result.uncertaintyUs());
+}
+
+void TimeSync::finish(bool success, const QString& error)
+{
+    _timeout.stop();
+    _state = Idle;
+    _ref = Packet::INVALID_REF;
+
+    const std::string device = _sensor->deviceId().toStdString();
+    if(!success)
+    {
+        qInfo("Time sync of %s failed: %s", device.c_str(), error.toStdString().c_str());
+    }
+    else if(_result.measured)
+    {
+        qInfo("Time synced on %s: offset %lld us before, %lld us after (+-%lld us)",
+            device.c_str(), _result.offsetBeforeUs, _result.offsetAfterUs, _result.uncertaintyUs());
+        if(_result.hasDrift)
+        {
+            qInfo("Clock drift of %s: %.1f ppm (+-%.1f ppm) over %lld s",
+                device.c_str(), _result.driftPpm, _result.driftUncertaintyPpm, _result.driftIntervalS);
+        }
+    }
+    else
+    {
+        qInfo("Time set on %s with a round trip of %lld us", device.c_str(), _result.roundTripUs);
+    }
+
+    emit finished(success, error);
+}
@@ -0,0 +1,92 @@
+#ifndef TIMESYNC_H
+#define TIMESYNC_H
+
+#include <QObject>
+#include <QTimer>
+
+#include "sensor.h"
+
+/*
+ * Sets the sensor clock to the host clock, compensating for the link delay.
+ *
+ * From protocol 1.5 the sensor clock is sampled SAMPLE_COUNT times with
+ * CmdReadTime. As in NTP, the sample with the shortest round trip gives the
+ * offset, assuming the response took half of it. The clock is then set to
+ * the host time plus that one-way delay, and sampled again for the offset
+ * that remains. Comparing the offset found before setting the clock with the
+ * one left after the previous sync gives the sensor's drift.
+ *
+ * Older sensors can't report their clock. Their clock is set LEGACY_SET_COUNT
+ * times instead, each time compensated by the shortest round trip so far.
+ */
+class TimeSync : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int SAMPLE_COUNT = 8;
+    static constexpr int LEGACY_SET_COUNT = 4;
+    static constexpr int RESPONSE_TIMEOUT_MS = 5000;
+    // Over shorter intervals the offset uncertainty swamps any drift
+    static constexpr qint64 MIN_DRIFT_INTERVAL_S = 60;
+    // Anything beyond this means the sensor clock was reset in between
+    static constexpr double MAX_DRIFT_PPM = 1000;
+
+    struct Result
+    {
+        bool measured = false; // The sensor reported its clock
+        qint64 roundTripUs = 0; // Shortest round trip
+        qint64 offsetBeforeUs = 0; // Sensor clock minus host clock, before setting it
+        qint64 offsetAfterUs = 0; // And what remains after
+        bool hasDrift = false;
+        double driftPpm = 0; // Since the previous sync, positive when the sensor clock runs fast
+        double driftUncertaintyPpm = 0;
+        qint64 driftIntervalS = 0;
+
+        // Bound for the error of each offset, the link may not be symmetric
+        qint64 uncertaintyUs() const { return roundTripUs / 2; }
+    };
+
+    explicit TimeSync(Sensor* sensor);
+
+    // Joins a sync already in progress. finished() is never emitted from within the call.
+    void start();
+    bool isRunning() const;
+    const Result& result() const;
+
+    // Host clock in microseconds since the Unix epoch
+    static qint64 hostTimeUs();
+
+signals:
+    void finished(bool success, const QString& error);
+
+private:
+    enum State
+    {
+        Idle,
+        MeasuringBefore,
+        Setting,
+        MeasuringAfter,
+    };
+
+    void sample();
+    void setClock();
+    void onTime(uint8_t ref, qint64 sensorUs, qint64 receivedUs);
+    void onStatus(uint8_t ref, uint16_t status);
+    void onTimeout();
+    void updateDrift();
+    void finish(bool success, const QString& error = QString());
+
+    Sensor* _sensor;
+    QTimer _timeout;
+    State _state = Idle;
+    uint8_t _ref = Packet::INVALID_REF;
+    qint64 _sentUs = 0;
+    int _samples = 0;
+    int _sets = 0;
+    qint64 _bestRoundTripUs = -1;
+    qint64 _bestOffsetUs = 0;
+    Result _result;
+};
+
+#endif // TIMESYNC_H
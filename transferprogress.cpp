@@ -0,0 +1,95 @@
+#include "transferprogress.h"
+
+static QString formatBytes(double bytes)
+{
+    if(bytes >= 1024.0 * 1024.0)
+        return QString::asprintf("%.2f MB", bytes / (1024.0 * 1024.0));
+    if(bytes >= 1024.0)
+        return QString::asprintf("%.1f kB", bytes / 1024.0);
+    return QString::asprintf("%.0f B", bytes);
+}
+
+int TransferProgress::percent() const
+{
+    if(totalBytes == 0)
+        return 0;
+    return (int) (100.0 * ((double) receivedBytes / totalBytes));
+}
+
+QString TransferProgress::toString() const
+{
+    QString text = QString::asprintf("%d%%  %s/s", percent(),
+        formatBytes(averageBytesPerSecond).toStdString().c_str());
+
+    if(etaMs >= 0)
+    {
+        qint64 seconds = (etaMs + 999) / 1000;
+        text += QString::asprintf("  ETA %lld:%02lld", seconds / 60, seconds % 60);
+    }
+
+    text += QString::asprintf("  %u packets", packets);
+    return text;
+}
+
+TransferProgressTracker::TransferProgressTracker()
+{
+    _timer.start();
+}
+
+bool TransferProgressTracker::update(uint32_t receivedBytes, uint32_t totalBytes)
+{
+    _progress.receivedBytes = receivedBytes;
+    _progress.totalBytes = totalBytes;
+    _progress.packets++;
+
+    const qint64 now = _timer.elapsed();
+    _progress.elapsedMs = now;
+
+    // Throughput is measured from the arrival of the first packet
+    if(_progress.packets == 1)
+    {
+        _lastSampleMs = now;
+        _lastSampleBytes = receivedBytes;
+        return true;
+    }
+
+    // Always report the last packet of a transfer
+    const bool due = receivedBytes >= totalBytes
+        || now - _lastSampleMs >= UPDATE_INTERVAL_MS;
+
+    if(due)
+        sample(now);
+    return due;
+}
+
+void TransferProgressTracker::finish()
+{
+    sample(_timer.elapsed());
+    _progress.etaMs = 0;
+}
+
+const TransferProgress& TransferProgressTracker::progress() const
+{
+    return _progress;
+}
+
+void TransferProgressTracker::sample(qint64 now)
+{
+    const qint64 interval = now - _lastSampleMs;
+    if(interval > 0)
+    {
+        _progress.bytesPerSecond = 1000.0 * (_progress.receivedBytes - _lastSampleBytes) / interval;
+
+        if(_progress.averageBytesPerSecond <= 0.0)
+            _progress.averageBytesPerSecond = _progress.bytesPerSecond;
+        else
+            _progress.averageBytesPerSecond = AVERAGE_WEIGHT * _progress.bytesPerSecond
+                + (1.0 - AVERAGE_WEIGHT) * _progress.averageBytesPerSecond;
+
+        _lastSampleMs = now;
+        _lastSampleBytes = _progress.receivedBytes;
+    }
+
+    if(_progress.averageBytesPerSecond > 0.0 && _progress.totalBytes >= _progress.receivedBytes)
+        _progress.etaMs = (qint64) (1000.0 * (_progress.totalBytes - _progress.receivedBytes) / _progress.averageBytesPerSecond);
+}
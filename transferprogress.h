@@ -0,0 +1,49 @@
+#ifndef TRANSFERPROGRESS_H
+#define TRANSFERPROGRESS_H
+
+#include <QElapsedTimer>
+#include <QString>
+
+struct TransferProgress
+{
+    uint32_t receivedBytes = 0;
+    uint32_t totalBytes = 0;
+    uint32_t packets = 0;
+    qint64 elapsedMs = 0;
+    double bytesPerSecond = 0.0;        // Over the last update interval
+    double averageBytesPerSecond = 0.0; // Exponentially weighted moving average
+    qint64 etaMs = -1;                  // Negative while unknown
+
+    int percent() const;
+    QString toString() const;
+};
+
+/*
+ * Follows one data transfer and decides when a progress update is due, so
+ * receivers are notified at most every UPDATE_INTERVAL_MS regardless of how
+ * many packets arrive in between.
+ */
+class TransferProgressTracker
+{
+public:
+    static constexpr qint64 UPDATE_INTERVAL_MS = 100;
+    static constexpr double AVERAGE_WEIGHT = 0.25;
+
+    TransferProgressTracker();
+
+    // Records a received packet, returns true when an update should be emitted
+    bool update(uint32_t receivedBytes, uint32_t totalBytes);
+    void finish();
+
+    const TransferProgress& progress() const;
+
+private:
+    void sample(qint64 now);
+
+    QElapsedTimer _timer;
+    qint64 _lastSampleMs = 0;
+    uint32_t _lastSampleBytes = 0;
+    TransferProgress _progress;
+};
+
+#endif // TRANSFERPROGRESS_H